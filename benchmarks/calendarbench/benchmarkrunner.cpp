@@ -0,0 +1,179 @@
+/**
+ * @file benchmarkrunner.cpp
+ * @brief Implementation of the BenchmarkRunner class
+ */
+#include "benchmarkrunner.h"
+#include <QDateTime>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QSysInfo>
+#include <QTextStream>
+
+/**
+ * @brief Gets the mean time of one operation.
+ * @return Nanoseconds per operation.
+ */
+double BenchmarkRunner::Result::nsPerOperation() const {
+    return operations > 0 ? double(nanoseconds) / operations : 0.0;
+}
+
+/**
+ * @brief Gets the event throughput.
+ * @return Events per second, 0 if the benchmark does not count events.
+ */
+double BenchmarkRunner::Result::eventsPerSecond() const {
+    return nanoseconds > 0 ? events * 1e9 / nanoseconds : 0.0;
+}
+
+/**
+ * @brief Gets the byte throughput.
+ * @return MiB per second, 0 if the benchmark does not count bytes.
+ */
+double BenchmarkRunner::Result::megabytesPerSecond() const {
+    return nanoseconds > 0 ? bytes * 1e9 / nanoseconds / (1024.0 * 1024.0) : 0.0;
+}
+
+/**
+ * @brief Constructs a runner.
+ * @param minimumMilliseconds How long run() repeats an operation for.
+ */
+BenchmarkRunner::BenchmarkRunner(qint64 minimumMilliseconds)
+    : minimumNanoseconds(minimumMilliseconds * 1000000) {}
+
+/**
+ * @brief Repeats an operation until the minimum time has passed and records it.
+ * @param name The benchmark name.
+ * @param size The workload size in events.
+ * @param operation One operation.
+ */
+void BenchmarkRunner::run(const QString& name, qint64 size, const std::function<void()>& operation) {
+    Result result;
+    result.name = name;
+    result.size = size;
+
+    QElapsedTimer timer;
+    timer.start();
+    qint64 batch = 1;
+    while (result.nanoseconds < minimumNanoseconds) {
+        qint64 before = timer.nsecsElapsed();
+        for (qint64 i = 0; i < batch; i++) {
+            operation();
+        }
+        result.nanoseconds += timer.nsecsElapsed() - before;
+        result.operations += batch;
+        batch *= 2;
+    }
+    record(result);
+}
+
+/**
+ * @brief Records a result timed by the caller.
+ * @param result The result.
+ */
+void BenchmarkRunner::record(const Result& result) {
+    results.append(result);
+}
+
+/**
+ * @brief Gets every recorded result.
+ * @return The results, in recording order.
+ */
+const QList<BenchmarkRunner::Result>& BenchmarkRunner::getResults() const {
+    return results;
+}
+
+/**
+ * @brief Formats the results as a table.
+ * @return One line per result.
+ */
+QString BenchmarkRunner::toText() const {
+    QString text = QString("%1 %2 %3 %4 %5\n")
+                       .arg(QString("benchmark"), -28)
+                       .arg(QString("size"), 9)
+                       .arg(QString("ns/op"), 14)
+                       .arg(QString("events/s"), 14)
+                       .arg(QString("MB/s"), 10);
+    for (const Result& result : results) {
+        text += QString("%1 %2 %3 %4 %5\n")
+                    .arg(result.name, -28)
+                    .arg(result.size, 9)
+                    .arg(result.nsPerOperation(), 14, 'f', 1)
+                    .arg(result.eventsPerSecond(), 14, 'f', 0)
+                    .arg(result.megabytesPerSecond(), 10, 'f', 1);
+    }
+    return text;
+}
+
+/**
+ * @brief Formats the results as JSON, for tracking regressions across releases.
+ * @return A document with the run context and one object per result.
+ */
+QJsonDocument BenchmarkRunner::toJson() const {
+    QJsonArray array;
+    for (const Result& result : results) {
+        QJsonObject object;
+        object["name"] = result.name;
+        object["size"] = result.size;
+        object["operations"] = result.operations;
+        object["ns_per_op"] = result.nsPerOperation();
+        object["events_per_s"] = result.eventsPerSecond();
+        object["mb_per_s"] = result.megabytesPerSecond();
+        array.append(object);
+    }
+
+    QJsonObject root;
+    root["format"] = 1;
+    root["timestamp"] = QDateTime::currentDateTimeUtc().toString(Qt::ISODate);
+    root["qt_version"] = QString(qVersion());
+    root["cpu"] = QSysInfo::currentCpuArchitecture();
+    root["os"] = QSysInfo::prettyProductName();
+    root["results"] = array;
+    return QJsonDocument(root);
+}
+
+/**
+ * @brief Compares event throughput against an earlier JSON report.
+ * @param baseline A report written by toJson().
+ * @param maxRegressionPercent How much slower a benchmark may get, in percent of its baseline events/s.
+ * @param report Receives one line per compared benchmark.
+ * @param compared Set to the number of benchmarks found in the baseline.
+ * @return false if any benchmark regressed by more than the limit.
+ *
+ * Only benchmarks that process events are compared, matched by name and size.
+ */
+bool BenchmarkRunner::checkRegressions(const QJsonDocument& baseline, double maxRegressionPercent, QString& report,
+                                       int& compared) const {
+    QHash<QPair<QString, qint64>, double> baselineRates;
+    for (const QJsonValue& value : baseline.object().value("results").toArray()) {
+        QJsonObject object = value.toObject();
+        baselineRates.insert({object.value("name").toString(), object.value("size").toInteger()},
+                             object.value("events_per_s").toDouble());
+    }
+
+    bool passed = true;
+    compared = 0;
+    QTextStream out(&report);
+    for (const Result& result : results) {
+        if (result.events == 0) continue;
+
+        double before = baselineRates.value({result.name, result.size}, 0);
+        if (before <= 0) continue;
+        compared++;
+
+        double after = result.eventsPerSecond();
+        double change = (after - before) * 100.0 / before;
+        bool regressed = change < -maxRegressionPercent;
+        passed = passed && !regressed;
+
+        out << QString("%1 %2 %3 -> %4 events/s (%5%6%) %7\n")
+                   .arg(result.name, -28)
+                   .arg(result.size, 9)
+                   .arg(before, 0, 'f', 0)
+                   .arg(after, 0, 'f', 0)
+                   .arg(change >= 0 ? QString("+") : QString())
+                   .arg(change, 0, 'f', 1)
+                   .arg(regressed ? QString("REGRESSED") : QString("ok"));
+    }
+    return passed;
+}
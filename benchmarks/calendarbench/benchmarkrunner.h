@@ -0,0 +1,57 @@
+/**
+ * @file benchmarkrunner.h
+ * @brief Defines the BenchmarkRunner class.
+ *
+ * Times benchmark bodies and collects machine-readable results.
+ */
+#ifndef BENCHMARKRUNNER_H
+#define BENCHMARKRUNNER_H
+
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QList>
+#include <QString>
+#include <functional>
+
+/**
+ * @class BenchmarkRunner
+ * @brief Runs benchmark bodies and records their throughput.
+ */
+class BenchmarkRunner {
+public:
+    /**
+     * @struct Result
+     * @brief One benchmark at one size.
+     */
+    struct Result {
+        QString name;
+        qint64 size = 0;          // events in the workload
+        qint64 operations = 0;    // operations timed
+        qint64 nanoseconds = 0;   // total time of the timed operations
+        qint64 events = 0;        // events processed, for events/s
+        qint64 bytes = 0;         // bytes processed, for MB/s
+
+        double nsPerOperation() const;
+        double eventsPerSecond() const;
+        double megabytesPerSecond() const;
+    };
+
+private:
+    QList<Result> results;
+    qint64 minimumNanoseconds;
+
+public:
+    explicit BenchmarkRunner(qint64 minimumMilliseconds = 500);
+
+    void run(const QString& name, qint64 size, const std::function<void()>& operation);
+    void record(const Result& result);
+
+    const QList<Result>& getResults() const;
+    QString toText() const;
+    QJsonDocument toJson() const;
+
+    bool checkRegressions(const QJsonDocument& baseline, double maxRegressionPercent, QString& report,
+                          int& compared) const;
+};
+
+#endif // BENCHMARKRUNNER_H
@@ -0,0 +1,19 @@
+QT       += core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = calendarbench
+
+include(../../calendar/core.pri)
+
+INCLUDEPATH += $$PWD/../../tools/icsgen
+
+SOURCES += \
+    $$PWD/../../tools/icsgen/icsgenerator.cpp \
+    benchmarkrunner.cpp \
+    main.cpp
+
+HEADERS += \
+    $$PWD/../../tools/icsgen/icsgenerator.h \
+    benchmarkrunner.h
@@ -0,0 +1,415 @@
+/**
+ * @file main.cpp
+ * @brief Benchmark suite for ingest, indexing and availability queries.
+ *
+ * Runs every benchmark at each workload size and prints a table, plus a JSON
+ * report with --json so results can be tracked release over release.
+ */
+#include "benchmarkrunner.h"
+#include "calendar.h"
+#include "event.h"
+#include "icsgenerator.h"
+#include "icsparser.h"
+#include "icswriter.h"
+#include "idallocator.h"
+#include "user.h"
+#include <QBuffer>
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTextStream>
+
+namespace {
+
+// workloads are spread over this many users, like a team workspace
+constexpr int workspaceUsers = 10;
+
+// feeds are parsed in chunks of at most this many events to bound memory
+constexpr qint64 eventsPerFeed = 100000;
+
+// mutations are timed this many times at each size
+constexpr int mutationsPerSize = 1000;
+
+// first day of the synthetic workload, 2024-01-01T00:00:00Z
+constexpr qint64 firstUtc = 1704067200;
+constexpr int spanDays = 365;
+
+volatile qint64 sink = 0;
+
+/**
+ * @class NullDevice
+ * @brief Discards everything written, so exports are timed without the disk.
+ */
+class NullDevice : public QIODevice {
+protected:
+    qint64 readData(char*, qint64) override { return -1; }
+    qint64 writeData(const char*, qint64 length) override { return length; }
+};
+
+/**
+ * @brief Generates a feed in memory.
+ * @param events The number of events.
+ * @param user The user index, which also picks the seed of the events.
+ * @return The feed bytes.
+ */
+QByteArray generateFeed(qint64 events, int user) {
+    IcsGenerator::Options options;
+    options.seed = 42;
+    options.eventsPerUser = events;
+    options.timeZones = {"UTC", "America/Toronto", "Europe/Berlin", "floating"};
+    options.maxDescription = 160;
+
+    QByteArray bytes;
+    QBuffer buffer(&bytes);
+    buffer.open(QIODevice::WriteOnly);
+    IcsGenerator generator(options);
+    generator.writeFeed(&buffer, user, 1);
+    return bytes;
+}
+
+/**
+ * @brief Creates events at random 15-minute slots of the workload's year.
+ * @param count The number of events.
+ * @param owner The organizer.
+ * @param random The random source.
+ * @return The events, owned by the caller.
+ */
+QList<Event*> makeEvents(qint64 count, User* owner, QRandomGenerator& random) {
+    static const QString title("Synthetic event");
+    QList<Event*> events;
+    events.reserve(count);
+    for (qint64 i = 0; i < count; i++) {
+        qint64 start = firstUtc + qint64(random.bounded(spanDays * 96)) * 900;
+        events.append(new Event(IdAllocator::next(IdAllocator::Events), title, QString(), start, QString(), owner));
+        events.last()->setEndUtc(start + qint64(1 + random.bounded(8)) * 900);
+    }
+    return events;
+}
+
+/**
+ * @brief Times IcsParser::parseICSDateTime over a mix of UTC, TZID and floating values.
+ */
+void benchDateTime(BenchmarkRunner& runner, qint64 size) {
+    IcsParser parser;
+    // load the VTIMEZONE blocks of the zone mix
+    parser.parse(QString::fromUtf8(generateFeed(0, 0)), nullptr);
+
+    const QString tzids[] = {"", "America/Toronto", "Europe/Berlin", ""};
+    QStringList values;
+    QRandomGenerator random(7);
+    for (int i = 0; i < 4096; i++) {
+        QDate date = QDate(2024, 1, 1).addDays(random.bounded(spanDays));
+        QString value = date.toString("yyyyMMdd");
+        if (i % 4 != 3) {
+            value += QString("T%1%2").arg(random.bounded(24), 2, 10, QChar('0')).arg(random.bounded(4) * 15, 2, 10, QChar('0')) + "00";
+        }
+        if (i % 4 == 0) {
+            value += 'Z';
+        }
+        values.append(value);
+    }
+
+    BenchmarkRunner::Result result;
+    result.name = "parseICSDateTime";
+    result.size = size;
+    QElapsedTimer timer;
+    timer.start();
+    for (qint64 i = 0; i < size; i++) {
+        qint64 utc = 0;
+        int index = int(i % values.size());
+        parser.parseICSDateTime(tzids[index % 4], values[index], utc);
+        sink += utc;
+    }
+    result.nanoseconds = timer.nsecsElapsed();
+    result.operations = size;
+    result.events = size;
+    runner.record(result);
+}
+
+/**
+ * @brief Times parsing feeds into events, with and without loading them into a calendar.
+ * @param withLoad true to also time UTF-8 decoding and Calendar::addEvents, like loadICSFile.
+ */
+void benchIngest(BenchmarkRunner& runner, qint64 size, bool withLoad) {
+    BenchmarkRunner::Result result;
+    result.name = withLoad ? "loadICSFile" : "parseICSEvent";
+    result.size = size;
+
+    User user(1, "Bench", "User");
+    int feeds = int((size + eventsPerFeed - 1) / eventsPerFeed);
+    for (int feed = 0; feed < feeds; feed++) {
+        QByteArray bytes = generateFeed(qMin(eventsPerFeed, size - feed * eventsPerFeed), feed);
+        QString content;
+        if (!withLoad) {
+            content = QString::fromUtf8(bytes);
+        }
+
+        QElapsedTimer timer;
+        timer.start();
+        Calendar calendar(1, &user);
+        if (withLoad) {
+            content = QString::fromUtf8(bytes);
+        }
+        IcsParser parser;
+        QList<Event*> events = parser.parse(content, &user);
+        if (withLoad) {
+            calendar.addEvents(events);
+        }
+        result.nanoseconds += timer.nsecsElapsed();
+
+        result.operations += events.size();
+        result.events += events.size();
+        result.bytes += bytes.size();
+        if (!withLoad) {
+            qDeleteAll(events);
+        }
+    }
+    runner.record(result);
+}
+
+/**
+ * @brief Times single mutations of a calendar that holds size events.
+ */
+void benchMutations(BenchmarkRunner& runner, qint64 size) {
+    User user(1, "Bench", "User");
+    Calendar calendar(1, &user);
+    QRandomGenerator random(11);
+    calendar.addEvents(makeEvents(size, &user, random));
+
+    BenchmarkRunner::Result add{"Calendar::addEvent", size};
+    BenchmarkRunner::Result update{"Calendar::updateEvent", size};
+    BenchmarkRunner::Result remove{"Calendar::removeEvent", size};
+    QElapsedTimer timer;
+
+    for (int i = 0; i < mutationsPerSize; i++) {
+        // add, then take it back out untimed so the size stays put
+        Event* added = makeEvents(1, &user, random).first();
+        timer.start();
+        calendar.addEvent(added);
+        add.nanoseconds += timer.nsecsElapsed();
+        calendar.removeEvent(added);
+
+        // replace a random event by a new version with the same ID
+        QList<Event*> events = calendar.getEvents();
+        Event* existing = events[random.bounded(int(events.size()))];
+        Event* updated = new Event(existing->getEventID(), "Updated", QString(),
+                                   existing->getStartUtc() + 900, QString(), &user);
+        timer.start();
+        calendar.updateEvent(updated);
+        update.nanoseconds += timer.nsecsElapsed();
+
+        // remove a random event, then put a fresh one back untimed
+        events = calendar.getEvents();
+        Event* removed = events[random.bounded(int(events.size()))];
+        timer.start();
+        calendar.removeEvent(removed);
+        remove.nanoseconds += timer.nsecsElapsed();
+        calendar.addEvents(makeEvents(1, &user, random));
+    }
+
+    for (BenchmarkRunner::Result* result : {&add, &update, &remove}) {
+        result->operations = mutationsPerSize;
+        runner.record(*result);
+    }
+}
+
+/**
+ * @brief Times editing the text of one event in a calendar that holds size events.
+ *
+ * Unlike makeEvents(), the events use a vocabulary of about one word per ten
+ * events, so the search index is as large as for a real workspace and an edit
+ * has to republish it.
+ */
+void benchTextEdit(BenchmarkRunner& runner, qint64 size) {
+    User user(1, "Bench", "User");
+    Calendar calendar(1, &user);
+    QRandomGenerator random(23);
+    int vocabulary = int(qMax(size / 10, qint64(1)));
+    auto words = [&](int count) {
+        QStringList text;
+        for (int i = 0; i < count; i++) {
+            text.append(QString("topic%1").arg(random.bounded(vocabulary)));
+        }
+        return text.join(' ');
+    };
+
+    QList<Event*> events = makeEvents(size, &user, random);
+    for (Event*& event : events) {
+        Event* worded = new Event(event->getEventID(), words(2), words(6), event->getStartUtc(), words(1), &user);
+        worded->setEndUtc(event->getEndUtc());
+        delete event;
+        event = worded;
+    }
+    calendar.addEvents(events);
+
+    BenchmarkRunner::Result edit{"Calendar::editText", size};
+    QElapsedTimer timer;
+    for (int i = 0; i < mutationsPerSize; i++) {
+        Event* existing = events[random.bounded(int(events.size()))];
+        Event* updated = new Event(existing->getEventID(), words(2), words(6), existing->getStartUtc(), words(1), &user);
+        updated->setEndUtc(existing->getEndUtc());
+        timer.start();
+        calendar.updateEvent(updated);
+        edit.nanoseconds += timer.nsecsElapsed();
+        events = calendar.getEvents();
+    }
+    edit.operations = mutationsPerSize;
+    runner.record(edit);
+}
+
+/**
+ * @brief Times exporting a calendar of size events with IcsWriter.
+ */
+void benchExport(BenchmarkRunner& runner, qint64 size) {
+    User user(1, "Bench", "User");
+    Calendar calendar(1, &user);
+    QRandomGenerator random(17);
+    calendar.addEvents(makeEvents(size, &user, random));
+
+    NullDevice device;
+    device.open(QIODevice::WriteOnly);
+
+    QElapsedTimer timer;
+    timer.start();
+    IcsWriter writer(&device);
+    writer.writeCalendar(&calendar, "Bench");
+
+    BenchmarkRunner::Result result{"IcsWriter::writeCalendar", size};
+    result.nanoseconds = timer.nsecsElapsed();
+    result.operations = writer.getEventsWritten();
+    result.events = writer.getEventsWritten();
+    result.bytes = writer.getBytesWritten();
+    runner.record(result);
+}
+
+/**
+ * @brief Times the queries the UI runs against a workspace of size events.
+ *
+ * "dayQuery" is what onDateSelected does: one date index lookup per calendar,
+ * then reading the rows a list view shows. "weekQuery" is what a week timeline
+ * refresh does: one interval index query per calendar. "availability" is the
+ * check showEventDetailsDialog runs for every user.
+ */
+void benchQueries(BenchmarkRunner& runner, qint64 size) {
+    QList<User*> users;
+    QList<Calendar*> calendars;
+    QRandomGenerator random(13);
+    for (int i = 0; i < workspaceUsers; i++) {
+        users.append(new User(i + 1, "Bench", QString::number(i + 1)));
+        calendars.append(new Calendar(i + 1, users.last()));
+        calendars.last()->addEvents(makeEvents(size / workspaceUsers, users.last(), random));
+    }
+
+    runner.run("dayQuery", size, [&]() {
+        QDate date = QDate(2024, 1, 1).addDays(random.bounded(spanDays));
+        int shown = 0;
+        for (const Calendar* calendar : calendars) {
+            for (const Event* event : calendar->getEventsOn(date)) {
+                // a list view only materializes its visible rows
+                if (shown++ < 30) {
+                    sink += event->getTitle().size();
+                }
+            }
+        }
+        sink += shown;
+    });
+
+    runner.run("weekQuery", size, [&]() {
+        qint64 from = firstUtc + qint64(random.bounded(spanDays)) * 86400;
+        for (const Calendar* calendar : calendars) {
+            sink += calendar->getEventsBetween(from, from + 7 * 86400).size();
+        }
+    });
+
+    runner.run("availability", size, [&]() {
+        qint64 start = firstUtc + qint64(random.bounded(spanDays * 96)) * 900;
+        for (const Calendar* calendar : calendars) {
+            sink += calendar->getConflicts(start, start + 1800).isEmpty() ? 1 : 0;
+        }
+    });
+
+    qDeleteAll(calendars);
+    qDeleteAll(users);
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("calendarbench");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Benchmarks ICS ingest, calendar indexing and availability queries.");
+    parser.addHelpOption();
+    QCommandLineOption sizesOption("sizes", "Comma separated workload sizes in events.", "list", "1000,100000,1000000");
+    QCommandLineOption filterOption("filter", "Only run benchmarks whose name contains this text.", "text");
+    QCommandLineOption jsonOption("json", "Write the results as JSON to this file.", "path");
+    QCommandLineOption minTimeOption("min-time", "Minimum time of repeated benchmarks, in ms.", "ms", "500");
+    QCommandLineOption baselineOption("baseline", "Fail if events/s dropped compared to this JSON report.", "path");
+    QCommandLineOption maxRegressionOption("max-regression", "Allowed events/s drop against the baseline, in percent.",
+                                           "percent", "10");
+    parser.addOptions({sizesOption, filterOption, jsonOption, minTimeOption, baselineOption, maxRegressionOption});
+    parser.process(app);
+
+    QList<qint64> sizes;
+    for (const QString& size : parser.value(sizesOption).split(',', Qt::SkipEmptyParts)) {
+        sizes.append(qMax(1LL, size.toLongLong()));
+    }
+    QString filter = parser.value(filterOption);
+    auto selected = [&](const QString& name) { return filter.isEmpty() || name.contains(filter); };
+
+    BenchmarkRunner runner(parser.value(minTimeOption).toLongLong());
+    for (qint64 size : sizes) {
+        if (selected("parseICSDateTime")) benchDateTime(runner, size);
+        if (selected("parseICSEvent")) benchIngest(runner, size, false);
+        if (selected("loadICSFile")) benchIngest(runner, size, true);
+        if (selected("Calendar::")) benchMutations(runner, size);
+        if (selected("Calendar::editText")) benchTextEdit(runner, size);
+        if (selected("IcsWriter")) benchExport(runner, size);
+        if (selected("dayQuery") || selected("weekQuery") || selected("availability")) benchQueries(runner, size);
+    }
+
+    QTextStream out(stdout);
+    out << runner.toText();
+
+    if (parser.isSet(jsonOption)) {
+        QFile file(parser.value(jsonOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QTextStream(stderr) << "Cannot write " << file.fileName() << "\n";
+            return 1;
+        }
+        file.write(runner.toJson().toJson());
+    }
+
+    if (parser.isSet(baselineOption)) {
+        QFile file(parser.value(baselineOption));
+        if (!file.open(QIODevice::ReadOnly)) {
+            QTextStream(stderr) << "Cannot read " << file.fileName() << "\n";
+            return 1;
+        }
+
+        QJsonParseError error;
+        QJsonDocument baseline = QJsonDocument::fromJson(file.readAll(), &error);
+        if (error.error != QJsonParseError::NoError) {
+            QTextStream(stderr) << "Cannot parse " << file.fileName() << ": " << error.errorString() << "\n";
+            return 1;
+        }
+
+        QString report;
+        int compared = 0;
+        bool passed = runner.checkRegressions(baseline, parser.value(maxRegressionOption).toDouble(), report, compared);
+        out << "\nAgainst " << file.fileName() << "\n" << report;
+        if (compared == 0) {
+            // a baseline that matches nothing would otherwise pass every run
+            QTextStream(stderr) << "No benchmark of this run is in " << file.fileName() << "\n";
+            return 1;
+        }
+        if (!passed) {
+            out << "Throughput regressed by more than " << parser.value(maxRegressionOption) << "%\n";
+            return 2;
+        }
+    }
+    return 0;
+}
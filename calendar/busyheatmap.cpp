@@ -0,0 +1,88 @@
+/**
+ * @file busyheatmap.cpp
+ * @brief Implementation of the BusyHeatmap class
+ */
+#include "busyheatmap.h"
+#include "trace.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Gets the busy fraction of a day.
+ * @param date The day.
+ * @return The fraction, or 0 for days outside the result.
+ */
+double BusyHeatmap::Result::busyOn(const QDate& date) const {
+    if (!firstDay.isValid()) return 0;
+
+    qint64 index = firstDay.daysTo(date);
+    return index >= 0 && index < busy.size() ? busy[index] : 0;
+}
+
+/**
+ * @brief Computes the heatmap of a date range.
+ * @param calendars Snapshots of the users' calendars.
+ * @param userIDs The owners of the calendars, stored in the result.
+ * @param firstDay The first day.
+ * @param dayCount The number of days.
+ * @param version The calendar version the snapshots were taken at.
+ * @return The average busy fraction of each day's working hours.
+ *
+ * Each calendar is queried once for the whole range. Its intervals are merged
+ * in one sweep by start, so overlapping events are not counted twice, and the
+ * merged intervals are walked together with the days' working windows.
+ */
+BusyHeatmap::Result BusyHeatmap::compute(const QList<std::shared_ptr<const Calendar::Snapshot>>& calendars,
+                                         const QList<qint64>& userIDs, const QDate& firstDay, int dayCount,
+                                         quint64 version) {
+    TRACE_SCOPE("BusyHeatmap::compute");
+    Result result{firstDay, QList<double>(dayCount, 0.0), userIDs, version};
+    if (calendars.isEmpty() || dayCount <= 0) return result;
+
+    // working window of every day, in UTC
+    QList<qint64> windowStart(dayCount);
+    QList<qint64> windowEnd(dayCount);
+    for (int day = 0; day < dayCount; day++) {
+        QDate date = firstDay.addDays(day);
+        windowStart[day] = QDateTime(date, QTime(workdayStartHour, 0)).toSecsSinceEpoch();
+        windowEnd[day] = QDateTime(date, QTime(workdayEndHour, 0)).toSecsSinceEpoch();
+    }
+
+    std::vector<std::pair<qint64, qint64>> intervals;
+    QList<double> busySeconds(dayCount, 0.0);
+    for (const std::shared_ptr<const Calendar::Snapshot>& snapshot : calendars) {
+        intervals.clear();
+        for (const Event* event : snapshot->intervals.overlapping(windowStart.first() - instantBusySeconds,
+                                                                  windowEnd.last())) {
+            qint64 end = qMax(event->getEndUtc(), event->getStartUtc() + instantBusySeconds);
+            intervals.emplace_back(event->getStartUtc(), end);
+        }
+        std::sort(intervals.begin(), intervals.end());
+
+        int day = 0;
+        for (size_t i = 0; i < intervals.size() && day < dayCount;) {
+            // merge everything overlapping this interval
+            qint64 start = intervals[i].first;
+            qint64 end = intervals[i].second;
+            for (i++; i < intervals.size() && intervals[i].first <= end; i++) {
+                end = qMax(end, intervals[i].second);
+            }
+
+            while (day < dayCount && windowEnd[day] <= start) {
+                day++;
+            }
+            for (int d = day; d < dayCount && windowStart[d] < end; d++) {
+                qint64 overlap = qMin(end, windowEnd[d]) - qMax(start, windowStart[d]);
+                if (overlap > 0) {
+                    busySeconds[d] += double(overlap) / double(windowEnd[d] - windowStart[d]);
+                }
+            }
+        }
+    }
+
+    for (int day = 0; day < dayCount; day++) {
+        result.busy[day] = busySeconds[day] / calendars.size();
+    }
+    return result;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file busyheatmap.h
+ * @brief Defines the BusyHeatmap class.
+ *
+ * Computes how busy everyone is on each day of a date range.
+ */
+#ifndef BUSYHEATMAP_H
+#define BUSYHEATMAP_H
+
+#include <QDate>
+#include <QList>
+#include <memory>
+#include "calendar.h"
+
+/**
+ * @class BusyHeatmap
+ * @brief Fraction of the working hours each day that users are busy.
+ *
+ * compute() only reads calendar snapshots, so it can run on a worker thread.
+ * A result remembers the calendar version it was computed at, so it can be
+ * reused until a calendar changes.
+ */
+class BusyHeatmap {
+public:
+    /**
+     * @struct Result
+     * @brief The busy fraction of each day, averaged over the users.
+     */
+    struct Result {
+        QDate firstDay;
+        QList<double> busy; // one value in [0, 1] per day from firstDay
+        QList<qint64> userIDs; // the calendars it was computed from
+        quint64 version = 0;
+
+        double busyOn(const QDate& date) const;
+    };
+
+    // working hours, in local time
+    static constexpr int workdayStartHour = 9;
+    static constexpr int workdayEndHour = 17;
+    // events without a duration count as this long
+    static constexpr qint64 instantBusySeconds = 30 * 60;
+
+    static Result compute(const QList<std::shared_ptr<const Calendar::Snapshot>>& calendars,
+                          const QList<qint64>& userIDs, const QDate& firstDay, int dayCount, quint64 version);
+};
+
+#endif // BUSYHEATMAP_H
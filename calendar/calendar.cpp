@@ -3,21 +3,174 @@
  * @brief Implementation of the Calendar class
  */
 #include "calendar.h"
+#include "metrics.h"
+#include "trace.h"
+#include <QSet>
+#include <algorithm>
+#include <utility>
+
+std::atomic<quint64> Calendar::globalVersion{0};
+
+namespace {
+
+// a segment is rewritten once its unreferenced blocks outgrow both this and its live blocks
+constexpr qint64 minSegmentGarbage = 1024 * 1024;
+
+/**
+ * @brief Gets the month an event is spilled with.
+ * @param event The event.
+ * @return The first day of the month it starts in.
+ */
+QDate monthOf(const Event* event) {
+    QDate date = event->getDate().date();
+    return QDate(date.year(), date.month(), 1);
+}
+
+}
 
 /**
  * @brief Constructs a Calendar object.
  * @param ID The unique identifier for the calendar.
  * @param owner A pointer to the User object representing the calendar's owner.
  */
-Calendar::Calendar(int ID, User* owner)
-    : calendarID(ID), owner(owner) {}
+Calendar::Calendar(qint64 ID, User* owner)
+    : calendarID(ID), owner(owner),
+      state(std::make_shared<Snapshot>(Snapshot{QList<Event*>(), EventIdIndex(), QMap<QDate, QList<Event*>>(), DayBitmap(), IntervalIndex(), TextIndex(), {}, nullptr, std::make_shared<RetireEpoch>()})) {}
+
+/**
+ * @brief Destroys the calendar and the events it still holds.
+ * @note Callers must make sure no reader snapshot outlives the calendar.
+ */
+Calendar::~Calendar() {
+    std::shared_ptr<const Snapshot> current = state.load();
+    for (Event* event : current->events) {
+        current->epoch->retire(event);
+    }
+}
+
+/**
+ * @brief Publishes a new version of the calendar.
+ * @param current The version being replaced.
+ * @param next The new version, built from a copy of current.
+ * @note Must be called with writeMutex held.
+ */
+void Calendar::publish(const std::shared_ptr<const Snapshot>& current, Snapshot next) {
+    next.epoch = current->epoch->advance();
+    state.publish(std::make_shared<Snapshot>(std::move(next)));
+    globalVersion.fetch_add(1, std::memory_order_release);
+}
+
+/**
+ * @brief Adds an event to the date index of a new version.
+ * @param next The version being built.
+ * @param event The event to index.
+ */
+void Calendar::indexDate(Snapshot& next, Event* event) {
+    QDate date = event->getDate().date();
+    next.eventsByDate[date].append(event);
+    next.occupiedDays.set(date);
+}
+
+/**
+ * @brief Adds an event to every index of a new version.
+ * @param next The version being built.
+ * @param event The event to index.
+ */
+void Calendar::indexEvent(Snapshot& next, Event* event) {
+    indexDate(next, event);
+    next.ids.insert(event);
+    next.intervals.insert(event);
+    next.text.insert(event);
+}
+
+/**
+ * @brief Removes an event from the indexes of a new version.
+ * @param next The version being built.
+ * @param event The event to remove.
+ */
+void Calendar::unindexEvent(Snapshot& next, Event* event) {
+    next.ids.remove(event);
+    next.intervals.remove(event);
+    next.text.remove(event);
+
+    QDate date = event->getDate().date();
+    auto it = next.eventsByDate.find(date);
+    if (it == next.eventsByDate.end()) return;
+
+    it->removeOne(event);
+    if (it->isEmpty()) {
+        next.eventsByDate.erase(it);
+        next.occupiedDays.reset(date);
+    }
+}
+
+/**
+ * @brief Describes a change to one event for the ChangeBus.
+ * @param kind What happened to the event.
+ * @param event The event, or its new version when it moved.
+ * @param previousDay The day the event was on before it moved.
+ * @return The delta.
+ */
+ChangeBus::Delta Calendar::delta(ChangeBus::Delta::Kind kind, const Event* event, const QDate& previousDay) const {
+    return ChangeBus::Delta{kind, this, owner ? owner->getPersonID() : -1, event->getEventID(),
+                            event->getDate().date(), previousDay};
+}
 
 /**
  * @brief Adds an event to the calendar.
  * @param event A pointer to the Event object to add.
  */
 void Calendar::addEvent(Event* event) {
-    events.append(event);
+    if (!event) return;
+
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    Snapshot next = *current;
+    next.events.append(event);
+    indexEvent(next, event);
+    publish(current, std::move(next));
+    locker.unlock();
+
+    if (ChangeBus::getInstance()->isObserved()) {
+        ChangeBus::getInstance()->post({delta(ChangeBus::Delta::Added, event)});
+    }
+}
+
+/**
+ * @brief Adds several events and publishes them as one version.
+ * @param newEvents The events to add.
+ *
+ * Preferred for imports, since every publish copies the event list once.
+ */
+void Calendar::addEvents(const QList<Event*>& newEvents) {
+    TRACE_SCOPE("Calendar::addEvents");
+    if (newEvents.isEmpty()) return;
+
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    Snapshot next = *current;
+    next.events.reserve(next.events.size() + newEvents.size());
+    for (Event* event : newEvents) {
+        if (event) {
+            next.events.append(event);
+            indexDate(next, event);
+        }
+    }
+    next.ids.insert(newEvents);
+    next.intervals.insert(newEvents);
+    next.text.insert(newEvents);
+    publish(current, std::move(next));
+    locker.unlock();
+
+    // one batch for the whole import, the UI refreshes once
+    if (ChangeBus::getInstance()->isObserved()) {
+        QList<ChangeBus::Delta> deltas;
+        deltas.reserve(newEvents.size());
+        for (const Event* event : newEvents) {
+            if (event) deltas.append(delta(ChangeBus::Delta::Added, event));
+        }
+        ChangeBus::getInstance()->post(deltas);
+    }
 }
 
 /**
@@ -26,15 +179,138 @@ void Calendar::addEvent(Event* event) {
  * @return true if the event was successfully cancelled, false otherwise.
  */
 bool Calendar::cancelEvent(Event* event) {
-    return events.removeOne(event);
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    Snapshot next = *current;
+    if (!next.events.removeOne(event)) {
+        return false;
+    }
+    unindexEvent(next, event);
+    publish(current, std::move(next));
+    locker.unlock();
+
+    if (ChangeBus::getInstance()->isObserved()) {
+        ChangeBus::getInstance()->post({delta(ChangeBus::Delta::Removed, event)});
+    }
+    return true;
 }
 
 /**
- * @brief Gets all events in the calendar.
- * @return A list of all events in the calendar.
+ * @brief Gets all resident events in the calendar.
+ * @return The events of the months inside the horizon, or all of them without one.
  */
 QList<Event*> Calendar::getEvents() const {
-    return events;
+    return state.load()->events;
+}
+
+/**
+ * @brief Counts the events of the calendar, spilled ones included.
+ * @return The number of events.
+ */
+qint64 Calendar::eventCount() const {
+    std::shared_ptr<const Snapshot> current = state.load();
+    qint64 count = current->events.size();
+    for (const QList<EventSegment::Extent>& extents : current->spilled) {
+        for (const EventSegment::Extent& extent : extents) {
+            count += extent.count;
+        }
+    }
+    return count;
+}
+
+/**
+ * @brief Gets the events that start on a given date.
+ * @param date The date to look up.
+ * @return The events of that date, in insertion order.
+ *
+ * Served from the date index, so the cost does not depend on the calendar size.
+ */
+QList<Event*> Calendar::getEventsOn(const QDate& date) const {
+    return state.load()->eventsByDate.value(date);
+}
+
+/**
+ * @brief Gets the events overlapping a time range.
+ * @param fromUtc Start of the range, in seconds since the epoch (UTC).
+ * @param toUtc End of the range, exclusive.
+ * @return The events, served from the interval index.
+ *
+ * Events without a duration are included when they start inside the range.
+ */
+QList<Event*> Calendar::getEventsBetween(qint64 fromUtc, qint64 toUtc) const {
+    return state.load()->intervals.overlapping(fromUtc, toUtc);
+}
+
+/**
+ * @brief Checks whether the owner is free for a minute.
+ * @param startUtc The start to check, in seconds since the epoch (UTC).
+ * @return true if no event overlaps the minute starting then.
+ */
+bool Calendar::isFreeAt(qint64 startUtc) const {
+    return getConflicts(startUtc, startUtc).isEmpty();
+}
+
+/**
+ * @brief Finds the events whose text contains every word of a query, within a time range.
+ * @param query The words to look for in title, description, location and organizer name.
+ * @param fromUtc Start of the range, in seconds since the epoch (UTC).
+ * @param toUtc End of the range, exclusive.
+ * @return The matching events overlapping the range, by start time.
+ *
+ * Served from the text index; the range only filters its hits.
+ * @note Hold a snapshot() while using the events, they may be removed meanwhile.
+ */
+QList<Event*> Calendar::search(QStringView query, qint64 fromUtc, qint64 toUtc) const {
+    return search(*state.load(), query, fromUtc, toUtc);
+}
+
+/**
+ * @brief Finds the events of one version whose text contains every word of a query.
+ * @param snapshot The version to search; its events stay valid while the caller holds it.
+ * @param query The words to look for in title, description, location and organizer name.
+ * @param fromUtc Start of the range, in seconds since the epoch (UTC).
+ * @param toUtc End of the range, exclusive.
+ * @return The matching events overlapping the range, by start time.
+ */
+QList<Event*> Calendar::search(const Snapshot& snapshot, QStringView query, qint64 fromUtc, qint64 toUtc) {
+    QList<Event*> hits = snapshot.text.search(query);
+    hits.removeIf([fromUtc, toUtc](const Event* event) {
+        qint64 start = event->getStartUtc();
+        return !(start < toUtc && (event->getEndUtc() > fromUtc || start >= fromUtc));
+    });
+    std::sort(hits.begin(), hits.end(),
+              [](const Event* a, const Event* b) { return a->getStartUtc() < b->getStartUtc(); });
+    return hits;
+}
+
+/**
+ * @brief Gets the events clashing with a time slot.
+ * @param startUtc Start of the slot, in seconds since the epoch (UTC).
+ * @param endUtc End of the slot; a slot without a duration is checked as one minute.
+ * @param ignoredEventID An event not to report, such as the one being edited.
+ * @return The overlapping events, served from the interval index.
+ */
+QList<Event*> Calendar::getConflicts(qint64 startUtc, qint64 endUtc, qint64 ignoredEventID) const {
+    Metrics::add(Metrics::AvailabilityQueries);
+    QList<Event*> conflicts = state.load()->intervals.overlapping(startUtc, qMax(endUtc, startUtc + 60));
+    conflicts.removeIf([ignoredEventID](const Event* event) { return event->getEventID() == ignoredEventID; });
+    return conflicts;
+}
+
+/**
+ * @brief Gets the current immutable version of the calendar.
+ * @return A snapshot whose events stay alive for as long as it is held.
+ */
+std::shared_ptr<const Calendar::Snapshot> Calendar::snapshot() const {
+    return state.load();
+}
+
+/**
+ * @brief Gets a counter bumped every time any calendar publishes a version.
+ * @return The counter; results computed from snapshots stay valid while it is unchanged.
+ */
+quint64 Calendar::getGlobalVersion() {
+    return globalVersion.load(std::memory_order_acquire);
 }
 
 /**
@@ -48,28 +324,286 @@ User* Calendar::getOwner() const{
 /**
  * @brief Removes an event from the calendar.
  * @param event A pointer to the Event object to remove.
- * @note The event is deleted from memory.
+ * @return true if the event was in the calendar.
+ * @note The event is deleted once no snapshot refers to it anymore; an event
+ *       that was not in the calendar is left to the caller.
  */
-void Calendar::removeEvent(Event* event) {
-    if (!event) return;
+bool Calendar::removeEvent(Event* event) {
+    if (!event) return false;
+
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    if (current->ids.find(event->getEventID()) != event) return false;
+
+    Snapshot next = *current;
+    next.events.removeOne(event);
+    // the event may be freed once published, describe it first
+    ChangeBus::Delta removed = delta(ChangeBus::Delta::Removed, event);
+    unindexEvent(next, event);
+    current->epoch->retire(event);
+    publish(current, std::move(next));
+    locker.unlock();
 
-    events.removeOne(event);
-    delete event;
+    if (ChangeBus::getInstance()->isObserved()) {
+        ChangeBus::getInstance()->post({removed});
+    }
+    return true;
 }
 
 /**
  * @brief Updates an event in the calendar.
  * @param event A pointer to the updated Event object.
+ * @return true if the calendar holds the event now; otherwise it is left to the caller.
  * @note The existing event is replaced with the updated event.
  */
-void Calendar::updateEvent(Event* event) {
-    if (!event) return;
+bool Calendar::updateEvent(Event* event) {
+    if (!event) return false;
+
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    Event* existing = current->ids.find(event->getEventID());
+    if (!existing || existing == event) return existing == event;
+
+    Snapshot next = *current;
+    QDate previousDay = existing->getDate().date();
+    unindexEvent(next, existing);
+    next.events[next.events.indexOf(existing)] = event;
+    indexEvent(next, event);
+    current->epoch->retire(existing);
+    publish(current, std::move(next));
+    locker.unlock();
+
+    if (ChangeBus::getInstance()->isObserved()) {
+        ChangeBus::getInstance()->post({delta(ChangeBus::Delta::Moved, event, previousDay)});
+    }
+    return true;
+}
+
+/**
+ * @brief Applies several mutations and publishes them as one version.
+ * @param changes The mutations, applied in order.
+ * @param detach Leave replaced and removed events to the caller instead of deleting them.
+ * @return The changes that took effect, in order; updates carry the version they replaced.
+ *
+ * Readers see either none or all of the changes. Updates of an event that is
+ * not in the calendar and removals of such an event change nothing and are left
+ * out of the result. Unless detached, replaced and removed events are deleted
+ * once no snapshot refers to them anymore. Detached events can be added again
+ * or handed to retire().
+ */
+QList<Calendar::Change> Calendar::apply(const QList<Change>& changes, bool detach) {
+    TRACE_SCOPE("Calendar::apply");
+    QList<Change> applied;
+    if (changes.isEmpty()) return applied;
 
-    for(int i = 0; i < events.size(); i++) {
-        if (events[i]->getEventID() == event->getEventID()) {
-            delete events[i];
-            events[i] = event;
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    Snapshot next = *current;
+    bool observed = ChangeBus::getInstance()->isObserved();
+    QList<ChangeBus::Delta> deltas;
+
+    for (const Change& change : changes) {
+        Event* event = change.event;
+        if (!event) continue;
+
+        switch (change.kind) {
+        case Change::Add:
+            next.events.append(event);
+            indexEvent(next, event);
+            if (observed) deltas.append(delta(ChangeBus::Delta::Added, event));
+            applied.append({Change::Add, event});
+            break;
+        case Change::Update:
+            if (Event* existing = next.ids.find(event->getEventID())) {
+                if (observed) deltas.append(delta(ChangeBus::Delta::Moved, event, existing->getDate().date()));
+                unindexEvent(next, existing);
+                next.events[next.events.indexOf(existing)] = event;
+                indexEvent(next, event);
+                if (existing != event && !detach) {
+                    current->epoch->retire(existing);
+                }
+                applied.append({Change::Update, event, existing});
+            }
+            break;
+        case Change::Remove:
+            if (next.ids.find(event->getEventID()) == event) {
+                next.events.removeOne(event);
+                if (observed) deltas.append(delta(ChangeBus::Delta::Removed, event));
+                unindexEvent(next, event);
+                if (!detach) {
+                    current->epoch->retire(event);
+                }
+                applied.append({Change::Remove, event});
+            }
             break;
         }
     }
+
+    if (!applied.isEmpty()) {
+        publish(current, std::move(next));
+        locker.unlock();
+        ChangeBus::getInstance()->post(deltas);
+    }
+    return applied;
+}
+
+/**
+ * @brief Deletes an event detached by apply() once no snapshot refers to it anymore.
+ * @param event The detached event; it must not be in the calendar.
+ */
+void Calendar::retire(Event* event) {
+    QMutexLocker locker(&writeMutex);
+    state.load()->epoch->retire(event);
+}
+
+/**
+ * @brief Checks whether the month of a day is inside a horizon.
+ * @param day The day.
+ * @param ranges The date ranges of the horizon, inclusive; none keeps every month.
+ * @return true if the month overlaps one of the ranges, so its events stay resident.
+ */
+bool Calendar::isResident(const QDate& day, const QList<QPair<QDate, QDate>>& ranges) {
+    if (ranges.isEmpty()) return true;
+
+    QDate month(day.year(), day.month(), 1);
+    for (const QPair<QDate, QDate>& range : ranges) {
+        if (month <= range.second && month.addMonths(1) > range.first) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Keeps only the months of a horizon in memory.
+ * @param ranges Date ranges, inclusive; every month overlapping one stays resident.
+ *               With no ranges, every month is resident.
+ *
+ * Spilled months now inside the horizon are read back and indexed, resident
+ * months now outside are written to the segment as one block each and their
+ * events retired. Both are published as one version and announced as added
+ * and removed events, so views follow as for any other change. A month that
+ * cannot be written stays resident.
+ * @note Events are spilled by their start; events added to a spilled month since
+ *       the last call stay resident until the next one.
+ */
+void Calendar::setHorizon(const QList<QPair<QDate, QDate>>& ranges) {
+    TRACE_SCOPE("Calendar::setHorizon");
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    bool observed = ChangeBus::getInstance()->isObserved();
+    QList<ChangeBus::Delta> deltas;
+
+    // months to page in, and resident events to page out by month
+    QList<QDate> inside;
+    for (auto it = current->spilled.cbegin(); it != current->spilled.cend(); ++it) {
+        if (isResident(it.key(), ranges)) {
+            inside.append(it.key());
+        }
+    }
+    QMap<QDate, QList<Event*>> outside;
+    for (Event* event : current->events) {
+        QDate month = monthOf(event);
+        if (!isResident(month, ranges)) {
+            outside[month].append(event);
+        }
+    }
+    if (inside.isEmpty() && outside.isEmpty()) return;
+
+    Snapshot next = *current;
+    QList<Event*> loaded;
+    for (const QDate& month : inside) {
+        for (const EventSegment::Extent& extent : next.spilled.take(month)) {
+            loaded += next.segment->read(extent, owner);
+        }
+    }
+    next.events.reserve(next.events.size() + loaded.size());
+    for (Event* event : loaded) {
+        next.events.append(event);
+        indexDate(next, event);
+        if (observed) deltas.append(delta(ChangeBus::Delta::Added, event));
+    }
+    next.ids.insert(loaded);
+    next.intervals.insert(loaded);
+    next.text.insert(loaded);
+
+    QSet<const Event*> spilled;
+    for (auto it = outside.cbegin(); it != outside.cend(); ++it) {
+        if (!next.segment) {
+            next.segment = std::make_shared<EventSegment>();
+        }
+        EventSegment::Extent extent;
+        if (!next.segment->append(*it, extent)) continue;
+
+        next.spilled[it.key()].append(extent);
+        for (Event* event : *it) {
+            if (observed) deltas.append(delta(ChangeBus::Delta::Removed, event));
+            unindexEvent(next, event);
+            current->epoch->retire(event);
+            spilled.insert(event);
+        }
+    }
+    if (!spilled.isEmpty()) {
+        next.events.removeIf([&spilled](const Event* event) { return spilled.contains(event); });
+    }
+    Metrics::add(Metrics::EventsPagedIn, loaded.size());
+    Metrics::add(Metrics::EventsPagedOut, spilled.size());
+
+    compactSegment(next);
+    publish(current, std::move(next));
+    locker.unlock();
+
+    if (!deltas.isEmpty()) {
+        ChangeBus::getInstance()->post(deltas);
+    }
+}
+
+/**
+ * @brief Moves the live blocks of a new version to a fresh segment once most of its file is garbage.
+ * @param next The version being built.
+ *
+ * Blocks read back are left in the file, older snapshots may still refer to them.
+ * The old segment is removed once the last of those snapshots is released.
+ */
+void Calendar::compactSegment(Snapshot& next) {
+    if (!next.segment) return;
+    if (next.spilled.isEmpty()) {
+        next.segment.reset();
+        return;
+    }
+
+    qint64 live = 0;
+    for (const QList<EventSegment::Extent>& extents : std::as_const(next.spilled)) {
+        for (const EventSegment::Extent& extent : extents) {
+            live += extent.size;
+        }
+    }
+    if (next.segment->size() - live <= qMax(live, minSegmentGarbage)) return;
+
+    TRACE_SCOPE("Calendar::compactSegment");
+    std::shared_ptr<EventSegment> fresh = std::make_shared<EventSegment>();
+    QMap<QDate, QList<EventSegment::Extent>> moved;
+    for (auto it = next.spilled.cbegin(); it != next.spilled.cend(); ++it) {
+        for (const EventSegment::Extent& extent : *it) {
+            EventSegment::Extent copied;
+            if (!next.segment->copy(extent, *fresh, copied)) return; // keep the old file
+            moved[it.key()].append(copied);
+        }
+    }
+    next.spilled = moved;
+    next.segment = fresh;
+}
+
+/**
+ * @brief Reads a spilled block of a snapshot back.
+ * @param snapshot The snapshot listing the block in spilled.
+ * @param extent The block.
+ * @return New events owned by the caller, organized by the owner of the calendar.
+ *
+ * For exports and journal compactions, which need every event without
+ * making them resident.
+ */
+QList<Event*> Calendar::readSpilled(const std::shared_ptr<const Snapshot>& snapshot,
+                                    const EventSegment::Extent& extent) const {
+    return snapshot->segment ? snapshot->segment->read(extent, owner) : QList<Event*>();
 }
@@ -8,32 +8,117 @@
 #define CALENDAR_H
 
 #include <QList>
+#include <QMap>
+#include <QDate>
+#include <QMutex>
+#include <QPair>
+#include <memory>
+#include <atomic>
 #include "event.h"
 #include "user.h"
+#include "snapshot.h"
+#include "daybitmap.h"
+#include "eventidindex.h"
+#include "intervalindex.h"
+#include "textindex.h"
+#include "eventsegment.h"
+#include "changebus.h"
 
 /**
  * @class Calendar
  * @brief Represents a calendar with events and an owner.
  * 
  * The Calendar class represents a calendar that contains events and is owned by a user.
+ * Mutations are serialized by a write lock and published as immutable snapshots,
+ * so other threads can read the events without locking. Each published mutation
+ * is then announced on the ChangeBus.
+ *
+ * A publish copies the resident event list and the interval index, a memcpy of
+ * O(n) pointers and entries, plus the date, ID and text index buckets it touches.
+ * Events are found by ID through the ID index. Batch mutations with addEvents()
+ * or apply() so they share one copy.
+ *
+ * With a horizon set, only the months inside it are resident; the events of
+ * every other month are spilled to an EventSegment on disk and read back when
+ * the horizon moves over them again.
  */
 class Calendar {
+public:
+    /**
+     * @struct Snapshot
+     * @brief Immutable view of the calendar's events and indexes at one point in time.
+     */
+    struct Snapshot {
+        QList<Event*> events;
+        EventIdIndex ids;
+        QMap<QDate, QList<Event*>> eventsByDate;
+        DayBitmap occupiedDays; // days with at least one event, for the calendar layers
+        IntervalIndex intervals;
+        TextIndex text;
+        QMap<QDate, QList<EventSegment::Extent>> spilled; // events paged out, by first day of their month
+        std::shared_ptr<EventSegment> segment;            // holds the spilled blocks
+        std::shared_ptr<RetireEpoch> epoch;
+    };
+
+    /**
+     * @struct Change
+     * @brief One mutation of a batch applied by apply().
+     */
+    struct Change {
+        enum Kind {
+            Add,
+            Update, // replaces the event with the same ID
+            Remove
+        };
+        Kind kind;
+        Event* event;
+        Event* previous = nullptr; // the replaced version, set by apply() for applied updates
+    };
+
 private:
-    int calendarID;
+    qint64 calendarID;
     User* owner;
-    QList<Event*> events;
+    SnapshotCell<Snapshot> state;
+    QMutex writeMutex;
+    static std::atomic<quint64> globalVersion;
+
+    void publish(const std::shared_ptr<const Snapshot>& current, Snapshot next);
+    static void indexDate(Snapshot& next, Event* event);
+    static void indexEvent(Snapshot& next, Event* event);
+    static void unindexEvent(Snapshot& next, Event* event);
+    static void compactSegment(Snapshot& next);
+    ChangeBus::Delta delta(ChangeBus::Delta::Kind kind, const Event* event, const QDate& previousDay = QDate()) const;
 
 public:
-    Calendar(int ID, User* owner);
+    Calendar(qint64 ID, User* owner);
+    ~Calendar();
+    Calendar(const Calendar&) = delete;
+    Calendar& operator=(const Calendar&) = delete;
 
     void addEvent(Event* event);
+    void addEvents(const QList<Event*>& newEvents);
     bool cancelEvent(Event* event);
     QList<Event*> getEvents() const;
+    qint64 eventCount() const;
+    QList<Event*> getEventsOn(const QDate& date) const;
+    QList<Event*> getEventsBetween(qint64 fromUtc, qint64 toUtc) const;
+    bool isFreeAt(qint64 startUtc) const;
+    QList<Event*> search(QStringView query, qint64 fromUtc, qint64 toUtc) const;
+    static QList<Event*> search(const Snapshot& snapshot, QStringView query, qint64 fromUtc, qint64 toUtc);
+    QList<Event*> getConflicts(qint64 startUtc, qint64 endUtc, qint64 ignoredEventID = -1) const;
+    std::shared_ptr<const Snapshot> snapshot() const;
+    static quint64 getGlobalVersion();
 
     User* getOwner() const;
 
-    void removeEvent(Event* event);
-    void updateEvent(Event* event);
+    bool removeEvent(Event* event);
+    bool updateEvent(Event* event);
+    QList<Change> apply(const QList<Change>& changes, bool detach = false);
+    void retire(Event* event);
+
+    void setHorizon(const QList<QPair<QDate, QDate>>& ranges);
+    static bool isResident(const QDate& day, const QList<QPair<QDate, QDate>>& ranges);
+    QList<Event*> readSpilled(const std::shared_ptr<const Snapshot>& snapshot, const EventSegment::Extent& extent) const;
 };
 
 
@@ -1,6 +1,6 @@
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets concurrent
 
 CONFIG += c++17
 
@@ -8,32 +8,28 @@ CONFIG += c++17
 # In order to do so, uncomment the following line.
 #DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
+include(core.pri)
+
 SOURCES += \
-    calendar.cpp \
-    calendarmanager.cpp \
+    calendarhighlighter.cpp \
     calendarstyle.cpp \
-    event.cpp \
-    eventactions.cpp \
-    eventbuilder.cpp \
     eventdialog.cpp \
+    eventlistmodel.cpp \
+    layeredcalendarwidget.cpp \
     main.cpp \
     mainwindow.cpp \
-    person.cpp \
-    user.cpp \
-    usermanager.cpp
+    searchdialog.cpp \
+    timelineview.cpp
 
 HEADERS += \
-    calendar.h \
-    calendarmanager.h \
+    calendarhighlighter.h \
     calendarstyle.h \
-    event.h \
-    eventactions.h \
-    eventbuilder.h \
     eventdialog.h \
+    eventlistmodel.h \
+    layeredcalendarwidget.h \
     mainwindow.h \
-    person.h \
-    user.h \
-    usermanager.h
+    searchdialog.h \
+    timelineview.h
 
 FORMS += \
     mainwindow.ui
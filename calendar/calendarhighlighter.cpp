@@ -0,0 +1,265 @@
+/**
+ * @file calendarhighlighter.cpp
+ * @brief Implementation of the CalendarHighlighter class
+ */
+#include "calendarhighlighter.h"
+#include "trace.h"
+#include "usermanager.h"
+#include <QTextCharFormat>
+
+/**
+ * @brief Constructs a highlighter for a calendar widget.
+ * @param widget The calendar widget to highlight.
+ */
+CalendarHighlighter::CalendarHighlighter(LayeredCalendarWidget* widget) : widget(widget) {
+    QDate first(widget->yearShown(), widget->monthShown(), 1);
+    pageStart = first.addDays(-7);
+    pageEnd = first.addDays(42);
+    widget->setHighlighter(this);
+}
+
+/**
+ * @brief Gets the highlight state a day should have.
+ * @param date The day.
+ * @return CreatedEvents if the day has created events.
+ */
+CalendarHighlighter::DayState CalendarHighlighter::stateOf(const QDate& date) const {
+    return createdCounts.value(date, 0) > 0 ? CreatedEvents : NoEvents;
+}
+
+/**
+ * @brief Gets the colours of the visible users with events on a day.
+ * @param date The day.
+ * @return One colour per user, in user order.
+ *
+ * Days outside every visible layer are answered from the combined bitmap alone.
+ */
+QList<QColor> CalendarHighlighter::layerColorsOn(const QDate& date) const {
+    QList<QColor> colors;
+    if (!visibleDays.test(date)) return colors;
+
+    for (auto it = layers.cbegin(); it != layers.cend(); ++it) {
+        if (!hiddenUsers.contains(it.key()) && it->days.test(date)) {
+            colors.append(it->color);
+        }
+    }
+    return colors;
+}
+
+/**
+ * @brief Adjusts the created count of a day and pushes its format if needed.
+ * @param date The day.
+ * @param delta Change in created events.
+ */
+void CalendarHighlighter::changeCreated(const QDate& date, int delta) {
+    if (!date.isValid()) return;
+
+    int& count = createdCounts[date];
+    count = qMax(0, count + delta);
+    if (count == 0) {
+        createdCounts.remove(date);
+    }
+
+    if (date >= pageStart && date <= pageEnd) {
+        push(date);
+    }
+}
+
+/**
+ * @brief Applies the format of a day to the widget if it differs from the last one pushed.
+ * @param date The day.
+ */
+void CalendarHighlighter::push(const QDate& date) {
+    DayState state = stateOf(date);
+    if (pushed.value(date, NoEvents) == state) return;
+
+    QTextCharFormat format;
+    if (state == CreatedEvents) {
+        format.setBackground(Qt::lightGray);
+    }
+    widget->setDateTextFormat(date, format);
+
+    if (state == NoEvents) {
+        pushed.remove(date);
+    } else {
+        pushed[date] = state;
+    }
+}
+
+/**
+ * @brief Recombines the visible layers into one bitmap.
+ *
+ * Costs one OR per occupied 64-day word of each visible layer.
+ */
+void CalendarHighlighter::uniteVisibleLayers() {
+    visibleDays.clear();
+    for (auto it = layers.cbegin(); it != layers.cend(); ++it) {
+        if (!hiddenUsers.contains(it.key())) {
+            visibleDays |= it->days;
+        }
+    }
+}
+
+/**
+ * @brief Records a created event.
+ * @param date The date of the event.
+ */
+void CalendarHighlighter::addCreated(const QDate& date) {
+    changeCreated(date, 1);
+}
+
+/**
+ * @brief Forgets a created event.
+ * @param date The date of the event.
+ */
+void CalendarHighlighter::removeCreated(const QDate& date) {
+    changeCreated(date, -1);
+}
+
+/**
+ * @brief Adjusts the created counts of several days at once.
+ * @param deltas Net change in created events, by day.
+ *
+ * Each day is pushed at most once, however many events moved on it.
+ */
+void CalendarHighlighter::changeCreated(const QHash<QDate, int>& deltas) {
+    for (auto it = deltas.cbegin(); it != deltas.cend(); ++it) {
+        if (it.value() != 0) {
+            changeCreated(it.key(), it.value());
+        }
+    }
+}
+
+/**
+ * @brief Sets a user's layer from their calendar.
+ * @param userID The ID of the user.
+ * @param calendar The user's calendar, after the change.
+ *
+ * Takes the calendar's occupancy bitmap as is; the copy is shared, not duplicated.
+ */
+void CalendarHighlighter::setLayer(qint64 userID, const Calendar* calendar) {
+    TRACE_SCOPE("CalendarHighlighter::setLayer");
+    if (!calendar) return;
+
+    Layer& layer = layers[userID];
+    layer.color = UserManager::getInstance()->getUserColor(userID);
+    layer.days = calendar->snapshot()->occupiedDays;
+
+    if (!hiddenUsers.contains(userID)) {
+        uniteVisibleLayers();
+        widget->refreshCells();
+    }
+}
+
+/**
+ * @brief Forgets a user's layer.
+ * @param userID The ID of the removed user.
+ */
+void CalendarHighlighter::removeUser(qint64 userID) {
+    TRACE_SCOPE("CalendarHighlighter::removeUser");
+    bool wasVisible = layers.remove(userID) > 0 && !hiddenUsers.contains(userID);
+    hiddenUsers.remove(userID);
+
+    if (wasVisible) {
+        uniteVisibleLayers();
+        widget->refreshCells();
+    }
+}
+
+/**
+ * @brief Shows or hides a user's layer.
+ * @param userID The ID of the user.
+ * @param visible Whether the user's days are painted.
+ *
+ * Showing ORs the layer into the visible days, hiding recombines the remaining layers.
+ */
+void CalendarHighlighter::setUserVisible(qint64 userID, bool visible) {
+    TRACE_SCOPE("CalendarHighlighter::setUserVisible");
+    if (visible == isUserVisible(userID)) return;
+
+    if (visible) {
+        hiddenUsers.remove(userID);
+        auto it = layers.constFind(userID);
+        if (it != layers.cend()) {
+            visibleDays |= it->days;
+        }
+    } else {
+        hiddenUsers.insert(userID);
+        uniteVisibleLayers();
+    }
+    widget->refreshCells();
+}
+
+/**
+ * @brief Checks whether a user's layer is shown.
+ * @param userID The ID of the user.
+ * @return false if the user was hidden.
+ */
+bool CalendarHighlighter::isUserVisible(qint64 userID) const {
+    return !hiddenUsers.contains(userID);
+}
+
+/**
+ * @brief Recomputes the counts and layers from the calendars' indexes.
+ * @param createdCalendar The calendar of created events.
+ * @param importedCalendars The calendars of imported events.
+ *
+ * Only meant for resynchronizing; mutations should use the incremental methods.
+ * Hidden users stay hidden.
+ */
+void CalendarHighlighter::rebuild(const Calendar* createdCalendar, const QList<Calendar*>& importedCalendars) {
+    TRACE_SCOPE("CalendarHighlighter::rebuild");
+    createdCounts.clear();
+    layers.clear();
+
+    if (createdCalendar) {
+        std::shared_ptr<const Calendar::Snapshot> snapshot = createdCalendar->snapshot();
+        for (auto it = snapshot->eventsByDate.cbegin(); it != snapshot->eventsByDate.cend(); ++it) {
+            createdCounts[it.key()] += it.value().size();
+        }
+    }
+    for (const Calendar* calendar : importedCalendars) {
+        if (!calendar || calendar == createdCalendar) continue;
+
+        qint64 userID = calendar->getOwner()->getPersonID();
+        layers[userID] = Layer{UserManager::getInstance()->getUserColor(userID), calendar->snapshot()->occupiedDays};
+    }
+    uniteVisibleLayers();
+
+    for (QDate date = pageStart; date <= pageEnd; date = date.addDays(1)) {
+        push(date);
+    }
+    widget->refreshCells();
+}
+
+/**
+ * @brief Pushes the days of a newly shown page.
+ * @param year The year shown.
+ * @param month The month shown.
+ *
+ * Connected to QCalendarWidget::currentPageChanged. Days whose format is already
+ * right are left untouched.
+ */
+void CalendarHighlighter::setVisiblePage(int year, int month) {
+    TRACE_SCOPE("CalendarHighlighter::setVisiblePage");
+    // the month grid shows at most a week before the 1st and six weeks from it
+    QDate first(year, month, 1);
+    pageStart = first.addDays(-7);
+    pageEnd = first.addDays(42);
+
+    for (QDate date = pageStart; date <= pageEnd; date = date.addDays(1)) {
+        push(date);
+    }
+}
+
+/**
+ * @brief Adds the day counts and the combined layer to a memory report.
+ * @param report The report.
+ *
+ * The layers themselves share their words with the calendar snapshots.
+ */
+void CalendarHighlighter::reportMemory(MemoryReport& report) const {
+    qint64 bytes = MemoryReport::hashBytes(createdCounts) + MemoryReport::hashBytes(pushed)
+                   + MemoryReport::mapBytes(layers) + MemoryReport::hashBytes(visibleDays.getWords());
+    report.addCache("CalendarHighlighter", bytes);
+}
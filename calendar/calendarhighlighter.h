@@ -0,0 +1,78 @@
+/**
+ * @file calendarhighlighter.h
+ * @brief Defines the CalendarHighlighter class.
+ *
+ * Keeps the per-day highlight state and the user layers of the month view up to date incrementally.
+ */
+#ifndef CALENDARHIGHLIGHTER_H
+#define CALENDARHIGHLIGHTER_H
+
+#include <QColor>
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include "calendar.h"
+#include "daybitmap.h"
+#include "event.h"
+#include "layeredcalendarwidget.h"
+#include "memoryreport.h"
+
+/**
+ * @class CalendarHighlighter
+ * @brief Maintains per-day event counts and user layers for a LayeredCalendarWidget.
+ *
+ * Days with created events are gray. Mutations adjust the counts of the touched
+ * days, and a day format is only pushed when its state actually changes and the
+ * day is on the visible page.
+ * Imported events are shown as one layer per user, taken from the occupancy
+ * bitmap of that user's calendar and painted in the user's colour. Hiding or
+ * showing a user only recombines the bitmaps, without looking at any event.
+ */
+class CalendarHighlighter {
+public:
+    enum DayState {
+        NoEvents,
+        CreatedEvents
+    };
+
+private:
+    struct Layer {
+        QColor color;
+        DayBitmap days;
+    };
+
+    LayeredCalendarWidget* widget;
+    QHash<QDate, int> createdCounts;
+    QHash<QDate, DayState> pushed;
+    QMap<qint64, Layer> layers;  // by user ID, painted in this order
+    QSet<qint64> hiddenUsers;
+    DayBitmap visibleDays;    // union of the visible layers
+    QDate pageStart;
+    QDate pageEnd;
+
+    void changeCreated(const QDate& date, int delta);
+    void push(const QDate& date);
+    void uniteVisibleLayers();
+
+public:
+    explicit CalendarHighlighter(LayeredCalendarWidget* widget);
+
+    DayState stateOf(const QDate& date) const;
+    QList<QColor> layerColorsOn(const QDate& date) const;
+
+    void addCreated(const QDate& date);
+    void removeCreated(const QDate& date);
+    void changeCreated(const QHash<QDate, int>& deltas);
+    void setLayer(qint64 userID, const Calendar* calendar);
+    void removeUser(qint64 userID);
+    void setUserVisible(qint64 userID, bool visible);
+    bool isUserVisible(qint64 userID) const;
+    void rebuild(const Calendar* createdCalendar, const QList<Calendar*>& importedCalendars);
+    void setVisiblePage(int year, int month);
+
+    void reportMemory(MemoryReport& report) const;
+};
+
+#endif // CALENDARHIGHLIGHTER_H
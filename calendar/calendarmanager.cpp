@@ -4,24 +4,20 @@
  */
 #include "calendarmanager.h"
 
-/**
- * @brief Initializes the CalendarManager instance.
- */
-CalendarManager* CalendarManager::instance = nullptr;
-
 /**
  * @brief Constructs a CalendarManager object.
  */
-CalendarManager::CalendarManager() {}
+CalendarManager::CalendarManager()
+    : state(std::make_shared<Snapshot>(Snapshot{QMap<qint64, Calendar*>(), std::make_shared<RetireEpoch>()})) {}
 
 /**
  * @brief Gets the singleton instance of CalendarManager.
  * @return A pointer to the CalendarManager instance.
+ *
+ * Initialization is thread-safe.
  */
 CalendarManager* CalendarManager::getInstance() {
-    if (instance == nullptr) {
-        instance = new CalendarManager();
-    }
+    static CalendarManager* instance = new CalendarManager();
     return instance;
 }
 
@@ -31,9 +27,15 @@ CalendarManager* CalendarManager::getInstance() {
  * @return A pointer to the new calendar.
  */
 Calendar* CalendarManager::createUserCalendar(User* user) {
-    int userID = user->getPersonID();
+    qint64 userID = user->getPersonID();
     Calendar* newCalendar = new Calendar(userID, user);
+
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    QMap<qint64, Calendar*> userCalendars = current->userCalendars;
+    current->epoch->retire(userCalendars.value(userID, nullptr));
     userCalendars[userID] = newCalendar;
+    state.publish(std::make_shared<Snapshot>(Snapshot{std::move(userCalendars), current->epoch->advance()}));
 
     return newCalendar;
 }
@@ -43,27 +45,82 @@ Calendar* CalendarManager::createUserCalendar(User* user) {
  * @param userID The ID of the user.
  * @return A pointer to the user's calendar, or nullptr if not found.
  */
-Calendar* CalendarManager::getUserCalendar(int userID) {
-    return userCalendars.value(userID, nullptr);
+Calendar* CalendarManager::getUserCalendar(qint64 userID) {
+    return state.load()->userCalendars.value(userID, nullptr);
 }
 
 /**
  * @brief Gets all calendars.
  * @return A list of all calendars.
+ * @note Worker threads should hold snapshot() instead, which keeps the calendars alive.
  */
 QList<Calendar*> CalendarManager::getAllCalendars() {
-    return userCalendars.values();
+    return state.load()->userCalendars.values();
+}
+
+/**
+ * @brief Gets the current immutable version of the calendar map.
+ * @return A snapshot whose calendars stay alive for as long as it is held.
+ */
+std::shared_ptr<const CalendarManager::Snapshot> CalendarManager::snapshot() const {
+    return state.load();
 }
 
 /**
  * @brief Deletes the calendar for a user.
  * @param userID The ID of the user.
- * @return A pointer to the deleted calendar, or nullptr if not found.
+ *
+ * The calendar is freed once no snapshot refers to it anymore.
  */
-void CalendarManager::deleteCalendar(int userID) {
-    if (userCalendars.contains(userID)) {
-        Calendar* calendar = userCalendars[userID];
-        userCalendars.remove(userID);
-        delete calendar;
+void CalendarManager::deleteCalendar(qint64 userID) {
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    if (current->userCalendars.contains(userID)) {
+        QMap<qint64, Calendar*> userCalendars = current->userCalendars;
+        current->epoch->retire(userCalendars.take(userID));
+        state.publish(std::make_shared<Snapshot>(Snapshot{std::move(userCalendars), current->epoch->advance()}));
     }
 }
+
+/**
+ * @brief Takes a user's calendar out of the manager without deleting it.
+ * @param userID The ID of the user.
+ * @return The calendar, now owned by the caller, or nullptr if the user has none.
+ *
+ * The calendar keeps its events and indexes, so attachCalendar() restores it as is.
+ */
+Calendar* CalendarManager::detachCalendar(qint64 userID) {
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    if (!current->userCalendars.contains(userID)) return nullptr;
+
+    QMap<qint64, Calendar*> userCalendars = current->userCalendars;
+    Calendar* calendar = userCalendars.take(userID);
+    state.publish(std::make_shared<Snapshot>(Snapshot{std::move(userCalendars), current->epoch->advance()}));
+    return calendar;
+}
+
+/**
+ * @brief Puts a detached calendar back under its owner's ID.
+ * @param calendar The calendar; the manager owns it again.
+ */
+void CalendarManager::attachCalendar(Calendar* calendar) {
+    if (!calendar) return;
+
+    qint64 userID = calendar->getOwner()->getPersonID();
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    QMap<qint64, Calendar*> userCalendars = current->userCalendars;
+    current->epoch->retire(userCalendars.value(userID, nullptr));
+    userCalendars[userID] = calendar;
+    state.publish(std::make_shared<Snapshot>(Snapshot{std::move(userCalendars), current->epoch->advance()}));
+}
+
+/**
+ * @brief Deletes a detached calendar once no snapshot can refer to it anymore.
+ * @param calendar The detached calendar.
+ */
+void CalendarManager::discardCalendar(Calendar* calendar) {
+    QMutexLocker locker(&writeMutex);
+    state.load()->epoch->retire(calendar);
+}
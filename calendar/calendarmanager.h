@@ -8,19 +8,32 @@
 #define CALENDARMANAGER_H
 
 #include <QMap>
+#include <QMutex>
 #include "calendar.h"
 #include "user.h"
+#include "snapshot.h"
 
 /**
  * @class Calendar
  * @brief Manages calendars for users.
  * 
  * The CalendarManager class is responsible for creating, storing, and managing calendars for users.
+ * The calendar map is published as immutable snapshots, so any thread may read it without locking.
  */
 class CalendarManager {
+public:
+    /**
+     * @struct Snapshot
+     * @brief Immutable view of all user calendars at one point in time.
+     */
+    struct Snapshot {
+        QMap<qint64, Calendar*> userCalendars;
+        std::shared_ptr<RetireEpoch> epoch;
+    };
+
 private:
-    static CalendarManager* instance;
-    QMap<int, Calendar*> userCalendars;
+    SnapshotCell<Snapshot> state;
+    QMutex writeMutex;
 
     CalendarManager();
 
@@ -29,9 +42,13 @@ public:
     CalendarManager(const CalendarManager&) = delete;
     CalendarManager& operator=(const CalendarManager&) = delete;
     Calendar* createUserCalendar(User* user);
-    Calendar* getUserCalendar(int userID);
+    Calendar* getUserCalendar(qint64 userID);
     QList<Calendar*> getAllCalendars();
-    void deleteCalendar(int userID);
+    std::shared_ptr<const Snapshot> snapshot() const;
+    void deleteCalendar(qint64 userID);
+    Calendar* detachCalendar(qint64 userID);
+    void attachCalendar(Calendar* calendar);
+    void discardCalendar(Calendar* calendar);
 
 };
 
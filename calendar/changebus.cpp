@@ -0,0 +1,69 @@
+/**
+ * @file changebus.cpp
+ * @brief Implementation of the ChangeBus class
+ */
+#include "changebus.h"
+#include "trace.h"
+
+/**
+ * @brief Gets the singleton instance of ChangeBus.
+ * @return A pointer to the ChangeBus instance.
+ *
+ * Initialization is thread-safe.
+ */
+ChangeBus* ChangeBus::getInstance() {
+    static ChangeBus* instance = new ChangeBus();
+    return instance;
+}
+
+/**
+ * @brief Adds a subscriber.
+ * @param subscriber Called with each batch of deltas, on the thread that made the change.
+ * @return The ID to unsubscribe with.
+ */
+int ChangeBus::subscribe(Subscriber subscriber) {
+    QMutexLocker locker(&mutex);
+    int subscriberID = nextSubscriberID++;
+    subscribers.insert(subscriberID, std::move(subscriber));
+    subscriberCount.store(subscribers.size(), std::memory_order_release);
+    return subscriberID;
+}
+
+/**
+ * @brief Removes a subscriber.
+ * @param subscriberID The ID returned by subscribe().
+ */
+void ChangeBus::unsubscribe(int subscriberID) {
+    QMutexLocker locker(&mutex);
+    subscribers.remove(subscriberID);
+    subscriberCount.store(subscribers.size(), std::memory_order_release);
+}
+
+/**
+ * @brief Checks whether anyone listens, so writers can skip building deltas.
+ * @return true if there is at least one subscriber.
+ */
+bool ChangeBus::isObserved() const {
+    return subscriberCount.load(std::memory_order_acquire) > 0;
+}
+
+/**
+ * @brief Hands a batch of deltas to every subscriber.
+ * @param deltas The deltas of one mutation, in the order they were applied.
+ *
+ * Subscribers are called without the bus lock held, so they may subscribe,
+ * unsubscribe or mutate calendars themselves.
+ */
+void ChangeBus::post(const QList<Delta>& deltas) {
+    TRACE_SCOPE("ChangeBus::post");
+    if (deltas.isEmpty()) return;
+
+    QList<Subscriber> current;
+    {
+        QMutexLocker locker(&mutex);
+        current = subscribers.values();
+    }
+    for (const Subscriber& subscriber : current) {
+        subscriber(deltas);
+    }
+}
@@ -0,0 +1,69 @@
+/**
+ * @file changebus.h
+ * @brief Defines the ChangeBus class.
+ *
+ * Tells subscribers which events were added, removed or moved, and on which day.
+ */
+#ifndef CHANGEBUS_H
+#define CHANGEBUS_H
+
+#include <QDate>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+
+class Calendar;
+
+/**
+ * @class ChangeBus
+ * @brief Process-wide channel for the deltas of every calendar mutation.
+ *
+ * Calendars post the deltas of a mutation as one batch after publishing it, so an
+ * import of many events is a single call. Subscribers run on the mutating thread
+ * and should only queue the deltas; the UI coalesces them and refreshes once per
+ * event loop iteration. Nothing is built while there are no subscribers.
+ */
+class ChangeBus {
+public:
+    /**
+     * @struct Delta
+     * @brief One event added, removed or replaced in a calendar.
+     */
+    struct Delta {
+        enum Kind {
+            Added,
+            Removed,
+            Moved // replaced by a new version, on the same or another day
+        };
+        Kind kind;
+        const Calendar* calendar; // identity only, may be gone when the delta is read
+        qint64 userID;            // owner of the calendar
+        qint64 eventID;
+        QDate day;
+        QDate previousDay;        // Moved only
+    };
+
+    using Subscriber = std::function<void(const QList<Delta>& deltas)>;
+
+private:
+    QMutex mutex;
+    QMap<int, Subscriber> subscribers;
+    int nextSubscriberID = 1;
+    std::atomic<int> subscriberCount{0};
+
+    ChangeBus() = default;
+
+public:
+    static ChangeBus* getInstance();
+    ChangeBus(const ChangeBus&) = delete;
+    ChangeBus& operator=(const ChangeBus&) = delete;
+
+    int subscribe(Subscriber subscriber);
+    void unsubscribe(int subscriberID);
+    bool isObserved() const;
+    void post(const QList<Delta>& deltas);
+};
+
+#endif // CHANGEBUS_H
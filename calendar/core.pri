@@ -0,0 +1,58 @@
+# Non-widget sources shared by the app, the benchmarks and the fuzzer.
+
+INCLUDEPATH += $$PWD
+
+SOURCES += \
+    $$PWD/busyheatmap.cpp \
+    $$PWD/calendar.cpp \
+    $$PWD/calendarmanager.cpp \
+    $$PWD/changebus.cpp \
+    $$PWD/daybitmap.cpp \
+    $$PWD/event.cpp \
+    $$PWD/eventactions.cpp \
+    $$PWD/eventbuilder.cpp \
+    $$PWD/eventidindex.cpp \
+    $$PWD/eventjournal.cpp \
+    $$PWD/eventsegment.cpp \
+    $$PWD/icslexer.cpp \
+    $$PWD/icsparser.cpp \
+    $$PWD/icswriter.cpp \
+    $$PWD/idallocator.cpp \
+    $$PWD/intervalindex.cpp \
+    $$PWD/memoryreport.cpp \
+    $$PWD/metrics.cpp \
+    $$PWD/person.cpp \
+    $$PWD/textindex.cpp \
+    $$PWD/timezoneresolver.cpp \
+    $$PWD/trace.cpp \
+    $$PWD/undohistory.cpp \
+    $$PWD/user.cpp \
+    $$PWD/usermanager.cpp
+
+HEADERS += \
+    $$PWD/busyheatmap.h \
+    $$PWD/calendar.h \
+    $$PWD/calendarmanager.h \
+    $$PWD/changebus.h \
+    $$PWD/daybitmap.h \
+    $$PWD/event.h \
+    $$PWD/eventactions.h \
+    $$PWD/eventbuilder.h \
+    $$PWD/eventidindex.h \
+    $$PWD/eventjournal.h \
+    $$PWD/eventsegment.h \
+    $$PWD/icslexer.h \
+    $$PWD/icsparser.h \
+    $$PWD/icswriter.h \
+    $$PWD/idallocator.h \
+    $$PWD/intervalindex.h \
+    $$PWD/memoryreport.h \
+    $$PWD/metrics.h \
+    $$PWD/person.h \
+    $$PWD/snapshot.h \
+    $$PWD/textindex.h \
+    $$PWD/timezoneresolver.h \
+    $$PWD/trace.h \
+    $$PWD/undohistory.h \
+    $$PWD/user.h \
+    $$PWD/usermanager.h
@@ -0,0 +1,79 @@
+/**
+ * @file daybitmap.cpp
+ * @brief Implementation of the DayBitmap class
+ */
+#include "daybitmap.h"
+
+/**
+ * @brief Marks a day as occupied.
+ * @param date The day.
+ */
+void DayBitmap::set(const QDate& date) {
+    if (!date.isValid()) return;
+    words[wordOf(date)] |= bitOf(date);
+}
+
+/**
+ * @brief Marks a day as free.
+ * @param date The day.
+ */
+void DayBitmap::reset(const QDate& date) {
+    if (!date.isValid()) return;
+
+    auto it = words.find(wordOf(date));
+    if (it == words.end()) return;
+
+    *it &= ~bitOf(date);
+    if (*it == 0) {
+        words.erase(it);
+    }
+}
+
+/**
+ * @brief Checks whether a day is occupied.
+ * @param date The day.
+ * @return true if the day is set.
+ */
+bool DayBitmap::test(const QDate& date) const {
+    if (!date.isValid()) return false;
+    return words.value(wordOf(date)) & bitOf(date);
+}
+
+/**
+ * @brief Checks whether no day is set.
+ * @return true if the bitmap is empty.
+ */
+bool DayBitmap::isEmpty() const {
+    return words.isEmpty();
+}
+
+/**
+ * @brief Clears every day.
+ */
+void DayBitmap::clear() {
+    words.clear();
+}
+
+/**
+ * @brief Adds every day of another bitmap.
+ * @param other The bitmap to merge in.
+ * @return This bitmap.
+ */
+DayBitmap& DayBitmap::operator|=(const DayBitmap& other) {
+    if (words.isEmpty()) {
+        words = other.words;
+        return *this;
+    }
+    for (auto it = other.words.cbegin(); it != other.words.cend(); ++it) {
+        words[it.key()] |= it.value();
+    }
+    return *this;
+}
+
+/**
+ * @brief Gets the words, for memory accounting.
+ * @return Julian day / 64 mapped to the bits of those days.
+ */
+const QHash<qint64, quint64>& DayBitmap::getWords() const {
+    return words;
+}
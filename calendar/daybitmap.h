@@ -0,0 +1,42 @@
+/**
+ * @file daybitmap.h
+ * @brief Defines the DayBitmap class.
+ *
+ * A sparse set of days stored as 64-day words.
+ */
+#ifndef DAYBITMAP_H
+#define DAYBITMAP_H
+
+#include <QDate>
+#include <QHash>
+
+/**
+ * @class DayBitmap
+ * @brief Records which days are occupied, one bit per day.
+ *
+ * Days are numbered by Julian day and grouped into words of 64, so a year of
+ * events costs six words and OR-ing two bitmaps touches each word once.
+ * Copies are implicitly shared.
+ */
+class DayBitmap {
+private:
+    QHash<qint64, quint64> words; // Julian day / 64 -> bits of the 64 days
+
+    static qint64 wordOf(const QDate& date) { return date.toJulianDay() >> 6; }
+    static quint64 bitOf(const QDate& date) { return quint64(1) << (date.toJulianDay() & 63); }
+
+public:
+    DayBitmap() = default;
+
+    void set(const QDate& date);
+    void reset(const QDate& date);
+    bool test(const QDate& date) const;
+    bool isEmpty() const;
+    void clear();
+
+    DayBitmap& operator|=(const DayBitmap& other);
+
+    const QHash<qint64, quint64>& getWords() const;
+};
+
+#endif // DAYBITMAP_H
@@ -7,6 +7,17 @@
  * Designed to encapsulate event data.
  */
 #include "event.h"
+#include "icslexer.h"
+#include <QMutex>
+#include <QtEndian>
+#include <limits>
+
+namespace {
+
+// serializes decoding; cached fields are read without it
+QMutex decodeMutex;
+
+}
 
 /**
  * @brief Constructs an Event object.
@@ -17,8 +28,137 @@
  * @param location The location of the event.
  * @param org A pointer to the User object representing event's organizer.
  */
-Event::Event(int id, const QString& title, const QString& desc, const QDateTime& date, const QString& location, User* org)
-    : eventID(id), title(title), description(desc), date(date), location(location), organizer(org) {}
+Event::Event(qint64 id, const QString& title, const QString& desc, const QDateTime& date, const QString& location, User* org)
+    : eventID(id), title(title), description(desc), startUtc(date.toSecsSinceEpoch()), endUtc(startUtc), location(location), organizer(org) {}
+
+/**
+ * @brief Constructs an Event object from a UTC start time.
+ * @param id The unique ID of the event.
+ * @param title The title of the event.
+ * @param desc The description of the event.
+ * @param startUtc The start of the event, in seconds since the epoch (UTC).
+ * @param location The location of the event.
+ * @param org A pointer to the User object representing event's organizer.
+ */
+Event::Event(qint64 id, const QString& title, const QString& desc, qint64 startUtc, const QString& location, User* org)
+    : eventID(id), title(title), description(desc), startUtc(startUtc), endUtc(startUtc), location(location), organizer(org) {}
+
+/**
+ * @brief Constructs an imported Event whose text is decoded when first read.
+ * @param id The unique ID of the event.
+ * @param textArena The escaped text of the feed; it must not change once the event is read.
+ * @param textOffset Where the event's header is in the arena: an offset and a length,
+ *                   both native quint32, for each TextField in order.
+ * @param startUtc The start of the event, in seconds since the epoch (UTC).
+ * @param org A pointer to the User object representing event's organizer.
+ */
+Event::Event(qint64 id, std::shared_ptr<const QByteArray> textArena, quint32 textOffset, qint64 startUtc, User* org)
+    : eventID(id), startUtc(startUtc), endUtc(startUtc), organizer(org), textArena(std::move(textArena)),
+      textOffset(textOffset), pendingFields((1u << TextFieldCount) - 1) {}
+
+/**
+ * @brief Gets the member caching a text field.
+ * @param field The field.
+ * @return The member.
+ */
+QString& Event::field(TextField field) const {
+    switch (field) {
+    case Title:
+        return title;
+    case Description:
+        return description;
+    default:
+        return location;
+    }
+}
+
+/**
+ * @brief Gets the escaped value of a text field in the arena.
+ * @param field The field.
+ * @return The UTF-8 bytes, still escaped and untrimmed.
+ */
+QByteArrayView Event::escapedText(TextField field) const {
+    const char* header = textArena->constData() + textOffset + field * 2 * sizeof(quint32);
+    quint32 offset = qFromUnaligned<quint32>(header);
+    quint32 length = qFromUnaligned<quint32>(header + sizeof(quint32));
+    return QByteArrayView(textArena->constData() + offset, length);
+}
+
+/**
+ * @brief Decodes a text field from the arena.
+ * @param field The field.
+ * @return The unescaped, trimmed text, like an eagerly parsed value.
+ */
+QString Event::decodeText(TextField field) const {
+    QByteArrayView escaped = escapedText(field);
+    if (escaped.isEmpty()) return QString();
+
+    return IcsContentLine::unescape(QString::fromUtf8(escaped)).trimmed();
+}
+
+/**
+ * @brief Gets a text field, decoding and caching it on the first call.
+ * @param field The field.
+ * @return The text.
+ */
+QString Event::cachedText(TextField field) const {
+    quint8 bit = quint8(1u << field);
+    if (pendingFields.load(std::memory_order_acquire) & bit) {
+        QMutexLocker locker(&decodeMutex);
+        if (pendingFields.load(std::memory_order_relaxed) & bit) {
+            this->field(field) = decodeText(field);
+            pendingFields.fetch_and(quint8(~bit), std::memory_order_release);
+        }
+    }
+    return this->field(field);
+}
+
+/**
+ * @brief Gets a text field without caching it.
+ * @param field The field.
+ * @return The text.
+ *
+ * For readers that pass over every event once, such as indexing, exports and
+ * saving, so reading does not build the fields of every event for good.
+ */
+QString Event::readText(TextField field) const {
+    if (pendingFields.load(std::memory_order_acquire) & (1u << field)) {
+        return decodeText(field);
+    }
+    return this->field(field);
+}
+
+/**
+ * @brief Gets a text field that was not decoded yet as it is in the arena.
+ * @param field The field.
+ * @param utf8 Set to the escaped UTF-8 value; the arena lives as long as the event.
+ * @return false if the field was decoded or set, read it with readText() then.
+ *
+ * Lets the text index find words without building the text at all.
+ */
+bool Event::readEscapedText(TextField field, QByteArrayView& utf8) const {
+    if (!(pendingFields.load(std::memory_order_acquire) & (1u << field))) return false;
+
+    utf8 = escapedText(field);
+    return true;
+}
+
+/**
+ * @brief Checks whether a text field is still only in the arena.
+ * @param field The field.
+ * @return true if it has not been decoded yet.
+ */
+bool Event::isTextPending(TextField field) const {
+    return pendingFields.load(std::memory_order_acquire) & (1u << field);
+}
+
+/**
+ * @brief Gets the arena the event's text is decoded from.
+ * @return The arena shared by the events of one feed, or nullptr for events built from strings.
+ */
+const QByteArray* Event::getTextArena() const {
+    return textArena.get();
+}
 
 /**
  * @brief Updates the details of the event.
@@ -26,11 +166,16 @@ Event::Event(int id, const QString& title, const QString& desc, const QDateTime&
  * @param newDesc The new description for the event.
  * @param newDate The new date and time for the event.
  * @param newLocation The new location for the event.
+ *
+ * The event keeps its duration.
  */
 void Event::updateEvent(const QString& newTitle, const QString& newDesc, QDateTime& newDate, const QString& newLocation){
+    pendingFields.store(0, std::memory_order_release);
     title = newTitle;
     description = newDesc;
-    date = newDate;
+    qint64 duration = endUtc - startUtc;
+    startUtc = newDate.toSecsSinceEpoch();
+    endUtc = startUtc + duration;
     location = newLocation;
 }
 
@@ -39,15 +184,40 @@ void Event::updateEvent(const QString& newTitle, const QString& newDesc, QDateTi
  * @return The title of the event.
  */
 QString Event::getTitle() const{
-    return title;
+    return cachedText(Title);
 }
 
 /**
  * @brief Gets the date and time of the event.
- * @return A QDateTime object representing the event's date and time.
+ * @return A QDateTime object representing the event's date and time, in local time.
  */
 QDateTime Event::getDate() const{
-    return date;
+    return QDateTime::fromSecsSinceEpoch(startUtc);
+}
+
+/**
+ * @brief Gets the start of the event in UTC epoch form.
+ * @return Seconds since the epoch, cheap to compare across time zones.
+ */
+qint64 Event::getStartUtc() const {
+    return startUtc;
+}
+
+/**
+ * @brief Gets the end of the event in UTC epoch form.
+ * @return Seconds since the epoch, equal to the start for events without a duration.
+ */
+qint64 Event::getEndUtc() const {
+    return endUtc;
+}
+
+/**
+ * @brief Sets the end of the event.
+ * @param endUtc The end in seconds since the epoch (UTC); ends before the start are clamped to it.
+ * @note Must be called before the event is added to a calendar.
+ */
+void Event::setEndUtc(qint64 endUtc) {
+    this->endUtc = qMax(startUtc, endUtc);
 }
 
 /**
@@ -55,7 +225,7 @@ QDateTime Event::getDate() const{
  * @return The description of the event.
  */
 QString Event::getDescription() const {
-    return description;
+    return cachedText(Description);
 }
 
 /**
@@ -82,14 +252,14 @@ QString Event::getOrganizerName() const {
  * @return The full name of the organizer.
  */
 QString Event::getLocation() const {
-    return location;
+    return cachedText(Location);
 }
 
 /**
  * @brief Gets the ID of the event.
  * @return The ID of the event.
  */
-int Event::getEventID() const {
+qint64 Event::getEventID() const {
     return eventID;
 
 }
@@ -101,3 +271,82 @@ int Event::getEventID() const {
 User* Event::getOrganizer() const {
     return organizer;
 }
+
+/**
+ * @brief Gets the users taking part in the event.
+ * @return The participants of the event.
+ */
+QSet<User*> Event::getAvailableUsers() const {
+    return participants;
+}
+
+/**
+ * @brief Checks whether a text starts and ends with something other than white space.
+ * @param utf8 The text as UTF-8.
+ * @return true if trimming would not change it.
+ */
+bool EventTextArena::isTrimmed(QByteArrayView utf8) {
+    if (utf8.isEmpty()) return true;
+
+    // only the first and the last character are decoded
+    qsizetype firstEnd = 1;
+    while (firstEnd < utf8.size() && (uchar(utf8[firstEnd]) & 0xC0) == 0x80) firstEnd++;
+    qsizetype lastStart = utf8.size() - 1;
+    while (lastStart > 0 && (uchar(utf8[lastStart]) & 0xC0) == 0x80) lastStart--;
+    QString first = QString::fromUtf8(utf8.first(firstEnd));
+    QString last = QString::fromUtf8(utf8.sliced(lastStart));
+    return !first.isEmpty() && !first.front().isSpace() && !last.isEmpty() && !last.back().isSpace();
+}
+
+/**
+ * @brief Adds the text of one event.
+ * @param texts The text of each TextField as UTF-8, unescaped.
+ * @param header Set to where the event's header is, for the Event constructor.
+ * @return false if the text cannot be kept in the arena as it is; build the event from strings then.
+ *
+ * Events decode their text trimmed, so text with white space at either end is refused.
+ */
+bool EventTextArena::add(const QByteArray (&texts)[Event::TextFieldCount], quint32& header) {
+    qsizetype needed = 0;
+    for (const QByteArray& text : texts) {
+        if (!isTrimmed(text)) return false;
+        needed += 2 * text.size() + 2 * qsizetype(sizeof(quint32));
+    }
+    if (arena.size() + needed > qsizetype(std::numeric_limits<quint32>::max())) return false;
+
+    quint32 spans[Event::TextFieldCount][2];
+    for (int field = 0; field < Event::TextFieldCount; field++) {
+        spans[field][0] = quint32(arena.size());
+        // only what IcsContentLine::unescape() resolves has to be escaped
+        for (char c : texts[field]) {
+            if (c == '\\') {
+                arena.append("\\\\", 2);
+            } else if (c == '\n') {
+                arena.append("\\n", 2);
+            } else {
+                arena.append(c);
+            }
+        }
+        spans[field][1] = quint32(arena.size()) - spans[field][0];
+    }
+
+    header = quint32(arena.size());
+    for (const quint32 (&span)[2] : spans) {
+        char entry[2 * sizeof(quint32)];
+        qToUnaligned(span[0], entry);
+        qToUnaligned(span[1], entry + sizeof(quint32));
+        arena.append(entry, sizeof(entry));
+    }
+    return true;
+}
+
+/**
+ * @brief Hands the arena over to the events.
+ * @return The arena, which must not change anymore; nullptr if no text was added.
+ */
+std::shared_ptr<const QByteArray> EventTextArena::finish() {
+    if (arena.isEmpty()) return nullptr;
+
+    arena.squeeze();
+    return std::make_shared<QByteArray>(std::move(arena));
+}
@@ -7,9 +7,13 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#include <QByteArray>
+#include <QByteArrayView>
 #include <QString>
 #include <QDateTime>
 #include <QSet>
+#include <atomic>
+#include <memory>
 #include "user.h"
 
 /**
@@ -17,33 +21,88 @@
  * @brief Represents an event with a title, description, date&time, location, and organizer.
  * 
  * The Event class represents an event with a title, description, date&time, location, and organizer.
+ *
+ * Imported events keep their text still escaped in the text arena of their feed,
+ * and events read back from the journal or the event segment in an arena per
+ * record or block (see EventTextArena). They decode a field on its first get,
+ * so the fields of events nobody opens are never built. Decoded fields are
+ * cached; any thread may read them.
  */
 class Event {
+public:
+    enum TextField {
+        Title,
+        Description,
+        Location,
+        TextFieldCount
+    };
+
 private:
-    int eventID;
-    QString title;
-    QString description;
-    QDateTime date;
-    QString location;
+    qint64 eventID;
+    mutable QString title;
+    mutable QString description;
+    qint64 startUtc; // seconds since the epoch, UTC
+    qint64 endUtc;   // never before startUtc; equal for events without a duration
+    mutable QString location;
     User* organizer;
     QSet<User*> participants;
 
+    // where the escaped text of an imported event is, see IcsParser::parse
+    std::shared_ptr<const QByteArray> textArena;
+    quint32 textOffset = 0;
+    mutable std::atomic<quint8> pendingFields{0}; // one bit per TextField still in the arena
+
+    QString& field(TextField field) const;
+    QByteArrayView escapedText(TextField field) const;
+    QString decodeText(TextField field) const;
+    QString cachedText(TextField field) const;
+
 public:
-    Event(int id, const QString& title, const QString& desc, const QDateTime& date, const QString& location, User* org);
+    Event(qint64 id, const QString& title, const QString& desc, const QDateTime& date, const QString& location, User* org);
+    Event(qint64 id, const QString& title, const QString& desc, qint64 startUtc, const QString& location, User* org);
+    Event(qint64 id, std::shared_ptr<const QByteArray> textArena, quint32 textOffset, qint64 startUtc, User* org);
+    Event(const Event&) = delete;
+    Event& operator=(const Event&) = delete;
 
     void updateEvent(const QString& newTitle, const QString& newDesc, QDateTime& newDate, const QString& newLocation);
 
-    QSet<User*> getAvaiableUsers() const;
+    QSet<User*> getAvailableUsers() const;
     QString getTitle() const;
     QDateTime getDate() const;
+    qint64 getStartUtc() const;
+    qint64 getEndUtc() const;
+    void setEndUtc(qint64 endUtc);
     QString getDescription() const;
     User* getUser() const;
     QString getOrganizerName() const;
 
     QString getLocation() const;
-    int getEventID() const;
+    qint64 getEventID() const;
     User* getOrganizer() const;
 
+    QString readText(TextField field) const;
+    bool readEscapedText(TextField field, QByteArrayView& utf8) const;
+    bool isTextPending(TextField field) const;
+    const QByteArray* getTextArena() const;
+
+};
+
+/**
+ * @class EventTextArena
+ * @brief Packs the saved text of events into one arena, in the layout IcsParser writes.
+ *
+ * Add the text of every event first, then finish() and construct the events
+ * with the arena and the headers returned by add().
+ */
+class EventTextArena {
+private:
+    QByteArray arena;
+
+    static bool isTrimmed(QByteArrayView utf8);
+
+public:
+    bool add(const QByteArray (&texts)[Event::TextFieldCount], quint32& header);
+    std::shared_ptr<const QByteArray> finish();
 };
 
 
@@ -4,29 +4,331 @@
  */
 
 #include "eventactions.h"
-#include "usermanager.h"
-#include <QMessageBox>
-#include <QTextCharFormat>
+#include "calendarmanager.h"
+#include "trace.h"
+#include <QSet>
+#include <algorithm>
 
 /**
- * @brief Executes the event creation logic.
+ * @brief Finds the events clashing with an event, per participant.
+ * @param calendar The calendar the event is saved to; its owner is a participant too.
+ * @param event The event, new or edited; its own ID is never reported.
+ * @return One entry per participant with clashes, the calendar's owner first.
  *
- * Adds event to calendar and sets background colour based on organizers unique colour.
+ * Each calendar answers from its interval index, in O(log n) plus the clashes found.
+ */
+QList<EventConflict> EventActions::findConflicts(const Calendar* calendar, const Event* event) {
+    TRACE_SCOPE("EventActions::findConflicts");
+    QList<EventConflict> conflicts;
+    if (!event) return conflicts;
+
+    QList<const Calendar*> calendars;
+    if (calendar) {
+        calendars.append(calendar);
+    }
+    for (const Calendar* other : CalendarManager::getInstance()->getAllCalendars()) {
+        if (other != calendar) {
+            calendars.append(other);
+        }
+    }
+
+    for (const Calendar* other : calendars) {
+        QList<Event*> events = other->getConflicts(event->getStartUtc(), event->getEndUtc(), event->getEventID());
+        if (!events.isEmpty()) {
+            conflicts.append(EventConflict{other->getOwner(), events});
+        }
+    }
+    return conflicts;
+}
+
+/**
+ * @brief Starts an empty batch.
+ * @param calendar The calendar to mutate.
+ * @param listener Called once per commit with what changed, or empty for none.
+ * @param history Records each commit so it can be undone, or nullptr for none.
+ */
+BatchEventActions::BatchEventActions(Calendar* calendar, Listener listener, UndoHistory* history)
+    : calendar(calendar), listener(std::move(listener)), history(history), detach(history != nullptr) {}
+
+/**
+ * @brief Queues adding an event.
+ * @param event The new event; the calendar takes ownership on commit.
+ */
+void BatchEventActions::create(Event* event) {
+    if (event) changes.append({Calendar::Change::Add, event});
+}
+
+/**
+ * @brief Queues replacing the event with the same ID.
+ * @param event The new version; the calendar takes ownership on commit.
+ */
+void BatchEventActions::edit(Event* event) {
+    if (event) changes.append({Calendar::Change::Update, event});
+}
+
+/**
+ * @brief Queues removing an event.
+ * @param event The event; it is deleted once no snapshot refers to it anymore.
+ */
+void BatchEventActions::remove(Event* event) {
+    if (event) changes.append({Calendar::Change::Remove, event});
+}
+
+/**
+ * @brief Gets the number of queued mutations.
+ * @return The number of mutations commit() would apply.
+ */
+qsizetype BatchEventActions::size() const {
+    return changes.size();
+}
+
+/**
+ * @brief Chooses whether removed and replaced events are detached or deleted.
+ * @param detach true to leave them to the caller, as EventActionResult pointers.
  *
- * @param calendar A pointer to Calendar object where event is to be added.
- * @param event A pointer to the Event object to be created.
+ * Always on while recording to a history, which then owns them.
+ */
+void BatchEventActions::setDetach(bool detach) {
+    this->detach = detach || history;
+}
+
+/**
+ * @brief Applies the queued mutations as one calendar version.
+ * @return What changed, with the clashes of the added and updated events; not
+ *         applied if no mutation found its event.
+ *
+ * Only the mutations the calendar applied are reported, recorded and passed to
+ * the listener. Clashes are looked up after applying, so events of the same
+ * batch are checked against each other too. The queue is empty afterwards.
  */
-void CreateEventStrategy::execute(Calendar* calendar, Event* event) {
-    if (!calendar || !event) return;
+EventActionResult BatchEventActions::commit() {
+    TRACE_SCOPE("BatchEventActions::commit");
+    EventActionResult result;
+    result.calendar = calendar;
+    if (!calendar || changes.isEmpty()) return result;
 
-    calendar->addEvent(event);
+    // removed and replaced events are retired into this version, pinning it keeps them readable
+    std::shared_ptr<const Calendar::Snapshot> before = calendar->snapshot();
+    QList<Calendar::Change> applied = calendar->apply(changes, detach);
 
-    QTextCharFormat format;
-    format.setBackground(UserManager::getInstance()->getUserColor(event->getOrganizer()->getPersonID()));
+    QSet<const Event*> appliedEvents;
+    for (const Calendar::Change& change : applied) {
+        appliedEvents.insert(change.event);
+        switch (change.kind) {
+        case Calendar::Change::Add:
+            result.added.append(change.event);
+            break;
+        case Calendar::Change::Update:
+            result.updated.append({change.event, change.previous, change.previous->getDate().date()});
+            break;
+        case Calendar::Change::Remove:
+            result.removed.append({change.event, change.event->getEventID(), change.event->getDate().date()});
+            break;
+        }
+    }
+    before.reset();
 
-    QMessageBox::information(nullptr, "Success!",
-                             "Event '" + event->getTitle() + "' has been created successfully.");
+    // a new version that replaced nothing was handed over with the batch, unless a command replays its own
+    if (!detach || history) {
+        for (const Calendar::Change& change : changes) {
+            if (change.kind == Calendar::Change::Update && !appliedEvents.contains(change.event)) {
+                appliedEvents.insert(change.event);
+                delete change.event;
+            }
+        }
+    }
+    changes.clear();
+    if (applied.isEmpty()) return result;
+    result.applied = true;
 
+    // merge the clashes of every event per participant
+    auto addConflicts = [&result](const Event* event) {
+        for (EventConflict& conflict : EventActions::findConflicts(result.calendar, event)) {
+            auto same = std::find_if(result.conflicts.begin(), result.conflicts.end(),
+                                     [&](const EventConflict& other) { return other.participant == conflict.participant; });
+            if (same == result.conflicts.end()) {
+                result.conflicts.append(conflict);
+                continue;
+            }
+            for (Event* clash : conflict.events) {
+                if (!same->events.contains(clash)) {
+                    same->events.append(clash);
+                }
+            }
+        }
+    };
+    for (const Event* event : result.added) {
+        addConflicts(event);
+    }
+    for (const EventActionResult::UpdatedEvent& update : result.updated) {
+        addConflicts(update.event);
+    }
+
+    if (history) {
+        history->record(std::make_unique<EventCommand>(result, listener));
+    }
+    if (listener) {
+        listener(result);
+    }
+    return result;
+}
+
+/**
+ * @brief Records a batch committed with detaching on.
+ * @param result The result of the commit.
+ * @param listener Notified of every undo and redo, like the original commit.
+ */
+EventCommand::EventCommand(const EventActionResult& result, BatchEventActions::Listener listener)
+    : calendar(result.calendar), listener(std::move(listener)) {
+    auto touch = [this](const QDate& day) {
+        QDate month(day.year(), day.month(), 1);
+        if (day.isValid() && !touchedMonths.contains(month)) touchedMonths.append(month);
+    };
+    for (Event* event : result.added) {
+        forward.append({Calendar::Change::Add, event});
+        touch(event->getDate().date());
+    }
+    for (const EventActionResult::UpdatedEvent& update : result.updated) {
+        forward.append({Calendar::Change::Update, update.event});
+        touch(update.event->getDate().date());
+        touch(update.previousDate);
+    }
+    for (const EventActionResult::RemovedEvent& removed : result.removed) {
+        forward.append({Calendar::Change::Remove, removed.event});
+        touch(removed.date);
+    }
+
+    // the inverse runs the changes backwards
+    for (qsizetype i = result.removed.size() - 1; i >= 0; i--) {
+        inverse.append({Calendar::Change::Add, result.removed[i].event});
+    }
+    for (qsizetype i = result.updated.size() - 1; i >= 0; i--) {
+        if (result.updated[i].previous) {
+            inverse.append({Calendar::Change::Update, result.updated[i].previous});
+        }
+    }
+    for (qsizetype i = result.added.size() - 1; i >= 0; i--) {
+        inverse.append({Calendar::Change::Remove, result.added[i]});
+    }
+
+    const char* verb = !result.added.isEmpty() ? "Create" : !result.updated.isEmpty() ? "Edit" : "Delete";
+    if (forward.size() == 1) {
+        description = QString("%1 '%2'").arg(verb, forward.first().event->getTitle());
+    } else {
+        description = QString("%1 Events").arg(forward.size());
+    }
+}
+
+/**
+ * @brief Retires the event versions the command still holds out of the calendar.
+ */
+EventCommand::~EventCommand() {
+    if (!calendar) return;
+
+    // what the next undo or redo would put back is detached, unless a later batch re-added it
+    QSet<const Event*> inCalendar;
+    for (const Event* event : calendar->snapshot()->events) {
+        inCalendar.insert(event);
+    }
+    QSet<Event*> retired;
+    for (const Calendar::Change& change : done ? inverse : forward) {
+        if (change.kind != Calendar::Change::Remove && !inCalendar.contains(change.event)
+            && !retired.contains(change.event)) {
+            retired.insert(change.event);
+            calendar->retire(change.event);
+        }
+    }
+}
+
+/**
+ * @brief Applies one side of the command as a detaching batch.
+ * @param changes The forward or inverse changes.
+ */
+void EventCommand::apply(const QList<Calendar::Change>& changes) {
+    BatchEventActions batch(calendar, listener);
+    batch.setDetach(true);
+    for (const Calendar::Change& change : changes) {
+        switch (change.kind) {
+        case Calendar::Change::Add:
+            batch.create(change.event);
+            break;
+        case Calendar::Change::Update:
+            batch.edit(change.event);
+            break;
+        case Calendar::Change::Remove:
+            batch.remove(change.event);
+            break;
+        }
+    }
+    batch.commit();
+}
+
+/**
+ * @brief Describes the command for the Undo and Redo menu items.
+ * @return The description, such as "Delete 'Standup'".
+ */
+QString EventCommand::text() const {
+    return description;
+}
+
+/**
+ * @brief Gets the months of the events the batch changed.
+ * @return The first day of each month, where undo and redo look the events up.
+ */
+QList<QDate> EventCommand::months() const {
+    return touchedMonths;
+}
+
+/**
+ * @brief Puts back what the batch replaced and removes what it added.
+ */
+void EventCommand::undo() {
+    TRACE_SCOPE("EventCommand::undo");
+    apply(inverse);
+    done = false;
+}
+
+/**
+ * @brief Applies the batch again, with the same event objects.
+ */
+void EventCommand::redo() {
+    TRACE_SCOPE("EventCommand::redo");
+    apply(forward);
+    done = true;
+}
+
+/**
+ * @brief Sets the listener notified after every execute.
+ * @param listener Called with what changed, or empty for none.
+ */
+void EventActions::setListener(BatchEventActions::Listener listener) {
+    this->listener = std::move(listener);
+}
+
+/**
+ * @brief Sets the history every execute is recorded to.
+ * @param history The history, or nullptr to delete removed and replaced events right away.
+ */
+void EventActions::setHistory(UndoHistory* history) {
+    this->history = history;
+}
+
+/**
+ * @brief Executes the event creation logic.
+ *
+ * Adds event to calendar.
+ *
+ * @param calendar A pointer to Calendar object where event is to be added.
+ * @param event A pointer to the Event object to be created.
+ * @return The result, with the clashes of the new event.
+ */
+EventActionResult CreateEventStrategy::execute(Calendar* calendar, Event* event) {
+    TRACE_SCOPE("CreateEventStrategy::execute");
+    if (!calendar || !event) return EventActionResult();
+
+    BatchEventActions batch(calendar, listener, history);
+    batch.create(event);
+    return batch.commit();
 }
 
 /**
@@ -36,27 +338,31 @@ void CreateEventStrategy::execute(Calendar* calendar, Event* event) {
  *
  * @param calendar A pointer to the Calendar object where the event is stored.
  * @param event A pointer to the Event object to be deleted.
+ * @return The result; deleting never causes clashes.
  */
-void DeleteEventStrategy::execute(Calendar* calendar, Event* event) {
-    if (!calendar || !event) return;
+EventActionResult DeleteEventStrategy::execute(Calendar* calendar, Event* event) {
+    TRACE_SCOPE("DeleteEventStrategy::execute");
+    if (!calendar || !event) return EventActionResult();
 
-    calendar->removeEvent(event);
-
-    QMessageBox::information(nullptr, "Success", "Event deleted successfully.");
+    BatchEventActions batch(calendar, listener, history);
+    batch.remove(event);
+    return batch.commit();
 }
 
 /**
  * @brief Executes the event editing logic.
  *
- * Updates the details of the specified event in the calendar.
+ * Replaces the event with the same ID in the calendar.
  *
  * @param calendar A pointer to the Calendar object where the event is stored.
  * @param event A pointer to the Event object to be updated.
+ * @return The result, with the clashes of the updated event.
  */
-void EditEventStrategy::execute(Calendar* calendar, Event* event) {
-    if (!calendar || !event) return;
-
-    calendar->updateEvent(event);
+EventActionResult EditEventStrategy::execute(Calendar* calendar, Event* event) {
+    TRACE_SCOPE("EditEventStrategy::execute");
+    if (!calendar || !event) return EventActionResult();
 
-    QMessageBox::information(nullptr, "Success", "Event updated successfully.");
+    BatchEventActions batch(calendar, listener, history);
+    batch.edit(event);
+    return batch.commit();
 }
@@ -5,20 +5,139 @@
 #ifndef EVENTACTIONS_H
 #define EVENTACTIONS_H
 
+#include <QDate>
+#include <QList>
+#include <functional>
 #include "calendar.h"
 #include "event.h"
+#include "user.h"
+#include "undohistory.h"
+
+/**
+ * @struct EventConflict
+ * @brief The events of one participant that clash with an event.
+ */
+struct EventConflict {
+    const User* participant;
+    QList<Event*> events;
+};
+
+/**
+ * @struct EventActionResult
+ * @brief What an event action or a batch of them did.
+ *
+ * Unless the batch detached them, removed and replaced events may already be freed
+ * when the result is read, so their IDs and dates are kept too; RemovedEvent::event
+ * and UpdatedEvent::previous are then identities to compare pointers with, never
+ * to dereference.
+ */
+struct EventActionResult {
+    struct UpdatedEvent {
+        Event* event;
+        Event* previous; // the replaced version
+        QDate previousDate;
+    };
+
+    struct RemovedEvent {
+        Event* event;
+        qint64 eventID;
+        QDate date;
+    };
+
+    bool applied = false;
+    Calendar* calendar = nullptr;
+    QList<Event*> added;
+    QList<UpdatedEvent> updated;
+    QList<RemovedEvent> removed;
+    QList<EventConflict> conflicts; // clashes of the added and updated events, per participant
+
+    bool hasConflicts() const { return !conflicts.isEmpty(); }
+};
+
+/**
+ * @class BatchEventActions
+ * @brief Collects event mutations and applies them as one calendar version.
+ *
+ * Nothing is shown to the user: commit() returns what changed and hands the same
+ * result to the listener once, so indexes and views are updated once per batch.
+ * With a history, removed and replaced events are detached rather than deleted
+ * and the batch is recorded as one EventCommand.
+ */
+class BatchEventActions {
+public:
+    using Listener = std::function<void(const EventActionResult&)>;
+
+private:
+    Calendar* calendar;
+    Listener listener;
+    UndoHistory* history;
+    bool detach;
+    QList<Calendar::Change> changes;
+
+public:
+    explicit BatchEventActions(Calendar* calendar, Listener listener = Listener(), UndoHistory* history = nullptr);
+
+    void create(Event* event);
+    void edit(Event* event);
+    void remove(Event* event);
+    qsizetype size() const;
+    void setDetach(bool detach);
+
+    EventActionResult commit();
+};
+
+/**
+ * @class EventCommand
+ * @brief Undoable record of one committed batch.
+ *
+ * Keeps the inverse of every change as a pointer to the event version that undo
+ * puts back, so a step costs two small entries per changed event and no copies.
+ * The versions out of the calendar are owned by the command and retired through
+ * the calendar when it is destroyed.
+ */
+class EventCommand : public UndoCommand {
+private:
+    Calendar* calendar;
+    BatchEventActions::Listener listener;
+    QList<Calendar::Change> forward;
+    QList<Calendar::Change> inverse;
+    QList<QDate> touchedMonths;
+    QString description;
+    bool done = true;
+
+    void apply(const QList<Calendar::Change>& changes);
+
+public:
+    EventCommand(const EventActionResult& result, BatchEventActions::Listener listener);
+    ~EventCommand() override;
+
+    QString text() const override;
+    void undo() override;
+    void redo() override;
+    QList<QDate> months() const override;
+};
 
 /**
  * @class EventActions
  * @brief Abstract class for event actions.
  * 
  * The EventActions class is an abstract class that defines the interface for event actions.
+ * Actions do not interact with the user; they return what they did and notify
+ * the listener.
  */
 class EventActions {
+protected:
+    BatchEventActions::Listener listener;
+    UndoHistory* history = nullptr;
+
 public:
     virtual ~EventActions() = default;
-    virtual void execute(Calendar* calendar, Event* event) = 0;
+    virtual EventActionResult execute(Calendar* calendar, Event* event) = 0;
+
+    void setListener(BatchEventActions::Listener listener);
+    void setHistory(UndoHistory* history);
 
+    static QList<EventConflict> findConflicts(const Calendar* calendar, const Event* event);
 };
 
 /**
@@ -29,7 +148,7 @@ public:
  */
 class CreateEventStrategy : public EventActions {
 public:
-    void execute(Calendar* calendar, Event* event) override;
+    EventActionResult execute(Calendar* calendar, Event* event) override;
 };
 
 /**
@@ -40,7 +159,7 @@ public:
  */
 class DeleteEventStrategy : public EventActions {
 public:
-    void execute(Calendar* calendar, Event* event) override;
+    EventActionResult execute(Calendar* calendar, Event* event) override;
 };
 
 /**
@@ -51,7 +170,7 @@ public:
  */
 class EditEventStrategy : public EventActions {
 public:
-    void execute(Calendar* calendar, Event* event) override;
+    EventActionResult execute(Calendar* calendar, Event* event) override;
 };
 
 #endif // EVENTACTIONS_H
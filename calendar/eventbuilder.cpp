@@ -16,7 +16,7 @@ EventBuilder::EventBuilder() : eventID(-1), title(""), description(""), location
  * @param id Unique ID for event
  * @return A reference to current EventBuilder instance for method chaining.
  */
-EventBuilder& EventBuilder::setEventID(int id) {
+EventBuilder& EventBuilder::setEventID(qint64 id) {
     eventID = id;
     return *this;
 }
@@ -19,7 +19,7 @@
  * The EventBuilder class is responsible for building Event objects.
  */
 class EventBuilder {
-    int eventID;
+    qint64 eventID;
     QString title;
     QString description;
     QString location;
@@ -30,7 +30,7 @@ public:
     EventBuilder();
 
     //interface methods
-    EventBuilder& setEventID(int id);
+    EventBuilder& setEventID(qint64 id);
     EventBuilder& setTitle(const QString& t);
     EventBuilder& setDescription(const QString& desc);
     EventBuilder& setLocation(const QString& loc);
@@ -73,7 +73,7 @@ void EventDialog::onCreateClicked() {
  * @param organizer Event organizer
  * @return A pointer to new created Event object.
  */
-Event* EventDialog::getEventData(EventBuilder& builder, int eventId, User* organizer) {
+Event* EventDialog::getEventData(EventBuilder& builder, qint64 eventId, User* organizer) {
 
     Event* event = builder
                        .setEventID(eventId)
@@ -36,7 +36,7 @@ private:
 
 public:
     EventDialog(QWidget* parent = nullptr);
-    Event* getEventData(EventBuilder& builder, int eventId, User* organizer);
+    Event* getEventData(EventBuilder& builder, qint64 eventId, User* organizer);
     void setEventData(Event* event);
 
 private slots:
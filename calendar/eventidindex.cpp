@@ -0,0 +1,97 @@
+/**
+ * @file eventidindex.cpp
+ * @brief Implementation of the EventIdIndex class
+ */
+#include "eventidindex.h"
+
+/**
+ * @brief Gets the bucket an ID is kept in.
+ * @param eventID The ID.
+ * @return The bucket index.
+ */
+int EventIdIndex::bucketOf(qint64 eventID) {
+    return int(qHash(eventID, 0) % bucketCount);
+}
+
+/**
+ * @brief Gets a bucket this index may change.
+ * @param bucket The bucket index.
+ * @return The map, cloned first if another copy of the index shares it.
+ */
+EventIdIndex::Bucket& EventIdIndex::writable(int bucket) {
+    std::shared_ptr<const Bucket>& shared = buckets[bucket];
+    if (!shared) {
+        shared = std::make_shared<Bucket>();
+    } else if (shared.use_count() > 1) {
+        shared = std::make_shared<Bucket>(*shared);
+    }
+    // only this index refers to the map now, so changing it is not seen by any reader
+    return const_cast<Bucket&>(*shared);
+}
+
+/**
+ * @brief Adds an event, replacing the version indexed under the same ID.
+ * @param event The event.
+ */
+void EventIdIndex::insert(Event* event) {
+    if (!event) return;
+
+    writable(bucketOf(event->getEventID())).insert(event->getEventID(), event);
+}
+
+/**
+ * @brief Adds several events at once.
+ * @param events The events.
+ *
+ * Each touched bucket is cloned at most once, however many events go to it.
+ */
+void EventIdIndex::insert(const QList<Event*>& events) {
+    for (Event* event : events) {
+        insert(event);
+    }
+}
+
+/**
+ * @brief Removes an event.
+ * @param event The event; another version indexed under its ID is left alone.
+ * @return true if the event was found.
+ */
+bool EventIdIndex::remove(const Event* event) {
+    if (!event) return false;
+
+    int bucket = bucketOf(event->getEventID());
+    if (!buckets[bucket] || buckets[bucket]->value(event->getEventID()) != event) return false;
+
+    writable(bucket).remove(event->getEventID());
+    return true;
+}
+
+/**
+ * @brief Finds an event by its ID.
+ * @param eventID The ID.
+ * @return The indexed version, or nullptr if there is none.
+ */
+Event* EventIdIndex::find(qint64 eventID) const {
+    const std::shared_ptr<const Bucket>& bucket = buckets[bucketOf(eventID)];
+    return bucket ? bucket->value(eventID, nullptr) : nullptr;
+}
+
+/**
+ * @brief Gets the number of indexed events.
+ * @return The number of IDs.
+ */
+qsizetype EventIdIndex::size() const {
+    qsizetype count = 0;
+    for (const std::shared_ptr<const Bucket>& bucket : buckets) {
+        if (bucket) count += bucket->size();
+    }
+    return count;
+}
+
+/**
+ * @brief Gets the buckets, for memory accounting.
+ * @return The maps by bucket; nullptr for buckets never used.
+ */
+const std::array<std::shared_ptr<const EventIdIndex::Bucket>, EventIdIndex::bucketCount>& EventIdIndex::getBuckets() const {
+    return buckets;
+}
@@ -0,0 +1,48 @@
+/**
+ * @file eventidindex.h
+ * @brief Defines the EventIdIndex class.
+ *
+ * Finds an event of a calendar by its ID.
+ */
+#ifndef EVENTIDINDEX_H
+#define EVENTIDINDEX_H
+
+#include <QHash>
+#include <QList>
+#include <array>
+#include <memory>
+#include "event.h"
+
+/**
+ * @class EventIdIndex
+ * @brief Maps event IDs to the version of the event a calendar holds.
+ *
+ * Like TextIndex, the IDs are spread over bucketCount maps that copies of the
+ * index share, and a change clones only the map it touches. Publishing an
+ * edit of one event copies about 1/bucketCount of the IDs.
+ */
+class EventIdIndex {
+public:
+    using Bucket = QHash<qint64, Event*>;
+    static constexpr int bucketCount = 256;
+
+private:
+    std::array<std::shared_ptr<const Bucket>, bucketCount> buckets; // nullptr while empty
+
+    static int bucketOf(qint64 eventID);
+    Bucket& writable(int bucket);
+
+public:
+    EventIdIndex() = default;
+
+    void insert(Event* event);
+    void insert(const QList<Event*>& events);
+    bool remove(const Event* event);
+
+    Event* find(qint64 eventID) const;
+    qsizetype size() const;
+
+    const std::array<std::shared_ptr<const Bucket>, bucketCount>& getBuckets() const;
+};
+
+#endif // EVENTIDINDEX_H
@@ -0,0 +1,632 @@
+/**
+ * @file eventjournal.cpp
+ * @brief Implementation of the EventJournal class
+ */
+#include "eventjournal.h"
+#include <QDataStream>
+#include <QDir>
+#include <QSaveFile>
+#include <QtEndian>
+
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+// bumped whenever a record layout changes; open() sets files of another version aside
+const QByteArray journalMagic("ALJ4");
+const QByteArray snapshotMagic("ALS4");
+
+// frames larger than this are refused when writing and taken as corruption when reading
+constexpr quint32 maxFrameSize = 256 * 1024 * 1024;
+
+// events per record when a compaction saves a whole calendar
+constexpr int eventsPerRecord = 10000;
+
+quint32 crc32(const QByteArray& data) {
+    static const QList<quint32> table = []() {
+        QList<quint32> entries(256);
+        for (quint32 i = 0; i < 256; i++) {
+            quint32 value = i;
+            for (int bit = 0; bit < 8; bit++) {
+                value = (value & 1) ? 0xEDB88320u ^ (value >> 1) : value >> 1;
+            }
+            entries[i] = value;
+        }
+        return entries;
+    }();
+
+    quint32 crc = 0xFFFFFFFFu;
+    for (char byte : data) {
+        crc = table[(crc ^ quint8(byte)) & 0xFF] ^ (crc >> 8);
+    }
+    return crc ^ 0xFFFFFFFFu;
+}
+
+quint64 frameSequence(const QByteArray& payload) {
+    return payload.size() >= 8 ? qFromBigEndian<quint64>(payload.constData()) : 0;
+}
+
+}
+
+/**
+ * @brief Creates a journal kept in a directory.
+ * @param directory The directory for journal.bin and snapshot.bin.
+ *
+ * Nothing is read or written until open().
+ */
+EventJournal::EventJournal(const QString& directory)
+    : directory(directory) {}
+
+/**
+ * @brief Writes every queued change, then stops the writer thread.
+ */
+EventJournal::~EventJournal() {
+    {
+        QMutexLocker locker(&mutex);
+        stopping = true;
+        wakeWriter.wakeOne();
+    }
+    if (writer.joinable()) {
+        writer.join();
+    }
+    journal.close();
+}
+
+/**
+ * @brief Replays the saved state and starts journaling.
+ * @param apply Called for every saved change, in order, on the calling thread.
+ * @return true if the journal can be written.
+ *
+ * A snapshot or journal in another format, or with records that cannot be
+ * replayed, is copied aside before it is replaced (see getSetAsideFiles()).
+ * If the copy fails, nothing is replaced and false is returned.
+ */
+bool EventJournal::open(const std::function<void(const Record&)>& apply) {
+    if (!QDir().mkpath(directory)) {
+        qWarning("Cannot create journal directory %s", qPrintable(directory));
+        return false;
+    }
+
+    // the snapshot holds the state up to its sequence number
+    quint64 snapshotSequence = 0;
+    QFile snapshot(QDir(directory).filePath("snapshot.bin"));
+    if (snapshot.open(QIODevice::ReadOnly)) {
+        QByteArray header = snapshot.read(snapshotMagic.size() + 8);
+        if (header.size() == snapshotMagic.size() + 8 && header.startsWith(snapshotMagic)) {
+            snapshotSequence = qFromBigEndian<quint64>(header.constData() + snapshotMagic.size());
+            QByteArray payload;
+            Record record;
+            while (readFrame(snapshot, payload) && decode(payload, record)) {
+                apply(record);
+            }
+        }
+        else if (!setAside(snapshot.fileName())) {
+            return false;
+        }
+    }
+
+    // then every journal record after it, up to the first torn one
+    journal.setFileName(QDir(directory).filePath("journal.bin"));
+    if (!journal.open(QIODevice::ReadWrite)) {
+        qWarning("Cannot open journal %s", qPrintable(journal.fileName()));
+        return false;
+    }
+
+    quint64 lastSequence = snapshotSequence;
+    if (journal.read(journalMagic.size()) != journalMagic) {
+        if (journal.size() > 0 && !setAside(journal.fileName())) return false;
+        journal.resize(0);
+        journal.seek(0);
+        journal.write(journalMagic);
+    }
+    else {
+        qint64 validEnd = journal.pos();
+        bool intact = true;
+        QByteArray payload;
+        Record record;
+        while (readFrame(journal, payload)) {
+            if (!decode(payload, record)) {
+                intact = false;
+                break;
+            }
+            if (record.sequence > snapshotSequence) {
+                // the records after a missing one may depend on it
+                if (record.sequence != lastSequence + 1) {
+                    qWarning("Journal record %llu is missing", lastSequence + 1);
+                    intact = false;
+                    break;
+                }
+                apply(record);
+                lastSequence = record.sequence;
+            }
+            validEnd = journal.pos();
+        }
+        if (validEnd < journal.size()) {
+            // a torn last record is what a crash leaves behind, anything else is kept
+            if (!intact && !setAside(journal.fileName())) return false;
+            qWarning("Dropping %lld bytes of unreadable journal records", journal.size() - validEnd);
+            journal.resize(validEnd);
+        }
+        journal.seek(validEnd);
+    }
+    journal.flush();
+
+    nextSequence = lastSequence + 1;
+    writtenSequence = lastSequence;
+    journalBytes = journal.size();
+    writer = std::thread(&EventJournal::writerLoop, this);
+    return true;
+}
+
+/**
+ * @brief Records a new user.
+ * @param user The user.
+ * @param color The colour assigned to the user.
+ */
+void EventJournal::userCreated(const User* user, const QColor& color) {
+    queue(PendingChange{UserCreated, 0, user->getPersonID(), 0, user->getFirstName(), user->getLastName(),
+                        color, nullptr, {}});
+}
+
+/**
+ * @brief Records that a user and their calendar were deleted.
+ * @param userID The ID of the user.
+ */
+void EventJournal::userDeleted(qint64 userID) {
+    queue(PendingChange{UserDeleted, 0, userID, 0, QString(), QString(), QColor(), nullptr, {}});
+}
+
+/**
+ * @brief Records events added to a calendar.
+ * @param calendarID The user ID owning the calendar, or createdCalendarID.
+ * @param calendar The calendar, already holding the events.
+ * @param events The events added.
+ *
+ * Large imports are split into records of eventsPerRecord events, like a
+ * compaction saves them, so no record outgrows what replay accepts.
+ */
+void EventJournal::eventsAdded(qint64 calendarID, const Calendar* calendar, const QList<Event*>& events) {
+    if (events.isEmpty()) return;
+
+    std::shared_ptr<const Calendar::Snapshot> pin = calendar->snapshot();
+    for (qsizetype first = 0; first < events.size(); first += eventsPerRecord) {
+        queue(PendingChange{EventsAdded, 0, 0, calendarID, QString(), QString(), QColor(), pin,
+                            events.mid(first, eventsPerRecord)});
+    }
+}
+
+/**
+ * @brief Records every event of a calendar, those spilled out of the horizon too.
+ * @param calendarID The user ID owning the calendar, or createdCalendarID.
+ * @param calendar The calendar.
+ *
+ * Spilled blocks are read back by the writer thread one at a time, as a
+ * compaction does, so the calendar's horizon is left as it is.
+ */
+void EventJournal::calendarAdded(qint64 calendarID, const Calendar* calendar) {
+    std::shared_ptr<const Calendar::Snapshot> pin = calendar->snapshot();
+    eventsAdded(calendarID, calendar, pin->events);
+    for (const QList<EventSegment::Extent>& extents : pin->spilled) {
+        for (const EventSegment::Extent& extent : extents) {
+            queue(PendingChange{EventsAdded, 0, 0, calendarID, QString(), QString(), QColor(), pin, {}, extent});
+        }
+    }
+}
+
+/**
+ * @brief Records a new version of an event.
+ * @param calendarID The user ID owning the calendar, or createdCalendarID.
+ * @param calendar The calendar, already holding the new version.
+ * @param event The new version.
+ */
+void EventJournal::eventUpdated(qint64 calendarID, const Calendar* calendar, Event* event) {
+    queue(PendingChange{EventUpdated, 0, 0, calendarID, QString(), QString(), QColor(), calendar->snapshot(), {event}});
+}
+
+/**
+ * @brief Records that an event was removed.
+ * @param calendarID The user ID owning the calendar, or createdCalendarID.
+ * @param eventID The ID of the event.
+ */
+void EventJournal::eventRemoved(qint64 calendarID, qint64 eventID) {
+    queue(PendingChange{EventRemoved, 0, eventID, calendarID, QString(), QString(), QColor(), nullptr, {}});
+}
+
+/**
+ * @brief Checks whether the journal grew enough to be compacted.
+ * @return true if compact() should be called.
+ */
+bool EventJournal::needsCompaction() {
+    QMutexLocker locker(&mutex);
+    return writer.joinable() && !pendingCompaction && journalBytes > compactionThreshold;
+}
+
+/**
+ * @brief Saves a snapshot of the whole state on the writer thread.
+ * @param state The state after the last change recorded so far.
+ *
+ * Call from the thread that makes the changes, right after capturing the
+ * state, so the snapshot covers exactly the changes queued until now.
+ */
+void EventJournal::compact(State state) {
+    QMutexLocker locker(&mutex);
+    if (!writer.joinable()) return;
+
+    pendingCompaction = std::make_unique<State>(std::move(state));
+    compactionSequence = nextSequence - 1;
+    wakeWriter.wakeOne();
+}
+
+/**
+ * @brief Waits until every queued change is on disk.
+ * @return true if all of them were written.
+ */
+bool EventJournal::flush() {
+    QMutexLocker locker(&mutex);
+    if (!writer.joinable()) return false;
+
+    quint64 target = nextSequence - 1;
+    wakeWriter.wakeOne();
+    while (writtenSequence < target && !failed) {
+        batchWritten.wait(&mutex);
+    }
+    return !failed;
+}
+
+/**
+ * @brief Gets where the journal is kept.
+ * @return The directory.
+ */
+QString EventJournal::getDirectory() const {
+    return directory;
+}
+
+/**
+ * @brief Gets the copies open() kept of files it could not replay.
+ * @return The paths of the copies, empty if everything was replayed.
+ */
+QStringList EventJournal::getSetAsideFiles() const {
+    return setAsideFiles;
+}
+
+/**
+ * @brief Keeps a copy of a file that is about to be replaced.
+ * @param path The file.
+ * @return true if the copy was made.
+ */
+bool EventJournal::setAside(const QString& path) {
+    QString target = path + ".bad";
+    for (int n = 2; QFile::exists(target); n++) {
+        target = path + ".bad" + QString::number(n);
+    }
+    if (!QFile::copy(path, target)) {
+        qWarning("Cannot keep unreadable %s as %s", qPrintable(path), qPrintable(target));
+        return false;
+    }
+
+    qWarning("Kept unreadable %s as %s", qPrintable(path), qPrintable(target));
+    setAsideFiles.append(target);
+    return true;
+}
+
+/**
+ * @brief Hands a change to the writer thread.
+ * @param change The change, numbered here.
+ */
+void EventJournal::queue(PendingChange change) {
+    QMutexLocker locker(&mutex);
+    if (!writer.joinable() || stopping) return;
+
+    change.sequence = nextSequence++;
+    pending.append(std::move(change));
+    wakeWriter.wakeOne();
+}
+
+/**
+ * @brief Writes batches of queued changes until the journal is destroyed.
+ */
+void EventJournal::writerLoop() {
+    QMutexLocker locker(&mutex);
+    while (true) {
+        while (pending.isEmpty() && !pendingCompaction && !stopping) {
+            wakeWriter.wait(&mutex);
+        }
+
+        QList<PendingChange> batch;
+        batch.swap(pending);
+        std::unique_ptr<State> compaction = std::move(pendingCompaction);
+        quint64 compactUpTo = compactionSequence;
+        bool stop = stopping;
+        bool broken = failed;
+        locker.unlock();
+
+        // one write and one sync for the whole batch; once a record is lost
+        // nothing more is written, replay would otherwise skip over the gap
+        bool written = !broken;
+        quint64 batchEnd = 0;
+        if (!batch.isEmpty() && !broken) {
+            QByteArray bytes;
+            for (const PendingChange& change : batch) {
+                bool appended = false;
+                if (change.spilled.count > 0) {
+                    PendingChange read = change;
+                    read.events = change.pin->segment->read(change.spilled, nullptr);
+                    bool complete = read.events.size() == change.spilled.count;
+                    appended = complete && appendFrame(bytes, encode(read));
+                    qDeleteAll(read.events);
+                    if (!appended) {
+                        qWarning("Cannot journal change %llu: spilled events are unreadable or too large",
+                                 change.sequence);
+                    }
+                }
+                else {
+                    appended = appendFrame(bytes, encode(change));
+                    if (!appended) {
+                        qWarning("Cannot journal change %llu: record exceeds %u bytes",
+                                 change.sequence, maxFrameSize);
+                    }
+                }
+                if (!appended) {
+                    written = false;
+                    break;
+                }
+                batchEnd = change.sequence;
+            }
+
+            if (journal.write(bytes) != bytes.size() || !journal.flush() || !syncFile(journal)) {
+                qWarning("Cannot write journal %s: %s", qPrintable(journal.fileName()), qPrintable(journal.errorString()));
+                written = false;
+            }
+        }
+        batch.clear();
+
+        if (compaction) {
+            compactNow(*compaction, compactUpTo);
+            compaction.reset();
+        }
+
+        locker.relock();
+        if (batchEnd > 0) {
+            writtenSequence = batchEnd;
+        }
+        failed = failed || !written;
+        journalBytes = journal.size();
+        batchWritten.wakeAll();
+
+        if (stop && pending.isEmpty()) break;
+    }
+}
+
+/**
+ * @brief Writes the snapshot, then drops the journal records it covers.
+ * @param state The state to save.
+ * @param lastSequence The last change included in the state.
+ */
+void EventJournal::compactNow(const State& state, quint64 lastSequence) {
+    QSaveFile snapshot(QDir(directory).filePath("snapshot.bin"));
+    if (!snapshot.open(QIODevice::WriteOnly)) {
+        qWarning("Cannot write snapshot %s", qPrintable(snapshot.fileName()));
+        return;
+    }
+
+    QByteArray out = snapshotMagic;
+    out.resize(snapshotMagic.size() + 8);
+    qToBigEndian<quint64>(lastSequence, out.data() + snapshotMagic.size());
+
+    for (const User* user : state.users->users) {
+        PendingChange change{UserCreated, lastSequence, user->getPersonID(), 0, user->getFirstName(),
+                             user->getLastName(), state.users->userColors.value(user->getPersonID()), nullptr, {}};
+        appendFrame(out, encode(change));
+    }
+
+    for (const QPair<qint64, std::shared_ptr<const Calendar::Snapshot>>& calendar : state.calendars) {
+        const QList<Event*>& events = calendar.second->events;
+        for (qsizetype first = 0; first < events.size(); first += eventsPerRecord) {
+            PendingChange change{EventsAdded, lastSequence, 0, calendar.first, QString(), QString(), QColor(),
+                                 nullptr, events.mid(first, eventsPerRecord)};
+            if (!appendFrame(out, encode(change))) {
+                qWarning("Cannot write snapshot %s: record exceeds %u bytes", qPrintable(snapshot.fileName()),
+                         maxFrameSize);
+                snapshot.cancelWriting();
+                return;
+            }
+
+            if (out.size() > (1 << 20)) {
+                snapshot.write(out);
+                out.clear();
+            }
+        }
+
+        // events spilled out of the horizon are saved too, one block at a time
+        const Calendar::Snapshot& spilledFrom = *calendar.second;
+        for (const QList<EventSegment::Extent>& extents : spilledFrom.spilled) {
+            for (const EventSegment::Extent& extent : extents) {
+                QList<Event*> spilled = spilledFrom.segment->read(extent, nullptr);
+                if (spilled.size() != extent.count) {
+                    // a snapshot missing these events would replace the journal that still has them
+                    qDeleteAll(spilled);
+                    qWarning("Cannot write snapshot %s: spilled events are unreadable", qPrintable(snapshot.fileName()));
+                    snapshot.cancelWriting();
+                    return;
+                }
+                PendingChange change{EventsAdded, lastSequence, 0, calendar.first, QString(), QString(), QColor(),
+                                     nullptr, spilled};
+                bool appended = appendFrame(out, encode(change));
+                qDeleteAll(spilled);
+                if (!appended) {
+                    qWarning("Cannot write snapshot %s: record exceeds %u bytes", qPrintable(snapshot.fileName()),
+                             maxFrameSize);
+                    snapshot.cancelWriting();
+                    return;
+                }
+
+                if (out.size() > (1 << 20)) {
+                    snapshot.write(out);
+                    out.clear();
+                }
+            }
+        }
+    }
+    snapshot.write(out);
+
+    // QSaveFile syncs and atomically replaces the previous snapshot
+    if (!snapshot.commit()) {
+        qWarning("Cannot write snapshot %s", qPrintable(snapshot.fileName()));
+        return;
+    }
+
+    // keep only the records queued after the snapshot was taken
+    QByteArray kept = journalMagic;
+    journal.seek(journalMagic.size());
+    QByteArray payload;
+    while (readFrame(journal, payload)) {
+        if (frameSequence(payload) > lastSequence) {
+            appendFrame(kept, payload);
+        }
+    }
+
+    QString path = journal.fileName();
+    journal.close();
+    QSaveFile rewritten(path);
+    if (!rewritten.open(QIODevice::WriteOnly) || rewritten.write(kept) != kept.size() || !rewritten.commit()) {
+        // the old journal is still complete, its covered records are skipped at replay
+        qWarning("Cannot compact journal %s", qPrintable(path));
+    }
+
+    journal.open(QIODevice::ReadWrite);
+    journal.seek(journal.size());
+}
+
+/**
+ * @brief Serializes a change.
+ * @param change The change.
+ * @return The record payload, starting with the big-endian sequence number.
+ */
+QByteArray EventJournal::encode(const PendingChange& change) {
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    stream << change.sequence << quint8(change.type);
+
+    switch (change.type) {
+    case UserCreated:
+        stream << qint64(change.id) << change.firstName << change.lastName << quint32(change.color.rgba());
+        break;
+    case UserDeleted:
+        stream << qint64(change.id);
+        break;
+    case EventsAdded:
+    case EventUpdated:
+        stream << qint64(change.calendarID) << quint32(change.events.size());
+        for (const Event* event : change.events) {
+            stream << qint64(event->getEventID()) << event->readText(Event::Title) << event->readText(Event::Description)
+                   << qint64(event->getStartUtc()) << qint64(event->getEndUtc()) << event->readText(Event::Location);
+        }
+        break;
+    case EventRemoved:
+        stream << qint64(change.calendarID) << qint64(change.id);
+        break;
+    }
+    return payload;
+}
+
+/**
+ * @brief Appends a payload with its length and checksum.
+ * @param out The buffer to append to.
+ * @param payload The record payload.
+ * @return false, appending nothing, if the payload is larger than readFrame() accepts.
+ */
+bool EventJournal::appendFrame(QByteArray& out, const QByteArray& payload) {
+    if (payload.size() > qsizetype(maxFrameSize)) return false;
+
+    char header[8];
+    qToLittleEndian<quint32>(quint32(payload.size()), header);
+    qToLittleEndian<quint32>(crc32(payload), header + 4);
+    out.append(header, sizeof(header));
+    out.append(payload);
+    return true;
+}
+
+/**
+ * @brief Reads the next complete, intact frame.
+ * @param file The file, positioned at a frame.
+ * @param payload Receives the payload.
+ * @return false at the end of the file or at a torn or corrupt frame.
+ */
+bool EventJournal::readFrame(QFile& file, QByteArray& payload) {
+    QByteArray header = file.read(8);
+    if (header.size() < 8) return false;
+
+    quint32 size = qFromLittleEndian<quint32>(header.constData());
+    quint32 checksum = qFromLittleEndian<quint32>(header.constData() + 4);
+    if (size > maxFrameSize) return false;
+
+    payload = file.read(size);
+    return payload.size() == qsizetype(size) && crc32(payload) == checksum;
+}
+
+/**
+ * @brief Parses a record payload.
+ * @param payload The payload.
+ * @param record Receives the change.
+ * @return true if the payload is a valid record.
+ */
+bool EventJournal::decode(const QByteArray& payload, Record& record) {
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    quint8 type = 0;
+    record = Record();
+    stream >> record.sequence >> type;
+    record.type = RecordType(type);
+
+    switch (record.type) {
+    case UserCreated: {
+        quint32 rgba = 0;
+        stream >> record.userID >> record.firstName >> record.lastName >> rgba;
+        record.color = QColor::fromRgba(rgba);
+        break;
+    }
+    case UserDeleted:
+        stream >> record.userID;
+        break;
+    case EventsAdded:
+    case EventUpdated: {
+        quint32 count = 0;
+        stream >> record.calendarID >> count;
+        // every event takes at least 36 bytes, so a larger count is corrupt
+        if (count > quint32(payload.size() / 36)) return false;
+        record.events.reserve(count);
+        for (quint32 i = 0; i < count && stream.status() == QDataStream::Ok; i++) {
+            EventData event;
+            stream >> event.eventID >> event.title >> event.description >> event.startUtc >> event.endUtc
+                   >> event.location;
+            record.events.append(event);
+        }
+        break;
+    }
+    case EventRemoved:
+        stream >> record.calendarID >> record.eventID;
+        break;
+    default:
+        return false;
+    }
+    return stream.status() == QDataStream::Ok;
+}
+
+/**
+ * @brief Forces written data to the disk.
+ * @param file The file, already flushed.
+ * @return true on success.
+ */
+bool EventJournal::syncFile(QFile& file) {
+#ifdef Q_OS_WIN
+    return _commit(file.handle()) == 0;
+#else
+    return ::fsync(file.handle()) == 0;
+#endif
+}
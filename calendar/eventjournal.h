@@ -0,0 +1,168 @@
+/**
+ * @file eventjournal.h
+ * @brief Defines the EventJournal class.
+ *
+ * Persists users and events as an append-only binary journal that is
+ * replayed at startup and compacted into a snapshot file.
+ */
+#ifndef EVENTJOURNAL_H
+#define EVENTJOURNAL_H
+
+#include <QByteArray>
+#include <QColor>
+#include <QFile>
+#include <QList>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <QStringList>
+#include <QWaitCondition>
+#include <functional>
+#include <memory>
+#include <thread>
+#include "calendar.h"
+#include "event.h"
+#include "user.h"
+#include "usermanager.h"
+
+/**
+ * @class EventJournal
+ * @brief Appends user and event changes to disk without blocking the caller.
+ *
+ * Each change becomes a length-prefixed, checksummed record with a sequence
+ * number. Callers only queue the change; a background thread encodes every
+ * queued change, writes them in one go and syncs the file once per batch
+ * (group commit). Changes queued while a sync runs go into the next batch.
+ *
+ * Compaction writes the whole state to snapshot.bin with the last sequence
+ * number it covers, then drops the journal records it contains. A crash at
+ * any point leaves a snapshot and a journal that replay to the same state,
+ * and a record torn by a crash is cut off at the next open.
+ *
+ * Once a change cannot be written, no later change is written either, so
+ * the journal never has a gap; flush() reports the failure.
+ */
+class EventJournal {
+public:
+    enum RecordType : quint8 {
+        UserCreated = 1,
+        UserDeleted = 2,
+        EventsAdded = 3,
+        EventUpdated = 4,
+        EventRemoved = 5
+    };
+
+    // calendar ID of the calendar holding the events created in the app
+    static constexpr qint64 createdCalendarID = 0;
+
+    /**
+     * @struct EventData
+     * @brief The saved fields of one event.
+     */
+    struct EventData {
+        qint64 eventID = 0;
+        QString title;
+        QString description;
+        qint64 startUtc = 0;
+        qint64 endUtc = 0;
+        QString location;
+    };
+
+    /**
+     * @struct Record
+     * @brief One replayed change.
+     *
+     * User records fill the user fields, event records fill calendarID and
+     * either events or eventID.
+     */
+    struct Record {
+        RecordType type = UserCreated;
+        quint64 sequence = 0;
+        qint64 userID = 0;
+        QString firstName;
+        QString lastName;
+        QColor color;
+        qint64 calendarID = 0;
+        QList<EventData> events;
+        qint64 eventID = 0;
+    };
+
+    /**
+     * @struct State
+     * @brief Everything a compaction saves, captured as snapshots.
+     */
+    struct State {
+        std::shared_ptr<const UserManager::Snapshot> users;
+        QList<QPair<qint64, std::shared_ptr<const Calendar::Snapshot>>> calendars;
+    };
+
+private:
+    // a change waiting for the writer thread; the snapshot keeps its events and segment alive
+    struct PendingChange {
+        RecordType type;
+        quint64 sequence;
+        qint64 id; // user ID or event ID
+        qint64 calendarID;
+        QString firstName;
+        QString lastName;
+        QColor color;
+        std::shared_ptr<const Calendar::Snapshot> pin;
+        QList<Event*> events;
+        EventSegment::Extent spilled = {}; // a block of pin's segment, read back when written
+    };
+
+    QString directory;
+    QFile journal;
+    std::thread writer;
+
+    QMutex mutex;
+    QWaitCondition wakeWriter;
+    QWaitCondition batchWritten;
+    QList<PendingChange> pending;
+    std::unique_ptr<State> pendingCompaction;
+    quint64 compactionSequence = 0;
+    quint64 nextSequence = 1;
+    quint64 writtenSequence = 0;
+    qint64 journalBytes = 0;
+    bool stopping = false;
+    bool failed = false;
+    QStringList setAsideFiles;
+
+    bool setAside(const QString& path);
+    void queue(PendingChange change);
+    void writerLoop();
+    void compactNow(const State& state, quint64 lastSequence);
+
+    static QByteArray encode(const PendingChange& change);
+    static bool appendFrame(QByteArray& out, const QByteArray& payload);
+    static bool readFrame(QFile& file, QByteArray& payload);
+    static bool decode(const QByteArray& payload, Record& record);
+    static bool syncFile(QFile& file);
+
+public:
+    // journal size above which compact() is worth calling
+    static constexpr qint64 compactionThreshold = 4 * 1024 * 1024;
+
+    explicit EventJournal(const QString& directory);
+    ~EventJournal();
+    EventJournal(const EventJournal&) = delete;
+    EventJournal& operator=(const EventJournal&) = delete;
+
+    bool open(const std::function<void(const Record&)>& apply);
+
+    void userCreated(const User* user, const QColor& color);
+    void userDeleted(qint64 userID);
+    void eventsAdded(qint64 calendarID, const Calendar* calendar, const QList<Event*>& events);
+    void calendarAdded(qint64 calendarID, const Calendar* calendar);
+    void eventUpdated(qint64 calendarID, const Calendar* calendar, Event* event);
+    void eventRemoved(qint64 calendarID, qint64 eventID);
+
+    bool needsCompaction();
+    void compact(State state);
+    bool flush();
+
+    QString getDirectory() const;
+    QStringList getSetAsideFiles() const;
+};
+
+#endif // EVENTJOURNAL_H
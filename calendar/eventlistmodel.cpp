@@ -0,0 +1,227 @@
+/**
+ * @file eventlistmodel.cpp
+ * @brief Implementation of the EventListModel class
+ */
+#include "eventlistmodel.h"
+#include "usermanager.h"
+#include <QColor>
+#include <algorithm>
+
+/**
+ * @brief Constructs an empty EventListModel.
+ * @param showOrganizer Whether rows show the organizer's name and colour.
+ * @param parent The parent object.
+ */
+EventListModel::EventListModel(bool showOrganizer, QObject* parent)
+    : QAbstractListModel(parent), totalRows(0), showOrganizer(showOrganizer) {}
+
+/**
+ * @brief Gets the number of events on the current date.
+ * @param parent Unused, the model is flat.
+ * @return The number of rows.
+ */
+int EventListModel::rowCount(const QModelIndex& parent) const {
+    return parent.isValid() ? 0 : totalRows;
+}
+
+/**
+ * @brief Builds the display data for one row.
+ * @param index The row to display.
+ * @param role The requested role.
+ * @return The row text, background colour or Event pointer (Qt::UserRole).
+ */
+QVariant EventListModel::data(const QModelIndex& index, int role) const {
+    Event* event = eventAt(index);
+    if (!event) return QVariant();
+
+    switch (role) {
+    case Qt::DisplayRole:
+        if (showOrganizer) {
+            return QString("%1: %2").arg(event->getOrganizerName(), event->getTitle());
+        }
+        return event->getTitle();
+    case Qt::BackgroundRole:
+        if (showOrganizer && event->getOrganizer()) {
+            return UserManager::getInstance()->getUserColor(event->getOrganizer()->getPersonID());
+        }
+        return QVariant();
+    case Qt::UserRole:
+        return QVariant::fromValue(event);
+    default:
+        return QVariant();
+    }
+}
+
+/**
+ * @brief Shows the events of a date.
+ * @param newDate The date to show.
+ * @param calendars The calendars to show events from, in display order.
+ */
+void EventListModel::setDate(const QDate& newDate, const QList<Calendar*>& calendars) {
+    beginResetModel();
+    date = newDate;
+    sections.clear();
+    totalRows = 0;
+
+    for (const Calendar* calendar : calendars) {
+        if (!calendar) continue;
+
+        std::shared_ptr<const Calendar::Snapshot> snapshot = calendar->snapshot();
+        QList<Event*> events = snapshot->eventsByDate.value(date);
+        if (events.isEmpty()) continue;
+
+        sections.append(Section{calendar, snapshot, events, totalRows});
+        totalRows += events.size();
+    }
+    endResetModel();
+}
+
+/**
+ * @brief Gets the date currently shown.
+ * @return The current date.
+ */
+QDate EventListModel::getDate() const {
+    return date;
+}
+
+/**
+ * @brief Gets the event shown in a row.
+ * @param index The row.
+ * @return The event, or nullptr if the index is invalid.
+ */
+Event* EventListModel::eventAt(const QModelIndex& index) const {
+    if (!index.isValid() || index.row() >= totalRows) return nullptr;
+
+    int sectionIndex = sectionForRow(index.row());
+    const Section& section = sections[sectionIndex];
+    return section.events[index.row() - section.firstRow];
+}
+
+/**
+ * @brief Inserts a newly added event if it belongs to the current date.
+ * @param calendar The calendar the event was added to.
+ * @param event The new event.
+ */
+void EventListModel::eventAdded(const Calendar* calendar, Event* event) {
+    if (!calendar || !event || event->getDate().date() != date) return;
+
+    int sectionIndex = sectionForCalendar(calendar);
+    if (sectionIndex < 0) {
+        sections.append(Section{calendar, calendar->snapshot(), QList<Event*>(), totalRows});
+        sectionIndex = sections.size() - 1;
+    }
+
+    Section& section = sections[sectionIndex];
+    int row = section.firstRow + section.events.size();
+
+    beginInsertRows(QModelIndex(), row, row);
+    section.snapshot = calendar->snapshot();
+    section.events.append(event);
+    totalRows++;
+    renumberFrom(sectionIndex + 1);
+    endInsertRows();
+}
+
+/**
+ * @brief Removes the row of an event, if it is shown.
+ * @param event The removed event.
+ */
+void EventListModel::eventRemoved(Event* event) {
+    for (int i = 0; i < sections.size(); i++) {
+        int offset = sections[i].events.indexOf(event);
+        if (offset < 0) continue;
+
+        int row = sections[i].firstRow + offset;
+        beginRemoveRows(QModelIndex(), row, row);
+        sections[i].events.removeAt(offset);
+        totalRows--;
+        renumberFrom(i + 1);
+        endRemoveRows();
+        return;
+    }
+}
+
+/**
+ * @brief Removes the rows of every event organized by a user.
+ * @param userID The ID of the organizer.
+ *
+ * Consecutive rows are removed as a single range.
+ */
+void EventListModel::removeOrganizer(qint64 userID) {
+    for (int i = 0; i < sections.size(); i++) {
+        QList<Event*>& events = sections[i].events;
+        int offset = events.size() - 1;
+
+        // walk backwards so removed ranges do not shift the ones still to visit
+        while (offset >= 0) {
+            if (!events[offset]->getOrganizer() || events[offset]->getOrganizer()->getPersonID() != userID) {
+                offset--;
+                continue;
+            }
+
+            int last = offset;
+            while (offset > 0 && events[offset - 1]->getOrganizer()
+                   && events[offset - 1]->getOrganizer()->getPersonID() == userID) {
+                offset--;
+            }
+
+            int firstRow = sections[i].firstRow + offset;
+            beginRemoveRows(QModelIndex(), firstRow, firstRow + last - offset);
+            events.remove(offset, last - offset + 1);
+            totalRows -= last - offset + 1;
+            renumberFrom(i + 1);
+            endRemoveRows();
+            offset--;
+        }
+    }
+}
+
+/**
+ * @brief Finds the section holding a row.
+ * @param row A valid row.
+ * @return The index of the section.
+ */
+int EventListModel::sectionForRow(int row) const {
+    auto it = std::upper_bound(sections.cbegin(), sections.cend(), row,
+                               [](int value, const Section& section) { return value < section.firstRow; });
+    return int(it - sections.cbegin()) - 1;
+}
+
+/**
+ * @brief Finds the section of a calendar.
+ * @param calendar The calendar to look for.
+ * @return The index of the section, or -1 if the calendar has no rows.
+ */
+int EventListModel::sectionForCalendar(const Calendar* calendar) const {
+    for (int i = 0; i < sections.size(); i++) {
+        if (sections[i].calendar == calendar) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Recomputes the first row of the sections after a change.
+ * @param sectionIndex The first section whose start may have moved.
+ */
+void EventListModel::renumberFrom(int sectionIndex) {
+    int row = sectionIndex > 0 ? sections[sectionIndex - 1].firstRow + sections[sectionIndex - 1].events.size() : 0;
+    for (int i = sectionIndex; i < sections.size(); i++) {
+        sections[i].firstRow = row;
+        row += sections[i].events.size();
+    }
+}
+
+/**
+ * @brief Adds the sections to a memory report.
+ * @param report The report, after the calendars were added so shared day lists are not counted twice.
+ * @param name The name shown for the model.
+ */
+void EventListModel::reportMemory(MemoryReport& report, const QString& name) const {
+    qint64 bytes = report.listBytes(sections);
+    for (const Section& section : sections) {
+        bytes += report.listBytes(section.events);
+    }
+    report.addCache(name, bytes);
+}
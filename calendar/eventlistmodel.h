@@ -0,0 +1,62 @@
+/**
+ * @file eventlistmodel.h
+ * @brief Defines the EventListModel class.
+ *
+ * List model serving the events of one day straight from the calendars' date index.
+ */
+#ifndef EVENTLISTMODEL_H
+#define EVENTLISTMODEL_H
+
+#include <QAbstractListModel>
+#include <QDate>
+#include <QList>
+#include "calendar.h"
+#include "event.h"
+#include "memoryreport.h"
+
+/**
+ * @class EventListModel
+ * @brief Serves the events of the selected date to a QListView.
+ *
+ * The model keeps one section per calendar, sharing the event list of the calendar's
+ * date index, so selecting a date costs one index lookup per calendar. Display text
+ * and colours are built in data(), which the view only calls for visible rows.
+ */
+class EventListModel : public QAbstractListModel {
+    Q_OBJECT
+
+private:
+    struct Section {
+        const Calendar* calendar;
+        std::shared_ptr<const Calendar::Snapshot> snapshot;
+        QList<Event*> events;
+        int firstRow;
+    };
+
+    QList<Section> sections;
+    QDate date;
+    int totalRows;
+    bool showOrganizer;
+
+    int sectionForRow(int row) const;
+    int sectionForCalendar(const Calendar* calendar) const;
+    void renumberFrom(int sectionIndex);
+
+public:
+    explicit EventListModel(bool showOrganizer, QObject* parent = nullptr);
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const override;
+
+    void setDate(const QDate& newDate, const QList<Calendar*>& calendars);
+    QDate getDate() const;
+    Event* eventAt(const QModelIndex& index) const;
+
+    void eventAdded(const Calendar* calendar, Event* event);
+    void eventRemoved(Event* event);
+    void removeOrganizer(qint64 userID);
+
+    void reportMemory(MemoryReport& report, const QString& name) const;
+};
+
+#endif // EVENTLISTMODEL_H
@@ -0,0 +1,166 @@
+/**
+ * @file eventsegment.cpp
+ * @brief Implementation of the EventSegment class
+ */
+#include "eventsegment.h"
+#include "trace.h"
+#include <QDataStream>
+#include <QDir>
+
+namespace {
+
+/**
+ * @brief Writes raw bytes at the end of a file.
+ * @param file The file, open for writing.
+ * @param bytes The bytes.
+ * @param extent Set to where they were written.
+ * @return true if every byte was written.
+ */
+bool appendBytes(QFile& file, const QByteArray& bytes, EventSegment::Extent& extent) {
+    qint64 offset = file.size();
+    if (!file.seek(offset) || file.write(bytes) != bytes.size()) {
+        return false;
+    }
+    extent.offset = offset;
+    extent.size = bytes.size();
+    return true;
+}
+
+}
+
+/**
+ * @brief Creates an empty segment file in the temporary directory.
+ *
+ * A segment that cannot be created refuses every append, so its events stay in memory.
+ */
+EventSegment::EventSegment()
+    : file(QDir(QDir::tempPath()).filePath("alignify-segment-XXXXXX.bin")) {
+    opened = file.open();
+    if (!opened) {
+        qWarning("Cannot create event segment in %s", qPrintable(QDir::tempPath()));
+    }
+}
+
+/**
+ * @brief Writes a block of events.
+ * @param events The events; they are copied, the caller keeps them.
+ * @param extent Set to where the block was written.
+ * @return true if the block was written.
+ *
+ * Text is stored as UTF-8 and the block is compressed, since cold events are
+ * mostly repeated titles and locations.
+ */
+bool EventSegment::append(const QList<Event*>& events, Extent& extent) {
+    TRACE_SCOPE("EventSegment::append");
+    QByteArray payload;
+    QDataStream stream(&payload, QIODevice::WriteOnly);
+    stream.setVersion(QDataStream::Qt_6_0);
+    for (const Event* event : events) {
+        stream << qint64(event->getEventID()) << event->readText(Event::Title).toUtf8()
+               << event->readText(Event::Description).toUtf8() << qint64(event->getStartUtc())
+               << qint64(event->getEndUtc()) << event->readText(Event::Location).toUtf8();
+    }
+
+    QMutexLocker locker(&mutex);
+    if (!opened || !appendBytes(file, qCompress(payload), extent)) {
+        return false;
+    }
+    extent.count = qint32(events.size());
+    return true;
+}
+
+/**
+ * @brief Reads a block of events back.
+ * @param extent The block, as returned by append().
+ * @param owner The organizer of the events, the owner of their calendar.
+ * @return New events owned by the caller; none if the block cannot be read.
+ */
+QList<Event*> EventSegment::read(const Extent& extent, User* owner) const {
+    TRACE_SCOPE("EventSegment::read");
+    QByteArray compressed;
+    {
+        QMutexLocker locker(&mutex);
+        if (opened && file.seek(extent.offset)) {
+            compressed = file.read(extent.size);
+        }
+    }
+    if (compressed.size() != extent.size) {
+        qWarning("Cannot read %d events from segment %s", int(extent.count), qPrintable(file.fileName()));
+        return {};
+    }
+
+    QByteArray payload = qUncompress(compressed);
+    QDataStream stream(payload);
+    stream.setVersion(QDataStream::Qt_6_0);
+
+    struct Saved {
+        qint64 eventID, startUtc, endUtc;
+        QByteArray texts[Event::TextFieldCount];
+        qint64 header; // in the arena, or -1 to build the event from strings
+    };
+    QList<Saved> saved;
+    saved.reserve(extent.count);
+    EventTextArena packer;
+    for (qint32 i = 0; i < extent.count; i++) {
+        Saved entry;
+        stream >> entry.eventID >> entry.texts[Event::Title] >> entry.texts[Event::Description] >> entry.startUtc
+            >> entry.endUtc >> entry.texts[Event::Location];
+        if (stream.status() != QDataStream::Ok) {
+            qWarning("Corrupt event block in segment %s", qPrintable(file.fileName()));
+            break;
+        }
+
+        // the text stays UTF-8 in one arena per block, decoded when an event is opened
+        quint32 header = 0;
+        entry.header = packer.add(entry.texts, header) ? qint64(header) : -1;
+        saved.append(std::move(entry));
+    }
+    std::shared_ptr<const QByteArray> arena = packer.finish();
+
+    QList<Event*> events;
+    events.reserve(saved.size());
+    for (const Saved& entry : saved) {
+        Event* event = entry.header >= 0
+            ? new Event(entry.eventID, arena, quint32(entry.header), entry.startUtc, owner)
+            : new Event(entry.eventID, QString::fromUtf8(entry.texts[Event::Title]),
+                        QString::fromUtf8(entry.texts[Event::Description]), entry.startUtc,
+                        QString::fromUtf8(entry.texts[Event::Location]), owner);
+        event->setEndUtc(entry.endUtc);
+        events.append(event);
+    }
+    return events;
+}
+
+/**
+ * @brief Copies a block to another segment without decoding it.
+ * @param extent The block in this segment.
+ * @param target The segment to append it to.
+ * @param copied Set to where the block was written in target.
+ * @return true if the block was copied.
+ */
+bool EventSegment::copy(const Extent& extent, EventSegment& target, Extent& copied) const {
+    QByteArray compressed;
+    {
+        QMutexLocker locker(&mutex);
+        if (opened && file.seek(extent.offset)) {
+            compressed = file.read(extent.size);
+        }
+    }
+    if (compressed.size() != extent.size) return false;
+
+    QMutexLocker locker(&target.mutex);
+    if (!target.opened || !appendBytes(target.file, compressed, copied)) {
+        return false;
+    }
+    copied.count = extent.count;
+    return true;
+}
+
+/**
+ * @brief Gets the size of the file, including blocks no calendar refers to anymore.
+ * @return The size in bytes.
+ */
+qint64 EventSegment::size() const {
+    QMutexLocker locker(&mutex);
+    return opened ? file.size() : 0;
+}
@@ -0,0 +1,55 @@
+/**
+ * @file eventsegment.h
+ * @brief Defines the EventSegment class.
+ *
+ * Keeps events that are outside the working window on disk instead of in memory.
+ */
+#ifndef EVENTSEGMENT_H
+#define EVENTSEGMENT_H
+
+#include <QList>
+#include <QMutex>
+#include <QTemporaryFile>
+#include "event.h"
+#include "user.h"
+
+/**
+ * @class EventSegment
+ * @brief Append-only file of compressed event blocks.
+ *
+ * append() writes a block of events and returns its extent; read() decodes
+ * the events of an extent again. Blocks are never rewritten, so an extent
+ * stays readable for as long as the segment is alive, whichever calendar
+ * snapshot still refers to it. The file is a cache of the current session and
+ * is removed when the segment is destroyed; the journal stays the saved state.
+ * Every method may be called from any thread.
+ */
+class EventSegment {
+public:
+    /**
+     * @struct Extent
+     * @brief Where one block of events was written.
+     */
+    struct Extent {
+        qint64 offset = 0;
+        qint64 size = 0;  // compressed bytes
+        qint32 count = 0; // events in the block
+    };
+
+private:
+    mutable QMutex mutex;
+    mutable QTemporaryFile file;
+    bool opened;
+
+public:
+    EventSegment();
+    EventSegment(const EventSegment&) = delete;
+    EventSegment& operator=(const EventSegment&) = delete;
+
+    bool append(const QList<Event*>& events, Extent& extent);
+    QList<Event*> read(const Extent& extent, User* owner) const;
+    bool copy(const Extent& extent, EventSegment& target, Extent& copied) const;
+    qint64 size() const;
+};
+
+#endif // EVENTSEGMENT_H
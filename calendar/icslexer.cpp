@@ -0,0 +1,222 @@
+/**
+ * @file icslexer.cpp
+ * @brief Implementation of the IcsLexer and IcsContentLine classes
+ */
+#include "icslexer.h"
+#include <functional>
+
+/**
+ * @brief Checks the property name, ignoring case.
+ * @param propertyName The name, such as "DTSTART".
+ * @return true if this line is that property.
+ */
+bool IcsContentLine::is(QLatin1String propertyName) const {
+    return name.compare(propertyName, Qt::CaseInsensitive) == 0;
+}
+
+/**
+ * @brief Checks for BEGIN of a component.
+ * @param component The component, such as "VEVENT".
+ * @return true if this line opens it.
+ */
+bool IcsContentLine::isBegin(QLatin1String component) const {
+    return is(QLatin1String("BEGIN")) && value.trimmed().compare(component, Qt::CaseInsensitive) == 0;
+}
+
+/**
+ * @brief Checks for END of a component.
+ * @param component The component, such as "VEVENT".
+ * @return true if this line closes it.
+ */
+bool IcsContentLine::isEnd(QLatin1String component) const {
+    return is(QLatin1String("END")) && value.trimmed().compare(component, Qt::CaseInsensitive) == 0;
+}
+
+/**
+ * @brief Gets the value of a parameter.
+ * @param parameterName The parameter, such as "TZID".
+ * @return The value, or an empty view if the parameter is absent.
+ */
+QStringView IcsContentLine::parameter(QLatin1String parameterName) const {
+    for (const Parameter& parameter : parameters) {
+        if (parameter.name.compare(parameterName, Qt::CaseInsensitive) == 0) {
+            return parameter.value;
+        }
+    }
+    return QStringView();
+}
+
+/**
+ * @brief Gets the value as text.
+ * @return The unescaped value.
+ */
+QString IcsContentLine::text() const {
+    return unescape(value);
+}
+
+/**
+ * @brief Resolves TEXT escapes: \n, \N, \,, \; and \\.
+ * @param value The escaped value.
+ * @return The text; values without a backslash are copied as they are.
+ */
+QString IcsContentLine::unescape(QStringView value) {
+    qsizetype backslash = value.indexOf(u'\\');
+    if (backslash < 0) {
+        return value.toString();
+    }
+
+    QString text;
+    text.reserve(value.size());
+    text.append(value.left(backslash));
+    for (qsizetype i = backslash; i < value.size(); i++) {
+        QChar c = value[i];
+        if (c == u'\\' && i + 1 < value.size()) {
+            QChar escaped = value[++i];
+            if (escaped == u'n' || escaped == u'N') {
+                text.append(u'\n');
+            }
+            else {
+                // \, \; \\ and, leniently, any other escaped character
+                text.append(escaped);
+            }
+        }
+        else {
+            text.append(c);
+        }
+    }
+    return text;
+}
+
+/**
+ * @brief Creates a lexer over a whole feed.
+ * @param content The feed; it must outlive the lexer.
+ */
+IcsLexer::IcsLexer(QStringView content)
+    : content(content), position(0) {}
+
+/**
+ * @brief Reads the next content line.
+ * @param line Receives the line.
+ * @return false at the end of the feed.
+ */
+bool IcsLexer::next(IcsContentLine& line) {
+    while (position < content.size()) {
+        qsizetype next;
+        qsizetype end = lineEnd(position, next);
+        QStringView logical = content.sliced(position, end - position);
+
+        // a following line starting with a space or tab continues this one
+        if (next < content.size() && (content[next] == u' ' || content[next] == u'\t')) {
+            unfolded.truncate(0);
+            unfolded.append(logical);
+            while (next < content.size() && (content[next] == u' ' || content[next] == u'\t')) {
+                qsizetype continuation = next + 1;
+                end = lineEnd(continuation, next);
+                unfolded.append(content.sliced(continuation, end - continuation));
+            }
+            logical = unfolded;
+        }
+        position = next;
+
+        if (split(logical, line)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Gets how far the lexer has read.
+ * @return The offset of the next line in the feed.
+ */
+qsizetype IcsLexer::getPosition() const {
+    return position;
+}
+
+/**
+ * @brief Checks whether a view points into the feed rather than the unfold buffer.
+ * @param view A part of a line returned by next().
+ * @return true if the view stays valid for as long as the feed does.
+ */
+bool IcsLexer::isInFeed(QStringView view) const {
+    std::less_equal<const QChar*> before;
+    return before(content.data(), view.data()) && before(view.data() + view.size(), content.data() + content.size());
+}
+
+/**
+ * @brief Finds the end of a physical line.
+ * @param from The offset of the line.
+ * @param next Receives the offset of the following line.
+ * @return The offset just past the line's text, without CR or LF.
+ */
+qsizetype IcsLexer::lineEnd(qsizetype from, qsizetype& next) const {
+    qsizetype newline = content.indexOf(u'\n', from);
+    if (newline < 0) {
+        next = content.size();
+        newline = content.size();
+    }
+    else {
+        next = newline + 1;
+    }
+
+    qsizetype end = newline;
+    if (end > from && content[end - 1] == u'\r') {
+        end--;
+    }
+    return end;
+}
+
+/**
+ * @brief Splits a logical line into name, parameters and value.
+ * @param line The unfolded line.
+ * @param result Receives the parts.
+ * @return false if the line is not a content line.
+ */
+bool IcsLexer::split(QStringView line, IcsContentLine& result) {
+    result.raw = line;
+    result.parameters.clear();
+
+    qsizetype i = 0;
+    const qsizetype size = line.size();
+    while (i < size && line[i] != u';' && line[i] != u':') {
+        i++;
+    }
+    if (i == 0 || i == size) return false;
+    result.name = line.first(i);
+
+    while (i < size && line[i] == u';') {
+        qsizetype nameStart = ++i;
+        while (i < size && line[i] != u'=' && line[i] != u';' && line[i] != u':') {
+            i++;
+        }
+        IcsContentLine::Parameter parameter{line.sliced(nameStart, i - nameStart), QStringView()};
+        if (i < size && line[i] == u'=') {
+            i++;
+            if (i < size && line[i] == u'"') {
+                // quoted values may contain ';' and ':'
+                qsizetype valueStart = ++i;
+                while (i < size && line[i] != u'"') {
+                    i++;
+                }
+                parameter.value = line.sliced(valueStart, i - valueStart);
+                if (i < size) i++;
+                // anything up to the next separator belongs to a list of values
+                while (i < size && line[i] != u';' && line[i] != u':') {
+                    i++;
+                }
+            }
+            else {
+                qsizetype valueStart = i;
+                while (i < size && line[i] != u';' && line[i] != u':') {
+                    i++;
+                }
+                parameter.value = line.sliced(valueStart, i - valueStart);
+            }
+        }
+        result.parameters.append(parameter);
+    }
+
+    if (i >= size || line[i] != u':') return false;
+    result.value = line.sliced(i + 1);
+    return true;
+}
@@ -0,0 +1,68 @@
+/**
+ * @file icslexer.h
+ * @brief Defines the IcsLexer and IcsContentLine classes.
+ *
+ * Splits iCalendar text into RFC 5545 content lines.
+ */
+#ifndef ICSLEXER_H
+#define ICSLEXER_H
+
+#include <QString>
+#include <QStringView>
+#include <QVarLengthArray>
+
+/**
+ * @class IcsContentLine
+ * @brief One unfolded content line: NAME *(";" param) ":" value.
+ *
+ * Every part is a view into the feed, or into the lexer's unfold buffer for
+ * folded lines, so a line is only valid until the lexer reads the next one.
+ * Values stay escaped until text() is called.
+ */
+class IcsContentLine {
+public:
+    struct Parameter {
+        QStringView name;
+        QStringView value; // without surrounding quotes
+    };
+
+    QStringView raw;
+    QStringView name;
+    QVarLengthArray<Parameter, 4> parameters;
+    QStringView value;
+
+    bool is(QLatin1String propertyName) const;
+    bool isBegin(QLatin1String component) const;
+    bool isEnd(QLatin1String component) const;
+    QStringView parameter(QLatin1String parameterName) const;
+    QString text() const;
+
+    static QString unescape(QStringView value);
+};
+
+/**
+ * @class IcsLexer
+ * @brief Reads content lines from a feed in a single pass.
+ *
+ * Handles CRLF and bare LF line endings. Folded lines (continuations starting
+ * with a space or tab) are joined in one reusable buffer; unfolded lines,
+ * nearly all of a typical feed, are never copied. Lines without a ':' are skipped.
+ */
+class IcsLexer {
+private:
+    QStringView content;
+    qsizetype position;
+    QString unfolded;
+
+    qsizetype lineEnd(qsizetype from, qsizetype& next) const;
+    static bool split(QStringView line, IcsContentLine& result);
+
+public:
+    explicit IcsLexer(QStringView content);
+
+    bool next(IcsContentLine& line);
+    qsizetype getPosition() const;
+    bool isInFeed(QStringView view) const;
+};
+
+#endif // ICSLEXER_H
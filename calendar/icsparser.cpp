@@ -0,0 +1,314 @@
+/**
+ * @file icsparser.cpp
+ * @brief Implementation of the IcsParser class
+ */
+#include "icsparser.h"
+#include "idallocator.h"
+#include "metrics.h"
+#include "trace.h"
+#include <QDateTime>
+#include <QtEndian>
+
+/**
+ * @brief Parses every event of a feed.
+ * @param content The whole ICS file; events are parsed straight from it, without splitting.
+ * @param user The user to assign the events to.
+ * @return The parsed events, owned by the caller, with IDs from the IdAllocator.
+ *
+ * The events share text arenas of up to maxArenaSize bytes, each trimmed to size
+ * once full or once the feed is read.
+ */
+QList<Event*> IcsParser::parse(const QString& content, User* user) {
+    TRACE_SCOPE("IcsParser::parse");
+    QList<Event*> parsed;
+    textArena = std::make_shared<QByteArray>();
+
+    IcsLexer lexer(content);
+    IcsContentLine line;
+    while (lexer.next(line)) {
+        if (line.isBegin(QLatin1String("VEVENT"))) {
+            if (Event* newEvent = parseICSEvent(lexer, user)) {
+                parsed.append(newEvent);
+            }
+        }
+        else if (line.isBegin(QLatin1String("VTIMEZONE"))) {
+            // the resolver reads the whole block as unfolded lines
+            QStringList timeZoneLines{line.raw.toString()};
+            while (lexer.next(line)) {
+                timeZoneLines.append(line.raw.toString());
+                if (line.isEnd(QLatin1String("VTIMEZONE"))) break;
+            }
+            timeZones.addVTimeZone(timeZoneLines);
+        }
+    }
+
+    // events only read their arena from here on
+    sealArena();
+
+    Metrics::add(Metrics::EventsParsed, parsed.size());
+    return parsed;
+}
+
+/**
+ * @brief Parses the properties of one event.
+ * @param lexer The lexer, positioned just after BEGIN:VEVENT. It is left after END:VEVENT.
+ * @param user The user to assign the event to.
+ * 
+ * @return A pointer to the parsed event, or nullptr if parsing failed.
+ *
+ * Property names and parameters follow RFC 5545, so SUMMARY;LANGUAGE=en: and
+ * DTSTART;TZID=...: are read like their plain forms. Text values are copied to
+ * the text arena still escaped, the event unescapes them when they are read.
+ * Nested components such as VALARM are skipped.
+ * The end comes from DTEND or DURATION; without either, an all-day event lasts
+ * one day and a timed event has no duration.
+ */
+Event* IcsParser::parseICSEvent(IcsLexer& lexer, User* user) {
+    TRACE_SCOPE("IcsParser::parseICSEvent");
+
+    // the last value of each text property, copied only from folded lines, which the lexer reuses
+    QStringView values[Event::TextFieldCount];
+    QString folded[Event::TextFieldCount];
+    auto keep = [&](Event::TextField field, QStringView value) {
+        if (lexer.isInFeed(value)) {
+            values[field] = value;
+        } else {
+            folded[field] = value.toString();
+            values[field] = folded[field];
+        }
+    };
+    qint64 startUtc = 0;
+    bool hasStart = false;
+    bool hasStartProperty = false;
+    bool isAllDay = false;
+    qint64 endUtc = 0;
+    bool hasEnd = false;
+    qint64 duration = -1;
+
+    IcsContentLine line;
+    while (lexer.next(line)) {
+        if (line.isEnd(QLatin1String("VEVENT"))) {
+            break;
+        }
+        else if (line.is(QLatin1String("BEGIN"))) {
+            skipComponent(lexer, line.value.trimmed());
+        }
+        else if (line.is(QLatin1String("SUMMARY"))) {
+            keep(Event::Title, line.value);
+        }
+        else if (line.is(QLatin1String("DESCRIPTION"))) {
+            keep(Event::Description, line.value);
+        }
+        else if (line.is(QLatin1String("LOCATION"))) {
+            keep(Event::Location, line.value);
+        }
+        else if (line.is(QLatin1String("DTSTART"))) {
+            // DTSTART:value, DTSTART;TZID=zone:value or DTSTART;VALUE=DATE:value
+            hasStartProperty = true;
+            hasStart = parseICSDateTime(line.parameter(QLatin1String("TZID")), line.value.trimmed(), startUtc);
+            isAllDay = !line.value.contains(u'T');
+        }
+        else if (line.is(QLatin1String("DTEND"))) {
+            hasEnd = parseICSDateTime(line.parameter(QLatin1String("TZID")), line.value.trimmed(), endUtc);
+        }
+        else if (line.is(QLatin1String("DURATION"))) {
+            if (!parseDuration(line.value.trimmed(), duration)) {
+                duration = -1;
+            }
+        }
+    }
+
+    bool hasSummary = hasText(values[Event::Title]);
+    if (hasSummary && hasStart) {
+        // only accepted events take arena space, one value per field
+        qsizetype required = sizeof(TextSpan) * Event::TextFieldCount;
+        for (QStringView value : values) {
+            required += textEncoder.requiredSpace(value.size());
+        }
+        if (!textArena->isEmpty() && textArena->size() + required > maxArenaSize) {
+            sealArena();
+            textArena = std::make_shared<QByteArray>();
+        }
+
+        TextSpan texts[Event::TextFieldCount];
+        for (int field = 0; field < Event::TextFieldCount; field++) {
+            if (!values[field].isEmpty()) {
+                texts[field] = appendText(values[field]);
+            }
+        }
+
+        // the event's header: where each of its values is
+        qsizetype header = textArena->size();
+        textArena->resize(header + sizeof(texts));
+        for (int field = 0; field < Event::TextFieldCount; field++) {
+            char* entry = textArena->data() + header + field * sizeof(TextSpan);
+            qToUnaligned(texts[field].offset, entry);
+            qToUnaligned(texts[field].length, entry + sizeof(quint32));
+        }
+
+        Event* event = new Event(IdAllocator::next(IdAllocator::Events), textArena, quint32(header), startUtc, user);
+        if (hasEnd) {
+            event->setEndUtc(endUtc);
+        }
+        else if (duration >= 0) {
+            event->setEndUtc(startUtc + duration);
+        }
+        else if (isAllDay) {
+            event->setEndUtc(startUtc + 86400);
+        }
+        return event;
+    }
+
+    if (!hasSummary) {
+        Metrics::add(Metrics::ParseErrorMissingSummary);
+    }
+    else {
+        Metrics::add(hasStartProperty ? Metrics::ParseErrorBadDateTime : Metrics::ParseErrorMissingStart);
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Trims the current text arena to size; it is not written again.
+ */
+void IcsParser::sealArena() {
+    textArena->squeeze();
+    textArena.reset();
+}
+
+/**
+ * @brief Copies an escaped text value to the text arena as UTF-8.
+ * @param value The value, as the lexer returned it.
+ * @return Where it was copied.
+ */
+IcsParser::TextSpan IcsParser::appendText(QStringView value) {
+    QByteArray& arena = *textArena;
+    qsizetype offset = arena.size();
+    qsizetype needed = offset + textEncoder.requiredSpace(value.size());
+    if (needed > arena.capacity()) {
+        arena.reserve(qMax(needed, qMin(2 * arena.capacity(), maxArenaSize)));
+    }
+    arena.resize(needed);
+    char* end = textEncoder.appendToBuffer(arena.data() + offset, value);
+    arena.resize(end - arena.constData());
+    return TextSpan{quint32(offset), quint32(arena.size() - offset)};
+}
+
+/**
+ * @brief Checks whether an escaped value is still text once unescaped and trimmed.
+ * @param value The escaped value.
+ * @return true if it is not empty; only values with escapes are unescaped to tell.
+ */
+bool IcsParser::hasText(QStringView value) {
+    QStringView trimmed = value.trimmed();
+    if (trimmed.isEmpty()) return false;
+    if (!trimmed.contains(u'\\')) return true;
+    return !IcsContentLine::unescape(value).trimmed().isEmpty();
+}
+
+/**
+ * @brief Parses an ICS date-time value into UTC.
+ * @param tzid The TZID parameter, or an empty view for none.
+ * @param value The value: a DATE, a UTC DATE-TIME ending in 'Z', or a local DATE-TIME.
+ * @param utcSeconds Receives the start in seconds since the epoch (UTC).
+ * @return true if the value was parsed.
+ *
+ * Local times use the TZID parameter when it resolves, and the system's local
+ * time otherwise (floating times). Dates resolve to local midnight.
+ */
+bool IcsParser::parseICSDateTime(QStringView tzid, QStringView value, qint64& utcSeconds) {
+    qint64 wallSeconds;
+    bool isUtc, isDateOnly;
+    if (!TimeZoneResolver::parseWallClock(value, wallSeconds, isUtc, isDateOnly)) {
+        return false;
+    }
+
+    if (isUtc) {
+        utcSeconds = wallSeconds;
+        return true;
+    }
+
+    if (!isDateOnly && !tzid.isEmpty()) {
+        if (timeZones.toUtc(tzid, wallSeconds, utcSeconds)) {
+            return true;
+        }
+        Metrics::add(Metrics::TimeZoneFallbacks);
+    }
+
+    // floating time: the wall clock of whoever is looking at it
+    QDateTime wall = QDateTime::fromSecsSinceEpoch(wallSeconds, QTimeZone::UTC);
+    utcSeconds = QDateTime(wall.date(), wall.time()).toSecsSinceEpoch();
+    return true;
+}
+
+/**
+ * @brief Parses an ICS duration such as PT1H30M, P1D or P2W.
+ * @param value The value.
+ * @param seconds Receives the duration in seconds; negative for durations starting with '-'.
+ * @return true if the value was parsed.
+ *
+ * Days count as 86400 seconds, which is off by an hour across a DST change.
+ */
+bool IcsParser::parseDuration(QStringView value, qint64& seconds) {
+    qsizetype i = 0;
+    bool negative = false;
+    if (i < value.size() && (value[i] == u'+' || value[i] == u'-')) {
+        negative = value[i] == u'-';
+        i++;
+    }
+    if (i >= value.size() || value[i] != u'P') return false;
+    i++;
+
+    bool inTime = false;
+    bool hasPart = false;
+    qint64 total = 0;
+    while (i < value.size()) {
+        if (value[i] == u'T') {
+            if (inTime) return false;
+            inTime = true;
+            i++;
+            continue;
+        }
+
+        qint64 number = 0;
+        qsizetype digits = 0;
+        while (i < value.size() && value[i].isDigit() && digits < 9) {
+            number = number * 10 + value[i].digitValue();
+            i++;
+            digits++;
+        }
+        if (digits == 0 || i >= value.size()) return false;
+
+        char16_t unit = value[i].unicode();
+        i++;
+        if (!inTime && unit == u'W') total += number * 7 * 86400;
+        else if (!inTime && unit == u'D') total += number * 86400;
+        else if (inTime && unit == u'H') total += number * 3600;
+        else if (inTime && unit == u'M') total += number * 60;
+        else if (inTime && unit == u'S') total += number;
+        else return false;
+        hasPart = true;
+    }
+    if (!hasPart) return false;
+
+    seconds = negative ? -total : total;
+    return true;
+}
+
+/**
+ * @brief Skips a nested component and everything inside it.
+ * @param lexer The lexer, positioned just after the component's BEGIN line.
+ * @param component The component name.
+ */
+void IcsParser::skipComponent(IcsLexer& lexer, QStringView component) {
+    // the name views the current line, which the next read may overwrite
+    QString name = component.toString();
+    int depth = 1;
+    IcsContentLine line;
+    while (depth > 0 && lexer.next(line)) {
+        bool isBegin = line.is(QLatin1String("BEGIN"));
+        if ((isBegin || line.is(QLatin1String("END"))) && line.value.trimmed().compare(name, Qt::CaseInsensitive) == 0) {
+            depth += isBegin ? 1 : -1;
+        }
+    }
+}
@@ -0,0 +1,71 @@
+/**
+ * @file icsparser.h
+ * @brief Defines the IcsParser class.
+ *
+ * Parses ICS (iCalendar) feeds into Event objects.
+ */
+#ifndef ICSPARSER_H
+#define ICSPARSER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QStringEncoder>
+#include <QStringList>
+#include <memory>
+#include "event.h"
+#include "icslexer.h"
+#include "timezoneresolver.h"
+#include "user.h"
+
+/**
+ * @class IcsParser
+ * @brief Parses ICS feeds into events with UTC start times.
+ *
+ * Start times with a TZID are resolved through the feed's VTIMEZONE blocks, or
+ * through the system time zone database for zones the feed does not define.
+ * Time zones must be defined before the events using them, as every producer
+ * we have seen does. Use one parser per feed.
+ *
+ * Summary, description and location are not decoded: their escaped values are
+ * copied as UTF-8 into one text arena per feed, shared by its events, which
+ * decode a field when it is first read. The arena grows while the feed is
+ * parsed, so events are only handed out by parse(), once it is sealed.
+ */
+class IcsParser {
+private:
+    /**
+     * @struct TextSpan
+     * @brief Where one escaped value is in the text arena.
+     */
+    struct TextSpan {
+        quint32 offset = 0;
+        quint32 length = 0;
+    };
+
+    // a feed needing more starts a new arena; 1 GiB keeps offsets and sizes within
+    // int, as qCompress and 32-bit builds need
+    static constexpr qsizetype maxArenaSize = qsizetype(1) << 30;
+
+    TimeZoneResolver timeZones;
+    std::shared_ptr<QByteArray> textArena;
+    QStringEncoder textEncoder{QStringEncoder::Utf8, QStringEncoder::Flag::Stateless};
+
+    Event* parseICSEvent(IcsLexer& lexer, User* user);
+    void skipComponent(IcsLexer& lexer, QStringView component);
+    void sealArena();
+    TextSpan appendText(QStringView value);
+    static bool hasText(QStringView value);
+
+public:
+    IcsParser() = default;
+    IcsParser(const IcsParser&) = delete;
+    IcsParser& operator=(const IcsParser&) = delete;
+
+    QList<Event*> parse(const QString& content, User* user);
+    bool parseICSDateTime(QStringView tzid, QStringView value, qint64& utcSeconds);
+
+    static bool parseDuration(QStringView value, qint64& seconds);
+};
+
+#endif // ICSPARSER_H
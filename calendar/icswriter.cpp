@@ -0,0 +1,285 @@
+/**
+ * @file icswriter.cpp
+ * @brief Implementation of the IcsWriter class
+ */
+#include "icswriter.h"
+#include <QDateTime>
+
+namespace {
+
+constexpr qsizetype flushThreshold = 64 * 1024;
+constexpr int maxLineOctets = 75;
+
+/**
+ * Length of the UTF-8 sequence starting with a byte, so a fold never lands inside one.
+ */
+int sequenceLength(uchar lead) {
+    if (lead < 0xC0) return 1;
+    if (lead < 0xE0) return 2;
+    if (lead < 0xF0) return 3;
+    return 4;
+}
+
+}
+
+/**
+ * @brief Creates a writer for an open device.
+ * @param device The device to write to.
+ */
+IcsWriter::IcsWriter(QIODevice* device)
+    : device(device), encoder(QStringEncoder::Utf8),
+      stamp(formatUtc(QDateTime::currentSecsSinceEpoch())),
+      bytesWritten(0), eventsWritten(0), ok(true) {
+    buffer.reserve(flushThreshold + 4096);
+}
+
+/**
+ * @brief Writes the calendar header.
+ * @param name The calendar name shown by clients, or empty for none.
+ */
+void IcsWriter::beginCalendar(const QString& name) {
+    writeLine("BEGIN:VCALENDAR");
+    writeLine("VERSION:2.0");
+    writeLine("PRODID:-//Alignify//Alignify//EN");
+    writeLine("CALSCALE:GREGORIAN");
+    if (!name.isEmpty()) {
+        writeProperty("X-WR-CALNAME", name);
+    }
+}
+
+/**
+ * @brief Writes one event.
+ * @param event The event.
+ * @param attendees The users available for it, written as attendees.
+ */
+void IcsWriter::writeEvent(const Event* event, const QList<const User*>& attendees) {
+    if (!event) return;
+
+    const User* organizer = event->getOrganizer();
+    writeLine("BEGIN:VEVENT");
+    writeProperty("UID", QString("alignify-%1-%2@alignify")
+                             .arg(organizer ? organizer->getPersonID() : 0)
+                             .arg(event->getEventID()));
+    buffer += "DTSTAMP:";
+    buffer += stamp;
+    buffer += "\r\n";
+    writeUtcProperty("DTSTART", event->getStartUtc());
+    if (event->getEndUtc() > event->getStartUtc()) {
+        writeUtcProperty("DTEND", event->getEndUtc());
+    }
+    // exports pass over whole calendars, read the text without caching it
+    writeProperty("SUMMARY", event->readText(Event::Title));
+    QString description = event->readText(Event::Description);
+    if (!description.isEmpty()) {
+        writeProperty("DESCRIPTION", description);
+    }
+    QString location = event->readText(Event::Location);
+    if (!location.isEmpty()) {
+        writeProperty("LOCATION", location);
+    }
+    for (const User* attendee : attendees) {
+        // CN is quoted, so only a double quote needs replacing
+        QString name = attendee->getFullName();
+        name.replace('"', '\'');
+        writeProperty(QString("ATTENDEE;CN=\"%1\";PARTSTAT=NEEDS-ACTION").arg(name).toUtf8().constData(),
+                      QString("urn:alignify:user:%1").arg(attendee->getPersonID()));
+    }
+    writeLine("END:VEVENT");
+
+    eventsWritten++;
+    flushIfFull();
+}
+
+/**
+ * @brief Writes the calendar footer.
+ */
+void IcsWriter::endCalendar() {
+    writeLine("END:VCALENDAR");
+}
+
+/**
+ * @brief Hands everything still buffered to the device.
+ * @return true if every write succeeded.
+ */
+bool IcsWriter::finish() {
+    if (!buffer.isEmpty()) {
+        ok = ok && device->write(buffer) == buffer.size();
+        bytesWritten += buffer.size();
+        buffer.clear();
+    }
+    return ok;
+}
+
+/**
+ * @brief Writes a whole calendar.
+ * @param calendar The calendar; its current snapshot is written, spilled events included.
+ * @param name The calendar name.
+ * @return true if every write succeeded.
+ */
+bool IcsWriter::writeCalendar(const Calendar* calendar, const QString& name) {
+    std::shared_ptr<const Calendar::Snapshot> snapshot = calendar->snapshot();
+
+    beginCalendar(name);
+    for (const Event* event : snapshot->events) {
+        writeEvent(event);
+    }
+    // and the months spilled out of the horizon, read back one block at a time
+    for (const QList<EventSegment::Extent>& extents : snapshot->spilled) {
+        for (const EventSegment::Extent& extent : extents) {
+            QList<Event*> spilled = calendar->readSpilled(snapshot, extent);
+            for (const Event* event : spilled) {
+                writeEvent(event);
+            }
+            qDeleteAll(spilled);
+        }
+    }
+    endCalendar();
+    return finish();
+}
+
+/**
+ * @brief Gets how much was handed to the device.
+ * @return The bytes written so far.
+ */
+qint64 IcsWriter::getBytesWritten() const {
+    return bytesWritten;
+}
+
+/**
+ * @brief Gets how many events were written.
+ * @return The events written so far.
+ */
+qint64 IcsWriter::getEventsWritten() const {
+    return eventsWritten;
+}
+
+/**
+ * @brief Formats a UTC DATE-TIME value.
+ * @param utcSeconds Seconds since the epoch.
+ * @return The value, such as 20240131T143000Z.
+ */
+QByteArray IcsWriter::formatUtc(qint64 utcSeconds) {
+    qint64 days = utcSeconds / 86400;
+    qint64 seconds = utcSeconds % 86400;
+    if (seconds < 0) {
+        seconds += 86400;
+        days--;
+    }
+
+    // civil date from days since 1970-01-01
+    qint64 z = days + 719468;
+    qint64 era = (z >= 0 ? z : z - 146096) / 146097;
+    qint64 dayOfEra = z - era * 146097;
+    qint64 yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    qint64 dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    qint64 monthIndex = (5 * dayOfYear + 2) / 153;
+    int day = int(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    int month = int(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    int year = int(yearOfEra + era * 400 + (month <= 2 ? 1 : 0));
+
+    char text[17];
+    int fields[] = {year, month, day, int(seconds / 3600), int(seconds / 60 % 60), int(seconds % 60)};
+    int widths[] = {4, 2, 2, 2, 2, 2};
+    int position = 0;
+    for (int i = 0; i < 6; i++) {
+        if (i == 3) {
+            text[position++] = 'T';
+        }
+        for (int digit = widths[i] - 1; digit >= 0; digit--) {
+            text[position + digit] = char('0' + fields[i] % 10);
+            fields[i] /= 10;
+        }
+        position += widths[i];
+    }
+    text[position++] = 'Z';
+    return QByteArray(text, position);
+}
+
+/**
+ * @brief Writes a line that needs no escaping or folding.
+ * @param line The line without its CRLF.
+ */
+void IcsWriter::writeLine(const char* line) {
+    buffer += line;
+    buffer += "\r\n";
+}
+
+/**
+ * @brief Writes a text property, escaped and folded.
+ * @param name The property name with any parameters, in ASCII.
+ * @param value The value.
+ */
+void IcsWriter::writeProperty(const char* name, QStringView value) {
+    // encode into the reusable scratch buffer, no allocation once it is big enough
+    qsizetype space = encoder.requiredSpace(value.size());
+    if (utf8.size() < space) {
+        utf8.resize(space);
+    }
+    char* end = encoder.appendToBuffer(utf8.data(), value);
+    const char* bytes = utf8.constData();
+    qsizetype length = end - bytes;
+
+    int lineOctets = 0;
+    for (const char* c = name; *c; c++) {
+        if (lineOctets == maxLineOctets) {
+            buffer += "\r\n ";
+            lineOctets = 1;
+        }
+        buffer += *c;
+        lineOctets++;
+    }
+    buffer += ':';
+    lineOctets++;
+
+    for (qsizetype i = 0; i < length;) {
+        uchar byte = uchar(bytes[i]);
+        char escaped[2] = {'\\', 0};
+        const char* piece = bytes + i;
+        int pieceLength = 1;
+
+        switch (byte) {
+        case '\\': escaped[1] = '\\'; break;
+        case ';': escaped[1] = ';'; break;
+        case ',': escaped[1] = ','; break;
+        case '\n': escaped[1] = 'n'; break;
+        case '\r': i++; continue;
+        default: pieceLength = int(qMin<qsizetype>(sequenceLength(byte), length - i)); break;
+        }
+        qsizetype consumed = pieceLength;
+        if (escaped[1]) {
+            piece = escaped;
+            pieceLength = 2;
+            consumed = 1;
+        }
+
+        if (lineOctets + pieceLength > maxLineOctets) {
+            buffer += "\r\n ";
+            lineOctets = 1;
+        }
+        buffer.append(piece, pieceLength);
+        lineOctets += pieceLength;
+        i += consumed;
+    }
+    buffer += "\r\n";
+}
+
+/**
+ * @brief Writes a UTC DATE-TIME property.
+ * @param name The property name.
+ * @param utcSeconds Seconds since the epoch.
+ */
+void IcsWriter::writeUtcProperty(const char* name, qint64 utcSeconds) {
+    buffer += name;
+    buffer += ':';
+    buffer += formatUtc(utcSeconds);
+    buffer += "\r\n";
+}
+
+/**
+ * @brief Hands the buffer to the device once it is large.
+ */
+void IcsWriter::flushIfFull() {
+    if (buffer.size() >= flushThreshold) {
+        finish();
+    }
+}
@@ -0,0 +1,60 @@
+/**
+ * @file icswriter.h
+ * @brief Defines the IcsWriter class.
+ *
+ * Streams calendars and scheduling results out as RFC 5545 iCalendar data.
+ */
+#ifndef ICSWRITER_H
+#define ICSWRITER_H
+
+#include <QByteArray>
+#include <QIODevice>
+#include <QList>
+#include <QString>
+#include <QStringEncoder>
+#include "calendar.h"
+#include "event.h"
+#include "user.h"
+
+/**
+ * @class IcsWriter
+ * @brief Writes VCALENDAR data straight into a QIODevice.
+ *
+ * Lines are built in one reusable buffer that is handed to the device every
+ * 64 KiB, so memory stays constant however many events are written. Text is
+ * escaped and lines are folded at 75 octets without splitting UTF-8 sequences.
+ * Start times are written in UTC.
+ */
+class IcsWriter {
+private:
+    QIODevice* device;
+    QByteArray buffer;
+    QByteArray utf8;
+    QStringEncoder encoder;
+    QByteArray stamp;
+    qint64 bytesWritten;
+    qint64 eventsWritten;
+    bool ok;
+
+    void writeLine(const char* line);
+    void writeProperty(const char* name, QStringView value);
+    void writeUtcProperty(const char* name, qint64 utcSeconds);
+    void flushIfFull();
+
+public:
+    explicit IcsWriter(QIODevice* device);
+
+    void beginCalendar(const QString& name = QString());
+    void writeEvent(const Event* event, const QList<const User*>& attendees = {});
+    void endCalendar();
+    bool finish();
+
+    bool writeCalendar(const Calendar* calendar, const QString& name);
+
+    qint64 getBytesWritten() const;
+    qint64 getEventsWritten() const;
+
+    static QByteArray formatUtc(qint64 utcSeconds);
+};
+
+#endif // ICSWRITER_H
@@ -0,0 +1,63 @@
+/**
+ * @file idallocator.cpp
+ * @brief Implementation of the IdAllocator class
+ */
+#include "idallocator.h"
+
+// IDs start at 1; 0 is left for the local user and the calendar of created events
+std::atomic<qint64> IdAllocator::nextFree[SpaceCount] = {1, 1};
+std::atomic<qint64> IdAllocator::floor[SpaceCount] = {0, 0};
+
+namespace {
+
+/**
+ * @struct IdBlock
+ * @brief The IDs a thread may still hand out without synchronizing.
+ */
+struct IdBlock {
+    qint64 next = 0;
+    qint64 end = 0;
+};
+
+// events are created in bulk by imports; users one at a time, so they stay dense
+constexpr qint64 blockSizes[IdAllocator::SpaceCount] = {1024, 1};
+
+thread_local IdBlock blocks[IdAllocator::SpaceCount];
+
+} // namespace
+
+/**
+ * @brief Allocates a new ID.
+ * @param space The kind of object the ID is for.
+ * @return An ID not returned before and above every reserved ID.
+ *
+ * Takes one atomic add per block of IDs, plus a check that no reservation
+ * overtook the block.
+ */
+qint64 IdAllocator::next(Space space) {
+    IdBlock& block = blocks[space];
+    if (block.next == block.end || block.next <= floor[space].load(std::memory_order_acquire)) {
+        qint64 size = blockSizes[space];
+        block.next = nextFree[space].fetch_add(size, std::memory_order_relaxed);
+        block.end = block.next + size;
+    }
+    return block.next++;
+}
+
+/**
+ * @brief Marks an ID as taken, so it is never allocated.
+ * @param space The kind of object the ID is for.
+ * @param id An ID restored from disk.
+ *
+ * Blocks already handed to threads are dropped if they reach down to the ID.
+ * Call it before IDs of that range are allocated, as journal replay at startup does.
+ */
+void IdAllocator::reserve(Space space, qint64 id) {
+    qint64 expected = nextFree[space].load(std::memory_order_relaxed);
+    while (expected <= id && !nextFree[space].compare_exchange_weak(expected, id + 1, std::memory_order_relaxed)) {
+    }
+
+    expected = floor[space].load(std::memory_order_relaxed);
+    while (expected < id && !floor[space].compare_exchange_weak(expected, id, std::memory_order_release)) {
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * @file idallocator.h
+ * @brief Defines the IdAllocator class.
+ *
+ * Hands out event and user IDs that are unique across the whole process.
+ */
+#ifndef IDALLOCATOR_H
+#define IDALLOCATOR_H
+
+#include <QtGlobal>
+#include <atomic>
+
+/**
+ * @class IdAllocator
+ * @brief Lock-free allocator of 64-bit IDs, one sequence per kind of object.
+ *
+ * Each thread takes a block of IDs from a shared atomic counter and hands them
+ * out without touching shared memory again until the block runs out, so parallel
+ * imports never contend. IDs are never reused; blocks a thread leaves unfinished
+ * are skipped. IDs restored from the journal are passed to reserve() before new
+ * ones are allocated, which moves every sequence and every thread's block past them.
+ */
+class IdAllocator {
+public:
+    enum Space {
+        Events,
+        Users,
+        SpaceCount
+    };
+
+private:
+    static std::atomic<qint64> nextFree[SpaceCount]; // start of the next unclaimed block
+    static std::atomic<qint64> floor[SpaceCount];    // highest reserved ID
+
+public:
+    static qint64 next(Space space);
+    static void reserve(Space space, qint64 id);
+};
+
+#endif // IDALLOCATOR_H
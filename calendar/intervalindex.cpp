@@ -0,0 +1,151 @@
+/**
+ * @file intervalindex.cpp
+ * @brief Implementation of the IntervalIndex class
+ */
+#include "intervalindex.h"
+#include <algorithm>
+
+namespace {
+
+bool startsBefore(const IntervalIndex::Entry& entry, qint64 start) {
+    return entry.start < start;
+}
+
+bool byStart(const IntervalIndex::Entry& a, const IntervalIndex::Entry& b) {
+    return a.start < b.start;
+}
+
+}
+
+/**
+ * @brief Checks whether an entry overlaps a range.
+ * @param entry The entry.
+ * @param fromUtc Start of the range.
+ * @param toUtc End of the range, exclusive.
+ * @return true if the entry overlaps, or is an instant inside the range.
+ */
+bool IntervalIndex::overlaps(const Entry& entry, qint64 fromUtc, qint64 toUtc) {
+    return entry.start < toUtc && (entry.end > fromUtc || entry.start >= fromUtc);
+}
+
+/**
+ * @brief Adds an event.
+ * @param event The event.
+ */
+void IntervalIndex::insert(Event* event) {
+    if (!event) return;
+
+    Entry entry{event->getStartUtc(), event->getEndUtc(), event};
+    if (entry.end - entry.start > shortLimit) {
+        longEntries.append(entry);
+        return;
+    }
+    auto position = std::upper_bound(shortEntries.begin(), shortEntries.end(), entry, byStart);
+    shortEntries.insert(position, entry);
+}
+
+/**
+ * @brief Adds several events at once.
+ * @param events The events.
+ *
+ * Sorts the new events and merges them in, so an import costs one pass over
+ * the existing entries instead of one per event.
+ */
+void IntervalIndex::insert(const QList<Event*>& events) {
+    qsizetype existing = shortEntries.size();
+    for (Event* event : events) {
+        if (!event) continue;
+
+        Entry entry{event->getStartUtc(), event->getEndUtc(), event};
+        if (entry.end - entry.start > shortLimit) {
+            longEntries.append(entry);
+        } else {
+            shortEntries.append(entry);
+        }
+    }
+
+    auto middle = shortEntries.begin() + existing;
+    std::stable_sort(middle, shortEntries.end(), byStart);
+    std::inplace_merge(shortEntries.begin(), middle, shortEntries.end(), byStart);
+}
+
+/**
+ * @brief Removes an event.
+ * @param event The event, unchanged since it was inserted.
+ * @return true if the event was found.
+ *
+ * Short events are found by their start, so removing costs a binary search
+ * plus the long entries.
+ */
+bool IntervalIndex::remove(Event* event) {
+    if (!event) return false;
+
+    auto it = std::lower_bound(shortEntries.begin(), shortEntries.end(), event->getStartUtc(), startsBefore);
+    for (; it != shortEntries.end() && it->start == event->getStartUtc(); ++it) {
+        if (it->event == event) {
+            shortEntries.erase(it);
+            return true;
+        }
+    }
+
+    auto matches = [event](const Entry& entry) { return entry.event == event; };
+    auto longIt = std::find_if(longEntries.begin(), longEntries.end(), matches);
+    if (longIt != longEntries.end()) {
+        longEntries.erase(longIt);
+        return true;
+    }
+
+    // indexed events never change, a calendar indexes a new version instead
+    Q_ASSERT(std::none_of(shortEntries.cbegin(), shortEntries.cend(), matches));
+    return false;
+}
+
+/**
+ * @brief Gets the events overlapping a time range.
+ * @param fromUtc Start of the range, in seconds since the epoch (UTC).
+ * @param toUtc End of the range, exclusive.
+ * @return The events, short ones ordered by start, followed by the long ones.
+ *
+ * Events without a duration count when they start inside the range.
+ */
+QList<Event*> IntervalIndex::overlapping(qint64 fromUtc, qint64 toUtc) const {
+    QList<Event*> result;
+    if (toUtc <= fromUtc) return result;
+
+    auto it = std::lower_bound(shortEntries.cbegin(), shortEntries.cend(), fromUtc - shortLimit, startsBefore);
+    for (; it != shortEntries.cend() && it->start < toUtc; ++it) {
+        if (overlaps(*it, fromUtc, toUtc)) {
+            result.append(it->event);
+        }
+    }
+    for (const Entry& entry : longEntries) {
+        if (overlaps(entry, fromUtc, toUtc)) {
+            result.append(entry.event);
+        }
+    }
+    return result;
+}
+
+/**
+ * @brief Gets the number of indexed events.
+ * @return The number of entries.
+ */
+qsizetype IntervalIndex::size() const {
+    return shortEntries.size() + longEntries.size();
+}
+
+/**
+ * @brief Gets the events up to a day long, for memory accounting.
+ * @return The entries, sorted by start.
+ */
+const QList<IntervalIndex::Entry>& IntervalIndex::getShortEntries() const {
+    return shortEntries;
+}
+
+/**
+ * @brief Gets the events longer than a day, for memory accounting.
+ * @return The entries.
+ */
+const QList<IntervalIndex::Entry>& IntervalIndex::getLongEntries() const {
+    return longEntries;
+}
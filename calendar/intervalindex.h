@@ -0,0 +1,52 @@
+/**
+ * @file intervalindex.h
+ * @brief Defines the IntervalIndex class.
+ *
+ * Finds the events overlapping a time range.
+ */
+#ifndef INTERVALINDEX_H
+#define INTERVALINDEX_H
+
+#include <QList>
+#include "event.h"
+
+/**
+ * @class IntervalIndex
+ * @brief Indexes events by their [start, end) interval.
+ *
+ * Events up to a day long are kept sorted by start, so a query only looks at
+ * events starting between a day before the range and its end. Longer events are
+ * rare and are checked one by one. Copies are implicitly shared.
+ */
+class IntervalIndex {
+public:
+    struct Entry {
+        qint64 start;
+        qint64 end;
+        Event* event;
+    };
+
+    // events longer than this go to the long list
+    static constexpr qint64 shortLimit = 86400;
+
+private:
+    QList<Entry> shortEntries; // sorted by start
+    QList<Entry> longEntries;
+
+    static bool overlaps(const Entry& entry, qint64 fromUtc, qint64 toUtc);
+
+public:
+    IntervalIndex() = default;
+
+    void insert(Event* event);
+    void insert(const QList<Event*>& events);
+    bool remove(Event* event);
+
+    QList<Event*> overlapping(qint64 fromUtc, qint64 toUtc) const;
+    qsizetype size() const;
+
+    const QList<Entry>& getShortEntries() const;
+    const QList<Entry>& getLongEntries() const;
+};
+
+#endif // INTERVALINDEX_H
@@ -0,0 +1,108 @@
+/**
+ * @file layeredcalendarwidget.cpp
+ * @brief Implementation of the LayeredCalendarWidget class
+ */
+#include "layeredcalendarwidget.h"
+#include "calendarhighlighter.h"
+#include <QPainter>
+
+/**
+ * @brief Constructs the widget.
+ * @param parent The parent widget.
+ */
+LayeredCalendarWidget::LayeredCalendarWidget(QWidget* parent) : QCalendarWidget(parent) {}
+
+/**
+ * @brief Sets where the layers of each day come from.
+ * @param highlighter The highlighter, or nullptr to paint plain cells.
+ */
+void LayeredCalendarWidget::setHighlighter(const CalendarHighlighter* highlighter) {
+    this->highlighter = highlighter;
+    updateCells();
+}
+
+/**
+ * @brief Repaints the day cells after the layers changed.
+ */
+void LayeredCalendarWidget::refreshCells() {
+    updateCells();
+}
+
+/**
+ * @brief Switches between the user layers and the busy heatmap.
+ * @param enabled true to shade the cells by the heatmap.
+ */
+void LayeredCalendarWidget::setHeatmapMode(bool enabled) {
+    heatmapMode = enabled;
+    updateCells();
+}
+
+/**
+ * @brief Checks whether the heatmap is shown.
+ * @return true in heatmap mode.
+ */
+bool LayeredCalendarWidget::isHeatmapMode() const {
+    return heatmapMode;
+}
+
+/**
+ * @brief Sets the heatmap shown in heatmap mode.
+ * @param heatmap The busy fractions of the visible days.
+ */
+void LayeredCalendarWidget::setHeatmap(const BusyHeatmap::Result& heatmap) {
+    this->heatmap = heatmap;
+    if (heatmapMode) {
+        updateCells();
+    }
+}
+
+/**
+ * @brief Paints a day cell with a band for each visible user busy that day.
+ * @param painter The painter.
+ * @param rect The cell rectangle.
+ * @param date The day.
+ *
+ * The bands share the bottom fifth of the cell, in user order. When there are
+ * more users than the cell is wide, only the first ones are drawn.
+ * In heatmap mode the cell is tinted red by the busy fraction, which is also
+ * written in its corner.
+ */
+void LayeredCalendarWidget::paintCell(QPainter* painter, const QRect& rect, QDate date) const {
+    QCalendarWidget::paintCell(painter, rect, date);
+
+    if (heatmapMode) {
+        double busy = heatmap.busyOn(date);
+        if (busy <= 0) return;
+
+        painter->save();
+        painter->fillRect(rect.adjusted(1, 1, -1, -1), QColor(220, 50, 40, 30 + int(170 * qMin(busy, 1.0))));
+        QFont font = painter->font();
+        if (font.pixelSize() > 0) {
+            font.setPixelSize(qMax(8, font.pixelSize() * 7 / 10));
+        } else {
+            font.setPointSizeF(font.pointSizeF() * 0.7);
+        }
+        painter->setFont(font);
+        painter->setPen(Qt::black);
+        painter->drawText(rect.adjusted(2, 2, -4, -2), Qt::AlignRight | Qt::AlignBottom,
+                          QString("%1%").arg(qRound(busy * 100)));
+        painter->restore();
+        return;
+    }
+    if (!highlighter) return;
+
+    QList<QColor> colors = highlighter->layerColorsOn(date);
+    if (colors.isEmpty()) return;
+
+    int bandHeight = qMax(3, rect.height() / 5);
+    QRect band(rect.left() + 1, rect.bottom() - bandHeight, rect.width() - 2, bandHeight);
+    int count = qMin(int(colors.size()), qMax(1, band.width() / 2));
+
+    painter->save();
+    for (int i = 0; i < count; i++) {
+        int left = band.left() + band.width() * i / count;
+        int right = band.left() + band.width() * (i + 1) / count;
+        painter->fillRect(QRect(left, band.top(), right - left, band.height()), colors[i]);
+    }
+    painter->restore();
+}
@@ -0,0 +1,45 @@
+/**
+ * @file layeredcalendarwidget.h
+ * @brief Defines the LayeredCalendarWidget class.
+ *
+ * A month view that paints the users' calendar layers into its day cells.
+ */
+#ifndef LAYEREDCALENDARWIDGET_H
+#define LAYEREDCALENDARWIDGET_H
+
+#include <QCalendarWidget>
+#include "busyheatmap.h"
+
+class CalendarHighlighter;
+
+/**
+ * @class LayeredCalendarWidget
+ * @brief QCalendarWidget that draws one colored band per visible user on their busy days.
+ *
+ * The bands are painted on top of the regular cell, so the day formats pushed by
+ * the highlighter still show underneath. In heatmap mode the cells are shaded by
+ * how busy everyone is instead.
+ */
+class LayeredCalendarWidget : public QCalendarWidget {
+    Q_OBJECT
+
+private:
+    const CalendarHighlighter* highlighter = nullptr;
+    BusyHeatmap::Result heatmap;
+    bool heatmapMode = false;
+
+protected:
+    void paintCell(QPainter* painter, const QRect& rect, QDate date) const override;
+
+public:
+    explicit LayeredCalendarWidget(QWidget* parent = nullptr);
+
+    void setHighlighter(const CalendarHighlighter* highlighter);
+    void refreshCells();
+
+    void setHeatmapMode(bool enabled);
+    bool isHeatmapMode() const;
+    void setHeatmap(const BusyHeatmap::Result& heatmap);
+};
+
+#endif // LAYEREDCALENDARWIDGET_H
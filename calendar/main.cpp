@@ -1,11 +1,85 @@
 #include "mainwindow.h"
+#include "calendarmanager.h"
+#include "icsparser.h"
+#include "memoryreport.h"
+#include "metrics.h"
+#include "trace.h"
+#include "usermanager.h"
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+
+/**
+ * @brief Loads ICS feeds without the UI and prints their memory report.
+ *
+ * Each feed becomes one user named after the file, like importing it
+ * through "Create User".
+ */
+static int runMemoryReport(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("Alignify");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Prints the estimated memory used by a workspace.");
+    parser.addHelpOption();
+    QCommandLineOption reportOption("memory-report", "Load the feeds and print the memory report.");
+    QCommandLineOption jsonOption("json", "Print the report as JSON.");
+    parser.addOptions({reportOption, jsonOption});
+    parser.addPositionalArgument("feeds", "ICS files to load, one user each.", "[feeds...]");
+    parser.process(app);
+
+    for (const QString& path : parser.positionalArguments()) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+            QTextStream(stderr) << "Cannot read " << path << "\n";
+            return 1;
+        }
+        QString content = QTextStream(&file).readAll();
+
+        User* user = UserManager::getInstance()->createUser(QFileInfo(path).completeBaseName(), "");
+        Calendar* calendar = CalendarManager::getInstance()->createUserCalendar(user);
+        IcsParser icsParser;
+        calendar->addEvents(icsParser.parse(content, user));
+    }
+
+    MemoryReport report;
+    report.addWorkspace();
+    report.addCache("Metrics", Metrics::memoryUsage());
+    report.addCache("Tracer", Tracer::memoryUsage());
+
+    QTextStream out(stdout);
+    if (parser.isSet(jsonOption)) {
+        out << report.toJson().toJson();
+    }
+    else {
+        out << report.toText();
+    }
+    return 0;
+}
 
 int main(int argc, char *argv[])
 {
+    for (int i = 1; i < argc; i++) {
+        if (qstrcmp(argv[i], "--memory-report") == 0) {
+            return runMemoryReport(argc, argv);
+        }
+    }
+
     QApplication a(argc, argv);
-    MainWindow w;
-    w.show();
-    return a.exec();
+    QCoreApplication::setApplicationName("Alignify");
+    Tracer::start();
+
+    int result;
+    {
+        MainWindow w;
+        w.show();
+        result = a.exec();
+    }
+
+    Tracer::finish();
+    return result;
 }
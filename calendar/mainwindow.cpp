@@ -7,12 +7,96 @@
 #include "mainwindow.h"
 #include "ui_mainwindow.h"
 #include "eventdialog.h"
+#include "searchdialog.h"
 #include <QMessageBox>
 #include <QFileInfo>
 #include <QFileDialog>
 #include "calendarstyle.h"
 #include "calendarmanager.h"
 #include "usermanager.h"
+#include "icsparser.h"
+#include "idallocator.h"
+#include "icswriter.h"
+#include "memoryreport.h"
+#include "metrics.h"
+#include "trace.h"
+#include <QMenuBar>
+#include <QTabWidget>
+#include <QtConcurrent/QtConcurrentRun>
+#include <QPlainTextEdit>
+#include <QFontDatabase>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTimer>
+#include <QSet>
+/**
+ * @class MainWindow::DeleteUserCommand
+ * @brief Undoable deletion of a user and their calendar.
+ *
+ * The user and the calendar are detached from the managers rather than deleted,
+ * so undo puts them back with every event and index as they were, in one publish
+ * each, however many events the calendar holds.
+ */
+class MainWindow::DeleteUserCommand : public UndoCommand {
+private:
+    MainWindow* window;
+    User* user;
+    Calendar* calendar = nullptr;
+    QString name;
+    bool done = false;
+
+public:
+    DeleteUserCommand(MainWindow* window, User* user)
+        : window(window), user(user), name(user->getFullName().trimmed()) {}
+
+    /**
+     * @brief Deletes the detached user and calendar if the deletion stands.
+     */
+    ~DeleteUserCommand() override {
+        if (done) {
+            CalendarManager::getInstance()->discardCalendar(calendar);
+            UserManager::getInstance()->discardUser(user);
+        }
+    }
+
+    /**
+     * @brief Describes the command for the Undo and Redo menu items.
+     * @return The description.
+     */
+    QString text() const override {
+        return QString("Delete User '%1'").arg(name);
+    }
+
+    /**
+     * @brief Takes the user and their calendar out of the workspace.
+     */
+    void redo() override {
+        qint64 userID = user->getPersonID();
+        window->removeUserFromViews(userID);
+        calendar = CalendarManager::getInstance()->detachCalendar(userID);
+        UserManager::getInstance()->detachUser(userID);
+        window->journal->userDeleted(userID);
+        window->refreshTimelines();
+        window->updateHeatmap();
+        done = true;
+    }
+
+    /**
+     * @brief Brings the user and their calendar back.
+     */
+    void undo() override {
+        qint64 userID = user->getPersonID();
+        UserManager::getInstance()->attachUser(user);
+        CalendarManager::getInstance()->attachCalendar(calendar);
+        window->addUserToList(user, calendar);
+        window->highlighter->setLayer(userID, calendar);
+        window->journal->userCreated(user, UserManager::getInstance()->getUserColor(userID));
+        window->journal->calendarAdded(userID, calendar);
+        window->updateUserEventsList();
+        done = false;
+    }
+};
+
 /**
  * @brief Constructs the main window.
  * @param parent The parent widget.
@@ -21,6 +105,7 @@
  */
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
+    , history(std::make_unique<UndoHistory>())
     , createStrategy(std::make_unique<CreateEventStrategy>())
     , deleteStrategy(std::make_unique<DeleteEventStrategy>())
     , editStrategy(std::make_unique<EditEventStrategy>())
@@ -50,8 +135,60 @@ MainWindow::MainWindow(QWidget *parent)
     setupUI();
     createConnections();
 
-    currentUser = (new User(1, "", ""));
-    userCalendar = new Calendar(1, currentUser);
+    // the local user has an ID of their own, imported users are allocated from 1
+    currentUser = (new User(UserManager::localUserID, "", ""));
+    userCalendar = new Calendar(UserManager::localUserID, currentUser);
+
+    // restore the saved workspace, then keep saving every change
+    QString journalDirectory = qEnvironmentVariable("ALIGNIFY_DATA_DIR");
+    if (journalDirectory.isEmpty()) {
+        journalDirectory = QStandardPaths::writableLocation(QStandardPaths::AppDataLocation) + "/journal";
+    }
+    journal = std::make_unique<EventJournal>(journalDirectory);
+    bool journaling = journal->open([this](const EventJournal::Record& record) { applyJournalRecord(record); });
+    QStringList setAside = journal->getSetAsideFiles();
+    if (!journaling || !setAside.isEmpty()) {
+        // tell the user once the window is up
+        QTimer::singleShot(0, this, [this, journaling, setAside]() {
+            QString message = journaling
+                ? "Some saved data could not be read and was kept as:\n" + setAside.join('\n')
+                : "Changes cannot be saved to " + journal->getDirectory() + ".";
+            QMessageBox::warning(this, "Saved Data", message);
+        });
+    }
+
+    // keep a window of months around today in memory, as "before,after" months or "off"
+    QString horizonSetting = qEnvironmentVariable("ALIGNIFY_HORIZON");
+    if (horizonSetting == "off") {
+        horizonEnabled = false;
+    }
+    else if (!horizonSetting.isEmpty()) {
+        QStringList months = horizonSetting.split(',');
+        bool beforeOk = false;
+        bool afterOk = false;
+        int before = months.value(0).toInt(&beforeOk);
+        int after = months.value(1).toInt(&afterOk);
+        if (months.size() == 2 && beforeOk && afterOk && before >= 0 && after >= 0) {
+            horizonMonthsBefore = before;
+            horizonMonthsAfter = after;
+        }
+        else {
+            qWarning("Ignoring ALIGNIFY_HORIZON=%s, expected \"before,after\" months or \"off\"",
+                     qPrintable(horizonSetting));
+        }
+    }
+    applyHorizon();
+    updateCalendarDisplay();
+
+    // from now on views follow the calendars through their deltas, one refresh per event loop pass
+    changeSubscription = ChangeBus::getInstance()->subscribe([this](const QList<ChangeBus::Delta>& deltas) {
+        queueChanges(deltas);
+    });
+
+    // fold the journal into a snapshot once it has grown
+    QTimer* compactionTimer = new QTimer(this);
+    connect(compactionTimer, &QTimer::timeout, this, &MainWindow::compactJournal);
+    compactionTimer->start(60 * 1000);
 }
 
 /**
@@ -64,9 +201,19 @@ void MainWindow::setupUI()
 
     // Calendar section
     QVBoxLayout* calendarLayout = new QVBoxLayout();
-    calendarWidget = new QCalendarWidget();
+    calendarWidget = new LayeredCalendarWidget();
     CalendarStyle::applyStyle(calendarWidget); // Apply style to calendar
-    calendarLayout->addWidget(calendarWidget);
+    highlighter = std::make_unique<CalendarHighlighter>(calendarWidget);
+
+    // week and day timelines of the selected date
+    weekView = new TimelineView(7);
+    dayView = new TimelineView(1);
+
+    QTabWidget* calendarTabs = new QTabWidget();
+    calendarTabs->addTab(calendarWidget, "Month");
+    calendarTabs->addTab(weekView, "Week");
+    calendarTabs->addTab(dayView, "Day");
+    calendarLayout->addWidget(calendarTabs);
 
     // User + Event list section
     QVBoxLayout* rightLayout = new QVBoxLayout();
@@ -115,8 +262,12 @@ void MainWindow::setupUI()
     eventLabel->setFont(font);
     eventLabel->setAlignment(Qt::AlignCenter);
 
-    eventList = new QListWidget();
-    eventList->setStyleSheet("QListWidget::item { margin: 2px 0;}");
+    userEventsModel = new EventListModel(true, this);
+    eventList = new QListView();
+    eventList->setModel(userEventsModel);
+    eventList->setUniformItemSizes(true);
+    eventList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    eventList->setStyleSheet("QListView::item { margin: 2px 0;}");
 
     userEventsFrameLayout->addWidget(eventLabel);
     userEventsFrameLayout->addWidget(eventList);
@@ -133,8 +284,12 @@ void MainWindow::setupUI()
     createdEventLabel->setFont(font);
     createdEventLabel->setAlignment(Qt::AlignCenter);
 
-    createdEventList = new QListWidget();
-    createdEventList->setStyleSheet("QListWidget::item { margin: 2px 0;}");
+    createdEventsModel = new EventListModel(false, this);
+    createdEventList = new QListView();
+    createdEventList->setModel(createdEventsModel);
+    createdEventList->setUniformItemSizes(true);
+    createdEventList->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    createdEventList->setStyleSheet("QListView::item { margin: 2px 0;}");
 
     createEventButton = new QPushButton("Create Event");
     createEventButton->setFont(fontButton);
@@ -151,6 +306,33 @@ void MainWindow::setupUI()
     mainLayout->addLayout(rightLayout, 1);
 
     setCentralWidget(centralWidget);
+
+    // File menu
+    QMenu* fileMenu = menuBar()->addMenu("File");
+    exportAction = fileMenu->addAction("Export Created Events...");
+
+    // Edit menu
+    QMenu* editMenu = menuBar()->addMenu("Edit");
+    undoAction = editMenu->addAction("Undo");
+    undoAction->setShortcut(QKeySequence::Undo);
+    redoAction = editMenu->addAction("Redo");
+    redoAction->setShortcut(QKeySequence::Redo);
+    updateUndoActions();
+    editMenu->addSeparator();
+    findAction = editMenu->addAction("Find Events...");
+    findAction->setShortcut(QKeySequence::Find);
+
+    // View menu
+    QMenu* viewMenu = menuBar()->addMenu("View");
+    heatmapAction = viewMenu->addAction("Busy Heatmap");
+    heatmapAction->setCheckable(true);
+    heatmapWatcher = new QFutureWatcher<BusyHeatmap::Result>(this);
+
+    // Debug menu
+    QMenu* debugMenu = menuBar()->addMenu("Debug");
+    metricsAction = debugMenu->addAction("Metrics...");
+    memoryAction = debugMenu->addAction("Memory...");
+
     setWindowTitle("Alignify");
     resize(1240, 750);
 }
@@ -159,18 +341,68 @@ void MainWindow::setupUI()
  * @brief Connects widget buttons to methods.
  */
 void MainWindow::createConnections() {
+    auto onChanged = [this](const EventActionResult& result) { onEventsChanged(result); };
+    createStrategy->setListener(onChanged);
+    deleteStrategy->setListener(onChanged);
+    editStrategy->setListener(onChanged);
+    createStrategy->setHistory(history.get());
+    deleteStrategy->setHistory(history.get());
+    editStrategy->setHistory(history.get());
+
     connect(calendarWidget, &QCalendarWidget::clicked,
             this, &MainWindow::onDateSelected); // on date selected
+    connect(calendarWidget, &QCalendarWidget::currentPageChanged,
+            this, &MainWindow::onCalendarPageChanged); // on month changed
+    connect(calendarWidget, &QCalendarWidget::selectionChanged, [this]() {
+        QDate selected = calendarWidget->selectedDate();
+        if (!isInHorizon(selected.addDays(-7)) || !isInHorizon(selected.addDays(7))) {
+            applyHorizon();
+        }
+    }); // page in the week of the selected date before the timelines show it
+    connect(calendarWidget, &QCalendarWidget::selectionChanged,
+            this, &MainWindow::refreshTimelines); // week and day views follow the selected date
+    connect(weekView, &TimelineView::eventClicked,
+            this, &MainWindow::showEventDetailsDialog); // on week view event clicked
+    connect(dayView, &TimelineView::eventClicked,
+            this, &MainWindow::showEventDetailsDialog); // on day view event clicked
     connect(createEventButton, &QPushButton::clicked,
             this, &MainWindow::onCreateEventClicked); //on create event
     connect(createUserButton, &QPushButton::clicked,
             this, &MainWindow::onCreateUserClicked); // on create user
-    connect(eventList, &QListWidget::itemClicked,
+    connect(eventList, &QListView::clicked,
             this, &MainWindow::onEventItemClicked); // on USER event clicked
+    connect(userList, &QListWidget::itemPressed, [this](QListWidgetItem* item) {
+        pressedCheckState = item->checkState();
+    }); // remember the check state before a click toggles it
     connect(userList, &QListWidget::itemClicked,
             this, &MainWindow::onUserItemClicked); // on user clicked
-    connect(createdEventList, &QListWidget::itemClicked,
+    connect(userList, &QListWidget::itemChanged,
+            this, &MainWindow::onUserItemChanged); // on user shown/hidden
+    connect(createdEventList, &QListView::clicked,
             this, &MainWindow::onEventItemClicked); // on CREATED event clicked
+    connect(exportAction, &QAction::triggered, [this]() {
+        exportCalendar(userCalendar, "Created Events");
+    }); // on File > Export
+    connect(undoAction, &QAction::triggered, [this]() {
+        history->undo();
+        updateUndoActions();
+    }); // on Edit > Undo
+    connect(redoAction, &QAction::triggered, [this]() {
+        history->redo();
+        updateUndoActions();
+    }); // on Edit > Redo
+    connect(findAction, &QAction::triggered,
+            this, &MainWindow::showSearchDialog); // on Edit > Find Events
+    connect(heatmapAction, &QAction::toggled, [this](bool checked) {
+        calendarWidget->setHeatmapMode(checked);
+        updateHeatmap();
+    }); // on View > Busy Heatmap
+    connect(heatmapWatcher, &QFutureWatcher<BusyHeatmap::Result>::finished,
+            this, &MainWindow::onHeatmapFinished); // heatmap ready
+    connect(metricsAction, &QAction::triggered,
+            this, &MainWindow::showMetricsDialog); // on Debug > Metrics
+    connect(memoryAction, &QAction::triggered,
+            this, &MainWindow::showMemoryDialog); // on Debug > Memory
 }
 
 /**
@@ -250,27 +482,11 @@ void MainWindow::onCreateUserClicked() {
         // create user using calendarmanager singleton
         Calendar* newCalendar = CalendarManager::getInstance()->createUserCalendar(newUser);
 
-        users[newUser->getPersonID()] = newUser;
-        userCalendars[newUser->getPersonID()] = newCalendar;
-
-        // display user on user list
-        QString displayName = QString("%1 %2").arg(firstName, lastName);
-        QListWidgetItem* item = new QListWidgetItem(displayName, userList);
-        item->setData(Qt::UserRole, newUser->getPersonID());
-
-        // assign unique colour
-        QColor userColor = UserManager::getInstance()->getUserColor(newUser->getPersonID());
-        item->setBackground(userColor);
-
-        // text color change depending on background
-        if (userColor.lightness() < 128) {
-            item->setForeground(Qt::white);
-        }
-
+        addUserToList(newUser, newCalendar);
+        journal->userCreated(newUser, UserManager::getInstance()->getUserColor(newUser->getPersonID()));
 
         loadICSFile(selectedFile, newUser);
         //nextUserID++;
-        updateUserEventsList();
 
     }
 }
@@ -284,104 +500,31 @@ void MainWindow::onCreateUserClicked() {
  * Loads user events from an ICS file into the user's calendar.
  */
 void MainWindow::loadICSFile(const QString& filePath, User* user) {
+    TRACE_SCOPE("MainWindow::loadICSFile");
     QFile file(filePath);
     if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
         return;
 
+    qint64 importStart = Metrics::now();
+    qint64 importBytes = file.size();
+
     QTextStream in(&file);
     QString content = in.readAll();
     file.close();
 
-    // split the file into events
-    QStringList events = content.split("BEGIN:VEVENT");
-    static int nextEventID = 1;
-
     Calendar* userCalendar = CalendarManager::getInstance()->getUserCalendar(user->getPersonID());
 
-    for (int i = 1; i < events.size(); i++) { // Start from 1 to skip header
-        QStringList eventLines = events[i].split('\n');
-        Event* newEvent = parseICSEvent(eventLines, user, nextEventID);
-
-        if (newEvent) {
-            userCalendar->addEvent(newEvent);
-
-            // mark the date on calendar
-            QTextCharFormat format;
-            format.setBackground(QColor(200,230,255));
-            calendarWidget->setDateTextFormat(newEvent->getDate().date(), format);
-        }
-    }
-
-    updateUserEventsList();
-}
-
-/**
- * @brief Parses an ICS event from a list of lines.
- * @param eventLines The list of lines representing the event.
- * @param user The user to assign the event to.
- * @param nextEventID The ID of the next event.
- * 
- * @return A pointer to the parsed event, or nullptr if parsing failed.
- */
-Event* MainWindow::parseICSEvent(const QStringList& eventLines, User* user, int& nextEventID) {
-    QString summary;
-    QString description;
-    QString location;
-    QDateTime startDate;
-
-    for (const QString& line : eventLines) {
-        if (line.startsWith("SUMMARY:")) {
-            summary = line.mid(8).trimmed();
-        }
-        else if (line.startsWith("DESCRIPTION:")) {
-            description = line.mid(12).trimmed();
-        }
-        else if (line.startsWith("LOCATION:")) {
-            location = line.mid(9).trimmed();
-        }
-        else if (line.startsWith("DTSTART:")) {
-            startDate = parseICSDateTime(line.mid(8).trimmed());
-        }
-    }
+    // parse events with their start times resolved to UTC
+    IcsParser parser;
+    QList<Event*> importedEvents = parser.parse(content, user);
 
-    if (!summary.isEmpty() && startDate.isValid()) {
-        Event* event = new Event(nextEventID++, summary, description, startDate, location, user);
-        return event;
-    }
+    // publish the whole import as one calendar version
+    userCalendar->addEvents(importedEvents);
+    journal->eventsAdded(user->getPersonID(), userCalendar, importedEvents);
 
-    return nullptr;
-}
-
-/**
- * @brief Parses an ICS date-time string.
- * @param dateTimeStr The date-time string to parse.
- * @return A QDateTime object representing the parsed date-time.
- * 
- * Parses an ICS date-time string into a QDateTime object.
- */
-QDateTime MainWindow::parseICSDateTime(const QString& dateTimeStr) {
-    // handle different date-time formats
-    QRegularExpression pattern("(\\d{8})(T\\d{6}Z?)?");
-    QRegularExpressionMatch match = pattern.match(dateTimeStr);
-
-    if (match.hasMatch()) {
-        QString dateStr = match.captured(1);
-        QString timeStr = match.captured(2);
-
-        QDate date = QDate::fromString(dateStr, "yyyyMMdd");
-        QTime time;
-
-        if (!timeStr.isEmpty()) {
-            timeStr = timeStr.mid(1, 6); // Remove 'T' and 'Z'
-            time = QTime::fromString(timeStr, "HHmmss");
-        } else {
-            time = QTime(0, 0); // Default to midnight
-        }
-
-        return QDateTime(date, time);
-    }
-
-    return QDateTime();
+    Metrics::add(Metrics::ImportedFiles);
+    Metrics::add(Metrics::ImportedBytes, importBytes);
+    Metrics::add(Metrics::ImportNanoseconds, Metrics::now() - importStart);
 }
 
 /**
@@ -392,42 +535,14 @@ QDateTime MainWindow::parseICSDateTime(const QString& dateTimeStr) {
  * 
  */
 void MainWindow::onDateSelected(const QDate& date) {
-    eventList->clear();
-    createdEventList->clear();
-
-    // Populate events for created events
-    for (Event* event : userCalendar->getEvents()) {
-        if (event->getDate().date() == date) {
-            QListWidgetItem* item = new QListWidgetItem(event->getTitle(), createdEventList);
-            item->setData(Qt::UserRole, QVariant::fromValue(event));
-        }
-   }
+    TRACE_SCOPE("MainWindow::onDateSelected");
+    LatencyScope latency(Metrics::DateQueryLatency);
 
-   // get all calendars
-    QList<Calendar*> calendars = CalendarManager::getInstance()->getAllCalendars();
+    // created events
+    createdEventsModel->setDate(date, {userCalendar});
 
-    // Add events from user ics calendar
-    for (Calendar* calendar : calendars) {
-        User* user = calendar->getOwner();
-        QColor userColor = UserManager::getInstance()->getUserColor(user->getPersonID());
-        // get user events
-        for (Event* event : calendar->getEvents()) {
-            if (event->getDate().date() == date) {
-                // create display text in events list that shows title of event and organizer
-                QString displayText = QString("%1: %2")
-                    .arg(event->getOrganizerName())
-                    .arg(event->getTitle());
-
-                // create list item with display text into the events list
-                QListWidgetItem* item = new QListWidgetItem(displayText, eventList);
-
-                item->setData(Qt::UserRole, QVariant::fromValue(event));
-
-                // Set the item's background color to match the user's color
-                item->setBackground(userColor);
-            }
-        }
-    }
+    // events from user ics calendars, served from each calendar's date index
+    userEventsModel->setDate(date, CalendarManager::getInstance()->getAllCalendars());
 }
 
 /**
@@ -439,39 +554,38 @@ void MainWindow::onCreateEventClicked() {
     EventDialog dialog(this);
 
     if (dialog.exec() == QDialog::Accepted) {
-        static int nextEventID = 1;
-
         //create builder
         EventBuilder builder;
 
         // populate builder from dialog
-        dialog.getEventData(builder, nextEventID++, currentUser);
+        dialog.getEventData(builder, IdAllocator::next(IdAllocator::Events), currentUser);
 
         // build event
         Event* newEvent = builder.build();
 
         if (newEvent) {
-            createStrategy->execute(userCalendar, newEvent);
-
-            QDate selectedDate = calendarWidget->selectedDate();
-            if (newEvent->getDate().date() == selectedDate){
-                onDateSelected(selectedDate);
+            // warn about clashes before saving
+            if (!confirmConflicts(EventActions::findConflicts(userCalendar, newEvent))) {
+                delete newEvent;
+                return;
             }
 
-            QTextCharFormat format;
-            format.setBackground(Qt::lightGray); // set background of calendar for dates with events
-            calendarWidget->setDateTextFormat(newEvent->getDate().date(), format);
+            // saving, indexes and views are handled by onEventsChanged
+            createStrategy->execute(userCalendar, newEvent);
+            QMessageBox::information(this, "Success!",
+                                     "Event '" + newEvent->getTitle() + "' has been created successfully.");
         }
     }
 }
 
 /**
  * @brief Shows event dialog when an event is clicked.
+ * @param index The clicked row of either event list.
  */
-void MainWindow::onEventItemClicked(QListWidgetItem* item) {
-    Event* event = item->data(Qt::UserRole).value<Event*>();
+void MainWindow::onEventItemClicked(const QModelIndex& index) {
+    bool isCreatedEvent = (index.model() == createdEventsModel);
+    Event* event = isCreatedEvent ? createdEventsModel->eventAt(index) : userEventsModel->eventAt(index);
     if (event) {
-        bool isCreatedEvent = (item->listWidget() == createdEventList);
         showEventDetailsDialog(event, isCreatedEvent);
     }
 }
@@ -486,6 +600,7 @@ void MainWindow::onEventItemClicked(QListWidgetItem* item) {
 void MainWindow:: showEventDetailsDialog(Event* event, bool isCreatedEvent) {
     QDialog dialog(this);
     dialog.setWindowTitle("Event Details");
+    QList<const User*> availableUsers;
     dialog.setModal(true);
 
     QVBoxLayout* layout = new QVBoxLayout(&dialog);
@@ -505,21 +620,18 @@ void MainWindow:: showEventDetailsDialog(Event* event, bool isCreatedEvent) {
         QListWidget* availableUsersList = new QListWidget();
 
         // find available users
+        LatencyScope latency(Metrics::SlotSearchLatency);
         QList<Calendar*> allCalendars = CalendarManager::getInstance()->getAllCalendars();
         for (Calendar* calendar : allCalendars) {
             User* user = calendar->getOwner();
-            bool isAvailable = true;
 
-            // Check if user has any conflicting events
-            for (Event* existingEvent : calendar->getEvents()) {
-                if (existingEvent->getDate().toString("yyyy-MM-dd hh:mm") == event->getDate().toString("yyyy-MM-dd hh:mm")) {
-                    isAvailable = false;
-                    break;
-                }
-            }
+            // Check if user has any event overlapping this one
+            bool isAvailable = calendar->getConflicts(event->getStartUtc(), event->getEndUtc(),
+                                                      event->getEventID()).isEmpty();
 
             // If user is available, add to list
             if (isAvailable) {
+                availableUsers.append(user);
                 QString displayName = QString("%1 %2").arg(user->getFirstName(), user->getLastName());
                 QListWidgetItem* userItem = new QListWidgetItem(displayName, availableUsersList);
 
@@ -543,10 +655,12 @@ void MainWindow:: showEventDetailsDialog(Event* event, bool isCreatedEvent) {
 
         QPushButton* editButton = new QPushButton("Edit");
         QPushButton* deleteButton = new QPushButton("Delete");
+        QPushButton* exportButton = new QPushButton("Export...");
         QPushButton* closeButton = new QPushButton("Close");
 
         buttonLayout->addWidget(editButton);
         buttonLayout->addWidget(deleteButton);
+        buttonLayout->addWidget(exportButton);
         buttonLayout->addWidget(closeButton);
 
         layout->addLayout(buttonLayout);
@@ -562,6 +676,15 @@ void MainWindow:: showEventDetailsDialog(Event* event, bool isCreatedEvent) {
             deleteEvent(event);
         });
 
+        // the event with everyone available as attendees
+        connect(exportButton, &QPushButton::clicked, [&]() {
+            exportToFile(event->getTitle(), [&](IcsWriter& writer) {
+                writer.beginCalendar(event->getTitle());
+                writer.writeEvent(event, availableUsers);
+                writer.endCalendar();
+            });
+        });
+
         connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
     } else {
         // close button
@@ -585,6 +708,71 @@ void MainWindow::updateUserEventsList() {
     if (calendarWidget->selectedDate().isValid()) {
         onDateSelected(calendarWidget->selectedDate());
     }
+    refreshTimelines();
+    updateHeatmap();
+}
+
+/**
+ * @brief Redraws the week and day views from the current calendars.
+ *
+ * Created events are gray, every shown user's events are in the user's colour.
+ * Users hidden from the month view are hidden here too.
+ */
+void MainWindow::refreshTimelines() {
+    QList<TimelineView::Source> sources;
+    sources.append({userCalendar, QColor(Qt::lightGray), true});
+    for (auto it = userCalendars.cbegin(); it != userCalendars.cend(); ++it) {
+        if (highlighter->isUserVisible(it.key())) {
+            sources.append({it.value(), UserManager::getInstance()->getUserColor(it.key()), false});
+        }
+    }
+
+    QDate date = calendarWidget->selectedDate();
+    weekView->refresh(date, sources);
+    dayView->refresh(date, sources);
+}
+
+/**
+ * @brief Brings the busy heatmap of the visible page up to date.
+ *
+ * Reuses the last result while no calendar changed, the page is the same and
+ * the users are the same. Otherwise the heatmap is computed from snapshots on a
+ * worker thread; a request made while one is running is served after it.
+ */
+void MainWindow::updateHeatmap() {
+    if (!heatmapAction->isChecked()) return;
+
+    // the month grid shows at most a week before the 1st and six weeks from it
+    QDate firstDay = QDate(calendarWidget->yearShown(), calendarWidget->monthShown(), 1).addDays(-7);
+    quint64 version = Calendar::getGlobalVersion();
+    QList<qint64> userIDs = userCalendars.keys();
+    if (heatmap.firstDay == firstDay && heatmap.version == version && heatmap.userIDs == userIDs) {
+        calendarWidget->setHeatmap(heatmap);
+        return;
+    }
+    if (heatmapWatcher->isRunning()) {
+        heatmapPending = true;
+        return;
+    }
+
+    QList<std::shared_ptr<const Calendar::Snapshot>> snapshots;
+    for (const Calendar* calendar : userCalendars) {
+        snapshots.append(calendar->snapshot());
+    }
+    heatmapWatcher->setFuture(QtConcurrent::run(&BusyHeatmap::compute, snapshots, userIDs, firstDay, 50, version));
+}
+
+/**
+ * @brief Shows a heatmap computed on the worker thread.
+ */
+void MainWindow::onHeatmapFinished() {
+    heatmap = heatmapWatcher->result();
+    calendarWidget->setHeatmap(heatmap);
+
+    if (heatmapPending) {
+        heatmapPending = false;
+        updateHeatmap();
+    }
 }
 
 
@@ -595,7 +783,10 @@ void MainWindow::updateUserEventsList() {
  * Displays a dialog with the details of the selected user.
  */
 void MainWindow::onUserItemClicked(QListWidgetItem* item) {
-    int userID = item->data(Qt::UserRole).toInt();
+    // a click on the check box only toggles the user's layer
+    if (item->checkState() != pressedCheckState) return;
+
+    qint64 userID = item->data(Qt::UserRole).toLongLong();
     User* user = users[userID];
     Calendar* calendar = userCalendars[userID];
 
@@ -604,6 +795,19 @@ void MainWindow::onUserItemClicked(QListWidgetItem* item) {
     }
 }
 
+/**
+ * @brief Shows or hides a user's days on the calendar when their item is checked or unchecked.
+ * @param item The list item representing the user.
+ */
+void MainWindow::onUserItemChanged(QListWidgetItem* item) {
+    qint64 userID = item->data(Qt::UserRole).toLongLong();
+    bool visible = item->checkState() == Qt::Checked;
+    if (visible != highlighter->isUserVisible(userID)) {
+        highlighter->setUserVisible(userID, visible);
+        refreshTimelines();
+    }
+}
+
 /**
  * @brief Shows the user details dialog.
  * @param user The user to display.
@@ -622,7 +826,7 @@ void MainWindow::showUserDetailsDialog(User* user, Calendar* calendar) {
     QString info = QString("User: %1 %2\nTotal Events: %3")
                        .arg(user->getFirstName())
                        .arg(user->getLastName())
-                       .arg(calendar->getEvents().size());
+                       .arg(calendar->eventCount());
 
     QLabel* infoLabel = new QLabel(info);
     layout->addWidget(infoLabel);
@@ -630,9 +834,11 @@ void MainWindow::showUserDetailsDialog(User* user, Calendar* calendar) {
     QHBoxLayout* buttonLayout = new QHBoxLayout();
 
     QPushButton* deleteButton = new QPushButton("Delete User");
+    QPushButton* exportButton = new QPushButton("Export...");
     QPushButton* closeButton = new QPushButton("Close");
 
     buttonLayout->addWidget(deleteButton);
+    buttonLayout->addWidget(exportButton);
     buttonLayout->addWidget(closeButton);
 
     layout->addLayout(buttonLayout);
@@ -643,11 +849,53 @@ void MainWindow::showUserDetailsDialog(User* user, Calendar* calendar) {
         deleteUser(user);
     });
 
+    connect(exportButton, &QPushButton::clicked, [&]() {
+        exportCalendar(calendar, user->getFullName());
+    });
+
     connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
 
     dialog.exec();
 }
 
+/**
+ * @brief Exports a calendar to an ICS file the user picks.
+ * @param calendar The calendar.
+ * @param name The calendar name, also used for the suggested file name.
+ */
+void MainWindow::exportCalendar(const Calendar* calendar, const QString& name) {
+    exportToFile(name, [&](IcsWriter& writer) {
+        writer.writeCalendar(calendar, name);
+    });
+}
+
+/**
+ * @brief Asks for an ICS file and streams data into it.
+ * @param name The suggested file name, without extension.
+ * @param write Writes the calendar data.
+ *
+ * The file is only replaced once everything was written.
+ */
+void MainWindow::exportToFile(const QString& name, const std::function<void(IcsWriter&)>& write) {
+    QString path = QFileDialog::getSaveFileName(this, "Export ICS File", name + ".ics", "ICS Files (*.ics)");
+    if (path.isEmpty()) return;
+
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        QMessageBox::warning(this, "Error", "Cannot write " + path);
+        return;
+    }
+
+    IcsWriter writer(&file);
+    write(writer);
+    if (!writer.finish() || !file.commit()) {
+        QMessageBox::warning(this, "Error", "Cannot write " + path);
+        return;
+    }
+
+    QMessageBox::information(this, "Success", QString("Exported %1 events.").arg(writer.getEventsWritten()));
+}
+
 /**
  * @brief Displays a confirmation dialog to delete an event.
  * @param event The event to delete.
@@ -656,59 +904,15 @@ void MainWindow::showUserDetailsDialog(User* user, Calendar* calendar) {
  */
 void MainWindow::deleteEvent(Event* event) {
     QMessageBox::StandardButton reply = QMessageBox::question(this, "Confirm Deletion",
-                                                              "Are you sure you want to delete this event?\nThis action cannot be undone.",
+                                                              "Are you sure you want to delete this event?\nYou can undo this with Edit > Undo.",
                                                               QMessageBox::Yes | QMessageBox::No);
 
     if (reply == QMessageBox::Yes) {
         deleteStrategy->execute(userCalendar, event);
-        updateCalendarDisplay();
-    }
-}
-
-/**
- * @brief Updates the calendar display.
- * 
- * Updates the calendar display to reflect changes in the user's calendar.
- */
-void MainWindow::updateDateFormat(const QDate& date) {
-    // clear the format
-    QTextCharFormat defaultFormat;
-    calendarWidget->setDateTextFormat(date, defaultFormat);
-
-    // check all calendars for events on this date
-    bool hasEvents = false;
-
-    // check user calendar
-    for (const Event* event : userCalendar->getEvents()) {
-        if (event->getDate().date() == date) {
-            QTextCharFormat format;
-            // set background to user for event that belongs to user
-            format.setBackground(Qt::lightGray);
-            calendarWidget->setDateTextFormat(date, format);
-            hasEvents = true;
-            break;
-        }
-    }
-
-    // no events found in user calendar, check other calendars
-    if (!hasEvents) {
-        QList<Calendar*> calendars = CalendarManager::getInstance()->getAllCalendars();
-        for (Calendar* calendar : calendars) {
-            for (const Event* event : calendar->getEvents()) {
-                if (event->getDate().date() == date) {
-                    QTextCharFormat format;
-                    format.setBackground(QColor(200, 230, 255));
-                    calendarWidget->setDateTextFormat(date, format);
-                    hasEvents = true;
-                    break;
-                }
-            }
-            if (hasEvents) break;
-        }
+        QMessageBox::information(this, "Success", "Event deleted successfully.");
     }
 }
 
-
 /**
  * @brief Edits an event.
  * @param event The event to edit.
@@ -732,12 +936,146 @@ void MainWindow::editEvent(Event* event) {
         Event* updatedEvent = builder.build();
 
         if (updatedEvent) {
+            // the dialog only edits the start, keep the duration
+            updatedEvent->setEndUtc(updatedEvent->getStartUtc() + event->getEndUtc() - event->getStartUtc());
+            if (!confirmConflicts(EventActions::findConflicts(userCalendar, updatedEvent))) {
+                delete updatedEvent;
+                return;
+            }
             // update the event in the calendar
             editStrategy->execute(userCalendar, updatedEvent);
-            // update interface
-            updateCalendarDisplay();
+            QMessageBox::information(this, "Success", "Event updated successfully.");
+        }
+    }
+}
+
+/**
+ * @brief Saves the changes made by event actions.
+ * @param result What an action or a batch of actions changed.
+ *
+ * Called once per batch. The views are refreshed from the change bus instead.
+ */
+void MainWindow::onEventsChanged(const EventActionResult& result) {
+    Calendar* calendar = result.calendar;
+    if (!calendar || !result.applied) return;
+
+    qint64 calendarID = calendar == userCalendar ? EventJournal::createdCalendarID : calendar->getOwner()->getPersonID();
+    if (!result.added.isEmpty()) {
+        journal->eventsAdded(calendarID, calendar, result.added);
+    }
+    for (const EventActionResult::UpdatedEvent& update : result.updated) {
+        journal->eventUpdated(calendarID, calendar, update.event);
+    }
+    for (const EventActionResult::RemovedEvent& removed : result.removed) {
+        journal->eventRemoved(calendarID, removed.eventID);
+    }
+    updateUndoActions();
+}
+
+/**
+ * @brief Queues deltas from the change bus until the next event loop pass.
+ * @param deltas The deltas of one calendar mutation.
+ *
+ * May be called from any thread. Only the first batch of a pass schedules a flush.
+ */
+void MainWindow::queueChanges(const QList<ChangeBus::Delta>& deltas) {
+    QMutexLocker locker(&pendingMutex);
+    pendingChanges.append(deltas);
+    if (!flushScheduled) {
+        flushScheduled = true;
+        QMetaObject::invokeMethod(this, &MainWindow::flushChanges, Qt::QueuedConnection);
+    }
+}
+
+/**
+ * @brief Applies every queued delta to the views at once.
+ *
+ * Deltas are folded first: created counts are summed per day, each changed user
+ * layer is taken once from its calendar, and the lists, timelines and heatmap are
+ * refreshed once, the lists only if the selected date changed.
+ */
+void MainWindow::flushChanges() {
+    TRACE_SCOPE("MainWindow::flushChanges");
+    QList<ChangeBus::Delta> deltas;
+    {
+        QMutexLocker locker(&pendingMutex);
+        deltas.swap(pendingChanges);
+        flushScheduled = false;
+    }
+    if (deltas.isEmpty()) return;
+
+    QHash<QDate, int> createdCounts;
+    QSet<qint64> changedUsers;
+    QDate selected = calendarWidget->selectedDate();
+    bool selectedChanged = false;
+    bool outsideHorizon = false;
+    for (const ChangeBus::Delta& delta : deltas) {
+        selectedChanged = selectedChanged || delta.day == selected || delta.previousDay == selected;
+        outsideHorizon = outsideHorizon || (delta.kind != ChangeBus::Delta::Removed && !isInHorizon(delta.day));
+
+        if (delta.calendar == userCalendar) {
+            switch (delta.kind) {
+            case ChangeBus::Delta::Added:
+                createdCounts[delta.day]++;
+                break;
+            case ChangeBus::Delta::Removed:
+                createdCounts[delta.day]--;
+                break;
+            case ChangeBus::Delta::Moved:
+                createdCounts[delta.previousDay]--;
+                createdCounts[delta.day]++;
+                break;
+            }
+        }
+        // skip calendars removed since, their user is gone from the views
+        else if (userCalendars.value(delta.userID, nullptr) == delta.calendar) {
+            changedUsers.insert(delta.userID);
         }
     }
+
+    highlighter->changeCreated(createdCounts);
+    for (qint64 userID : changedUsers) {
+        highlighter->setLayer(userID, userCalendars.value(userID));
+    }
+
+    if (selectedChanged) {
+        updateUserEventsList();
+    } else {
+        refreshTimelines();
+        updateHeatmap();
+    }
+
+    // imports and undo may add events to spilled months, page them out again
+    if (outsideHorizon) {
+        applyHorizon();
+    }
+}
+
+/**
+ * @brief Asks whether to save an event that clashes with others.
+ * @param conflicts The clashes, per participant.
+ * @return true if there are none or the user chose to save anyway.
+ */
+bool MainWindow::confirmConflicts(const QList<EventConflict>& conflicts) {
+    if (conflicts.isEmpty()) return true;
+
+    // list a few clashes per participant, the dialog should stay readable
+    QString text = "This event overlaps with:\n";
+    for (const EventConflict& conflict : conflicts) {
+        QString name = conflict.participant ? conflict.participant->getFullName().trimmed() : QString();
+        text += QString("\n%1:\n").arg(name.isEmpty() || conflict.participant == currentUser ? QString("You") : name);
+        for (qsizetype i = 0; i < conflict.events.size() && i < 3; i++) {
+            const Event* other = conflict.events[i];
+            text += QString("  %1, %2\n").arg(other->getTitle(), other->getDate().toString("MMM d, yyyy h:mm AP"));
+        }
+        if (conflict.events.size() > 3) {
+            text += QString("  and %1 more\n").arg(conflict.events.size() - 3);
+        }
+    }
+    text += "\nSave it anyway?";
+
+    return QMessageBox::question(this, "Conflicting Events", text, QMessageBox::Yes | QMessageBox::No)
+           == QMessageBox::Yes;
 }
 
 /**
@@ -747,107 +1085,97 @@ void MainWindow::editEvent(Event* event) {
  * Displays a confirmation dialog to delete the selected user and their calendar.
  */
 void MainWindow::deleteUser(User* user) {
+    TRACE_SCOPE("MainWindow::deleteUser");
     QMessageBox::StandardButton reply = QMessageBox::question(this, "Confirm Deletion",
-                                                              "Are you sure you want to delete this user and their calendar?\nThis action cannot be undone.",
+                                                              "Are you sure you want to delete this user and their calendar?\nYou can undo this with Edit > Undo.",
                                                               QMessageBox::Yes | QMessageBox::No);
 
     if (reply == QMessageBox::Yes) {
-        int userID = user->getPersonID();
-
-        // store user info
-        QString firstName = user->getFirstName();
-        QString lastName = user->getLastName();
-
+        std::unique_ptr<DeleteUserCommand> command = std::make_unique<DeleteUserCommand>(this, user);
+        command->redo();
+        history->record(std::move(command));
+        updateUndoActions();
 
-        // clear events from the calendar first
-        Calendar* calendar = userCalendars.value(userID);
-
-        if (calendar) {
-            for (const Event* event : calendar->getEvents()) {
-                // reset format if NO OTHER calendars have events on this date
-                QDate eventDate = event->getDate().date();
-
-                //check for any created events on date
-                bool hasCreatedEvent = false;
-                for (const Event* createdEvent : userCalendar->getEvents()) {
-                    if (createdEvent->getDate().date() == eventDate) {
-                        hasCreatedEvent = true;
-                        break;
-                    }
-                }
-
-                // check if other calendars have events on this date
-                bool hasOtherUserEvents = false;
-                QList<Calendar*> allCalendars = CalendarManager::getInstance()->getAllCalendars();
-                for (Calendar* otherCalendar : allCalendars) {
-                    if (otherCalendar->getOwner()->getPersonID() != userID) {
-                        for (const Event* otherEvent : otherCalendar->getEvents()) {
-                            if (otherEvent->getDate().date() == eventDate) {
-                                hasOtherUserEvents = true;
-                                break;
-                            }
-                        }
-                    }
-                    if (hasOtherUserEvents) break;
-                }
+        QMessageBox::information(this, "Success", "User and calendar deleted successfully.");
+    }
+}
 
-                // reset format if no created events or user events
-                if (!hasCreatedEvent && !hasOtherUserEvents) {
-                    QTextCharFormat defaultFormat;
-                    calendarWidget->setDateTextFormat(eventDate, defaultFormat);
-                }
-                // if there are created events on the date, keep the gray color
-                else if (hasCreatedEvent) {
-                    QTextCharFormat createdEventFormat;
-                    createdEventFormat.setBackground(Qt::lightGray);
-                    calendarWidget->setDateTextFormat(eventDate, createdEventFormat);
-                }
-                // if other user events exist, mark with light blue
-                else if (hasOtherUserEvents) {
-                    QTextCharFormat userEventFormat;
-                    userEventFormat.setBackground(QColor(200, 230, 255));
-                    calendarWidget->setDateTextFormat(eventDate, userEventFormat);
-                }
-            }
-        }
+/**
+ * @brief Removes a user, their calendar and their events from the workspace for good.
+ * @param user The user to remove.
+ */
+void MainWindow::removeUser(User* user) {
+    qint64 userID = user->getPersonID();
+    removeUserFromViews(userID);
+
+    // handle memory cleanup
+    CalendarManager::getInstance()->deleteCalendar(userID);
+    UserManager::getInstance()->deleteUser(userID);
+    refreshTimelines();
+    updateHeatmap();
+}
 
-        // remove user from UI
-        QList<QListWidgetItem*> items = userList->findItems(
-            QString("%1 %2").arg(firstName, lastName),
-            Qt::MatchExactly
-            );
-        for (QListWidgetItem* item : items) {
-            delete item;
+/**
+ * @brief Takes a user off the user list, the event lists and the calendar layers.
+ * @param userID The ID of the user.
+ */
+void MainWindow::removeUserFromViews(qint64 userID) {
+    // clear the user's days from the calendar first, recoloring only days whose state changes
+    highlighter->removeUser(userID);
+
+    // remove user from UI, by ID since names need not be unique
+    for (int row = userList->count() - 1; row >= 0; row--) {
+        if (userList->item(row)->data(Qt::UserRole).toLongLong() == userID) {
+            delete userList->takeItem(row);
         }
+    }
 
-        // remove user events that belong to user
-        for (int i = eventList->count() - 1; i >= 0; --i) {
-            QListWidgetItem* item = eventList->item(i);
-            Event* event = item->data(Qt::UserRole).value<Event*>();
-            if (event && event->getOrganizer()->getPersonID() == userID) {
-                delete eventList->takeItem(i);
-            }
-        }
-        // remove events created BY the user
-        for (int i = createdEventList->count() - 1; i >= 0; --i) {
-            QListWidgetItem* item = createdEventList->item(i);
-            Event* event = item->data(Qt::UserRole).value<Event*>();
-            if (event && event->getOrganizer()->getPersonID() == userID) {
-                delete createdEventList->takeItem(i);
-            }
-        }
+    // remove user events that belong to user
+    userEventsModel->removeOrganizer(userID);
+    // remove events created BY the user
+    createdEventsModel->removeOrganizer(userID);
 
 
-        // removing mapping of userID from Calendar and User
-        userCalendars.remove(userID);
-        users.remove(userID);
+    // removing mapping of userID from Calendar and User
+    userCalendars.remove(userID);
+    users.remove(userID);
+}
 
-        // handle memory cleanup
-        CalendarManager::getInstance()->deleteCalendar(userID);
-        UserManager::getInstance()->deleteUser(userID);
+/**
+ * @brief Enables the Undo and Redo items and names what they would do.
+ */
+void MainWindow::updateUndoActions() {
+    undoAction->setEnabled(history->canUndo());
+    undoAction->setText(history->canUndo() ? "Undo " + history->undoText() : QString("Undo"));
+    redoAction->setEnabled(history->canRedo());
+    redoAction->setText(history->canRedo() ? "Redo " + history->redoText() : QString("Redo"));
+}
 
-        QMessageBox::information(this, "Success", "User and calendar deleted successfully.");
+/**
+ * @brief Shows a new user on the user list.
+ * @param user The user.
+ * @param calendar The user's calendar.
+ */
+void MainWindow::addUserToList(User* user, Calendar* calendar) {
+    users[user->getPersonID()] = user;
+    userCalendars[user->getPersonID()] = calendar;
+
+    // display user on user list, checked while their days are shown on the calendar
+    QString displayName = QString("%1 %2").arg(user->getFirstName(), user->getLastName());
+    QListWidgetItem* item = new QListWidgetItem(displayName);
+    item->setData(Qt::UserRole, user->getPersonID());
+    item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+    item->setCheckState(highlighter->isUserVisible(user->getPersonID()) ? Qt::Checked : Qt::Unchecked);
+
+    // assign unique colour
+    QColor userColor = UserManager::getInstance()->getUserColor(user->getPersonID());
+    item->setBackground(userColor);
+
+    // text color change depending on background
+    if (userColor.lightness() < 128) {
+        item->setForeground(Qt::white);
     }
+    userList->addItem(item);
 }
 
 /**
@@ -856,49 +1184,300 @@ void MainWindow::deleteUser(User* user) {
  * Updates the calendar display to reflect changes in the user's calendar.
  */
 void MainWindow::updateCalendarDisplay() {
-    // clear all date formats
-    QTextCharFormat defaultFormat;
+    TRACE_SCOPE("MainWindow::updateCalendarDisplay");
+    // recount every day from the date indexes, pushing only visible days that changed
+    highlighter->rebuild(userCalendar, CalendarManager::getInstance()->getAllCalendars());
 
-    // get the current month's first and last dates
-    QDate currentDate = calendarWidget->selectedDate();
-    QDate firstDate(currentDate.year(), currentDate.month(), 1);
-    QDate lastDate(currentDate.year(), currentDate.month(), currentDate.daysInMonth());
+    // update event lists for date selected
+    updateUserEventsList();
+}
 
-    // clear formats for all dates in the current month
-    for (QDate date = firstDate; date <= lastDate; date = date.addDays(1)) {
-        calendarWidget->setDateTextFormat(date, defaultFormat);
+/**
+ * @brief Keeps the months around today and the months looked at in memory.
+ *
+ * Resident are the configured window around today, the page shown with the
+ * days of its neighbours, the week of the selected date, the first
+ * searchMonthsMax months of an open search's range and the months with
+ * undoable changes. Every other month of every calendar is spilled to disk;
+ * views follow through the change bus.
+ */
+void MainWindow::applyHorizon() {
+    if (!horizonEnabled) return;
+    TRACE_SCOPE("MainWindow::applyHorizon");
+
+    QDate today = QDate::currentDate();
+    QDate shown(calendarWidget->yearShown(), calendarWidget->monthShown(), 1);
+    QDate selected = calendarWidget->selectedDate();
+    horizon = {{today.addMonths(-horizonMonthsBefore), today.addMonths(horizonMonthsAfter)},
+               {shown.addDays(-7), shown.addMonths(1).addDays(14)},
+               {selected.addDays(-7), selected.addDays(7)}};
+    if (searchRange.first.isValid()) {
+        // a wide search range would page in the whole history, keep its first months only
+        QDate last = qMin(searchRange.second, searchRange.first.addMonths(searchMonthsMax).addDays(-1));
+        horizon.append({searchRange.first, last});
+    }
+    // undo and redo find events in memory, months stop being kept with the last command touching them
+    for (const QDate& month : history->months()) {
+        horizon.append({month, month});
     }
 
-    //create colours for user event
-    QTextCharFormat userEventBackground;
-    userEventBackground.setBackground(QColor(200,230,255));
-    //create colours for created events
-    QTextCharFormat createdEventBackground;
-    createdEventBackground.setBackground(QColor(Qt::lightGray));
+    userCalendar->setHorizon(horizon);
+    for (Calendar* calendar : CalendarManager::getInstance()->getAllCalendars()) {
+        calendar->setHorizon(horizon);
+    }
+}
 
-    // mark dates with created events first, so gray will always be on top even if a new user is added
-    for (const Event* event : userCalendar->getEvents()) {
-        calendarWidget->setDateTextFormat(event->getDate().date(), createdEventBackground);
+/**
+ * @brief Checks whether the events of a day are in memory.
+ * @param day The day.
+ * @return true if its month is inside the horizon last applied.
+ */
+bool MainWindow::isInHorizon(const QDate& day) const {
+    return !horizonEnabled || Calendar::isResident(day, horizon);
+}
+
+/**
+ * @brief Shows the dialog searching every calendar by text and dates.
+ *
+ * Clicking a result opens the event like the event lists do.
+ */
+void MainWindow::showSearchDialog() {
+    QList<SearchDialog::Source> sources;
+    sources.append({userCalendar, true});
+    for (const Calendar* calendar : userCalendars) {
+        sources.append({calendar, false});
     }
 
-    // mark all user events with blue to keep it consistent
+    SearchDialog dialog(sources, this);
+    connect(&dialog, &SearchDialog::eventClicked, this, &MainWindow::showEventDetailsDialog);
+
+    // the searched range stays resident while the dialog is open, up to searchMonthsMax months
+    searchRange = dialog.getRange();
+    applyHorizon();
+    connect(&dialog, &SearchDialog::rangeChanged, [this](const QDate& from, const QDate& to) {
+        searchRange = {from, to};
+        applyHorizon();
+    });
+    dialog.exec();
+
+    searchRange = {};
+    applyHorizon();
+}
+
+/**
+ * @brief Gets every calendar whose index sizes the metrics report.
+ * @return The created events calendar followed by the imported calendars.
+ */
+QList<Calendar*> MainWindow::metricsCalendars() const {
     QList<Calendar*> calendars = CalendarManager::getInstance()->getAllCalendars();
-    for (const Calendar* calendar : calendars) {
-        if (calendar) {
-            for (const Event* event : calendar->getEvents()) {
-                QDate eventDate = event->getDate().date();
-                // set to light blue if not already marked by a created event
-                if (calendarWidget->dateTextFormat(eventDate) == defaultFormat) {
-                    calendarWidget->setDateTextFormat(eventDate, userEventBackground);
+    calendars.prepend(userCalendar);
+    return calendars;
+}
+
+/**
+ * @brief Shows a report that can be refreshed and saved as JSON.
+ * @param title The dialog title.
+ * @param text Builds the report as text.
+ * @param json Builds the report as JSON.
+ */
+void MainWindow::showReportDialog(const QString& title, const std::function<QString()>& text,
+                                  const std::function<QJsonDocument()>& json) {
+    QDialog dialog(this);
+    dialog.setWindowTitle(title);
+    dialog.resize(720, 480);
+
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+
+    QPlainTextEdit* report = new QPlainTextEdit();
+    report->setReadOnly(true);
+    report->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+    report->setPlainText(text());
+    layout->addWidget(report);
+
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    QPushButton* refreshButton = new QPushButton("Refresh");
+    QPushButton* saveButton = new QPushButton("Save JSON...");
+    QPushButton* closeButton = new QPushButton("Close");
+    buttonLayout->addWidget(refreshButton);
+    buttonLayout->addWidget(saveButton);
+    buttonLayout->addWidget(closeButton);
+    layout->addLayout(buttonLayout);
+
+    connect(refreshButton, &QPushButton::clicked, [&]() {
+        report->setPlainText(text());
+    });
+
+    connect(saveButton, &QPushButton::clicked, [&]() {
+        QString path = QFileDialog::getSaveFileName(&dialog, "Save " + title, title.toLower() + ".json", "JSON Files (*.json)");
+        if (path.isEmpty()) return;
+
+        QFile file(path);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            QMessageBox::warning(&dialog, "Error", "Cannot write " + path);
+            return;
+        }
+        file.write(json().toJson());
+    });
+
+    connect(closeButton, &QPushButton::clicked, &dialog, &QDialog::accept);
+
+    dialog.exec();
+}
+
+/**
+ * @brief Shows the runtime metrics.
+ *
+ * Displays the counters, index sizes and latency histograms.
+ */
+void MainWindow::showMetricsDialog() {
+    showReportDialog("Metrics",
+                     [this]() { return Metrics::toText(metricsCalendars()); },
+                     [this]() { return Metrics::toJson(metricsCalendars()); });
+}
+
+/**
+ * @brief Measures the memory of the loaded workspace.
+ * @return The report, per calendar, per user and per cache.
+ */
+MemoryReport MainWindow::memoryReport() const {
+    MemoryReport report;
+    report.addCalendar(userCalendar, "Created events");
+    report.addUser(currentUser);
+    report.addWorkspace();
+
+    // after the calendars, so lists shared with their date indexes are not counted twice
+    userEventsModel->reportMemory(report, "User events list");
+    createdEventsModel->reportMemory(report, "Created events list");
+    highlighter->reportMemory(report);
+    report.addCache("Metrics", Metrics::memoryUsage());
+    report.addCache("Tracer", Tracer::memoryUsage());
+    return report;
+}
+
+/**
+ * @brief Shows the memory report of the loaded workspace.
+ */
+void MainWindow::showMemoryDialog() {
+    showReportDialog("Memory",
+                     [this]() { return memoryReport().toText(); },
+                     [this]() { return memoryReport().toJson(); });
+}
+
+/**
+ * @brief Applies one saved change while the journal is replayed.
+ * @param record The change.
+ */
+void MainWindow::applyJournalRecord(const EventJournal::Record& record) {
+    switch (record.type) {
+    case EventJournal::UserCreated: {
+        User* user = UserManager::getInstance()->restoreUser(record.userID, record.firstName, record.lastName, record.color);
+        addUserToList(user, CalendarManager::getInstance()->createUserCalendar(user));
+        break;
+    }
+    case EventJournal::UserDeleted:
+        if (User* user = users.value(record.userID, nullptr)) {
+            removeUser(user);
+        }
+        break;
+    case EventJournal::EventsAdded:
+    case EventJournal::EventUpdated: {
+        Calendar* calendar = journalCalendar(record.calendarID);
+        if (!calendar) break;
+
+        // the text goes back into an arena, as it was before the restart
+        EventTextArena packer;
+        QList<qint64> headers;
+        for (const EventJournal::EventData& data : record.events) {
+            QByteArray texts[Event::TextFieldCount] = {data.title.toUtf8(), data.description.toUtf8(),
+                                                       data.location.toUtf8()};
+            quint32 header = 0;
+            headers.append(packer.add(texts, header) ? qint64(header) : -1);
+        }
+        std::shared_ptr<const QByteArray> arena = packer.finish();
+
+        QList<Event*> events;
+        for (qsizetype i = 0; i < record.events.size(); i++) {
+            const EventJournal::EventData& data = record.events[i];
+            Event* event = headers[i] >= 0
+                ? new Event(data.eventID, arena, quint32(headers[i]), data.startUtc, calendar->getOwner())
+                : new Event(data.eventID, data.title, data.description, data.startUtc, data.location,
+                            calendar->getOwner());
+            event->setEndUtc(data.endUtc);
+            events.append(event);
+            IdAllocator::reserve(IdAllocator::Events, data.eventID);
+        }
+
+        if (record.type == EventJournal::EventsAdded) {
+            calendar->addEvents(events);
+        }
+        else {
+            // an update of an event the calendar no longer holds has nothing to replace
+            for (Event* event : events) {
+                if (!calendar->updateEvent(event)) {
+                    delete event;
                 }
             }
         }
+        break;
     }
+    case EventJournal::EventRemoved: {
+        Calendar* calendar = journalCalendar(record.calendarID);
+        if (!calendar) break;
 
-    // update event lists for date selected
-    if (calendarWidget->selectedDate().isValid()) {
-        onDateSelected(calendarWidget->selectedDate());
+        if (Event* event = calendar->snapshot()->ids.find(record.eventID)) {
+            calendar->removeEvent(event);
+        }
+        break;
+    }
+    }
+}
+
+/**
+ * @brief Gets the calendar a journal record refers to.
+ * @param calendarID The user ID owning the calendar, or EventJournal::createdCalendarID.
+ * @return The calendar, or nullptr if it no longer exists.
+ */
+Calendar* MainWindow::journalCalendar(qint64 calendarID) const {
+    if (calendarID == EventJournal::createdCalendarID) {
+        return userCalendar;
+    }
+    return userCalendars.value(calendarID, nullptr);
+}
+
+/**
+ * @brief Captures the whole workspace for a journal compaction.
+ * @return Snapshots of the users and of every calendar.
+ */
+EventJournal::State MainWindow::journalState() const {
+    EventJournal::State state;
+    state.users = UserManager::getInstance()->snapshot();
+    state.calendars.append({EventJournal::createdCalendarID, userCalendar->snapshot()});
+
+    std::shared_ptr<const CalendarManager::Snapshot> calendars = CalendarManager::getInstance()->snapshot();
+    for (auto it = calendars->userCalendars.cbegin(); it != calendars->userCalendars.cend(); ++it) {
+        state.calendars.append({it.key(), it.value()->snapshot()});
     }
+    return state;
+}
+
+/**
+ * @brief Compacts the journal on its writer thread if it has grown enough.
+ */
+void MainWindow::compactJournal() {
+    if (journal->needsCompaction()) {
+        journal->compact(journalState());
+    }
+}
+
+/**
+ * @brief Re-highlights the days of the newly shown month.
+ * @param year The year shown.
+ * @param month The month shown.
+ */
+void MainWindow::onCalendarPageChanged(int year, int month) {
+    applyHorizon();
+    highlighter->setVisiblePage(year, month);
+    updateHeatmap();
 }
 
 /**
@@ -906,6 +1485,13 @@ void MainWindow::updateCalendarDisplay() {
  */
 MainWindow::~MainWindow()
 {
+    ChangeBus::getInstance()->unsubscribe(changeSubscription);
+
+    // write everything still queued before the calendars go away
+    compactJournal();
+    journal.reset();
+    heatmapWatcher->waitForFinished();
+
     delete ui;
 }
 
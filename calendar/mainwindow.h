@@ -8,8 +8,10 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QAction>
 #include <QCalendarWidget>
 #include <QListWidget>
+#include <QListView>
 #include <QPushButton>
 #include <QVBoxLayout>
 #include <QHBoxLayout>
@@ -19,9 +21,24 @@
 #include "calendar.h"
 #include "user.h"
 #include "eventactions.h"
+#include "changebus.h"
+#include "undohistory.h"
+#include "eventlistmodel.h"
+#include "calendarhighlighter.h"
+#include "layeredcalendarwidget.h"
+#include "timelineview.h"
+#include "busyheatmap.h"
+#include "memoryreport.h"
+#include "eventjournal.h"
+#include "icswriter.h"
 #include <QColor>
 #include <QMap>
 #include <QRegularExpression>
+#include <QJsonDocument>
+#include <QFutureWatcher>
+#include <QMutex>
+#include <QPair>
+#include <functional>
 
 QT_BEGIN_NAMESPACE
 namespace Ui {
@@ -41,19 +58,60 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 private:
-    QCalendarWidget* calendarWidget;
-    QListWidget* eventList;
-    QListWidget* createdEventList;
+    LayeredCalendarWidget* calendarWidget;
+    TimelineView* weekView;
+    TimelineView* dayView;
+    QListView* eventList;
+    QListView* createdEventList;
+    EventListModel* userEventsModel;
+    EventListModel* createdEventsModel;
     QListWidget* userList;
     QPushButton* createEventButton;
     QPushButton* createUserButton;
+    QAction* exportAction;
+    QAction* undoAction;
+    QAction* redoAction;
+    QAction* findAction;
+    QAction* heatmapAction;
+    QAction* metricsAction;
+    QAction* memoryAction;
     Calendar* userCalendar;
     User * currentUser;
-    QMap<int, User*> users;
-    QMap<int, Calendar*> userCalendars;
+    QMap<qint64, User*> users;
+    QMap<qint64, Calendar*> userCalendars;
 
     //create user colours
-    QMap<int, QColor> userColors;
+    QMap<qint64, QColor> userColors;
+
+    // incremental day highlighting of calendarWidget
+    std::unique_ptr<CalendarHighlighter> highlighter;
+    // busy heatmap of the visible page, computed off the GUI thread
+    QFutureWatcher<BusyHeatmap::Result>* heatmapWatcher;
+    BusyHeatmap::Result heatmap;
+    bool heatmapPending = false;
+    // check state of the user item under the mouse, to tell check box clicks apart
+    Qt::CheckState pressedCheckState = Qt::Checked;
+
+    // calendar deltas waiting for the next event loop pass
+    int changeSubscription = 0;
+    QMutex pendingMutex;
+    QList<ChangeBus::Delta> pendingChanges;
+    bool flushScheduled = false;
+
+    // saves every change and restores them at startup
+    std::unique_ptr<EventJournal> journal;
+
+    // months kept in memory, the others are spilled to disk; every month without a horizon
+    bool horizonEnabled = true;
+    int horizonMonthsBefore = 3;
+    int horizonMonthsAfter = 12;
+    QList<QPair<QDate, QDate>> horizon;  // the ranges last applied
+    QPair<QDate, QDate> searchRange;     // while the search dialog is open
+    int searchMonthsMax = 24;            // months of searchRange made resident at most
+
+    // undo and redo of event actions and user deletions
+    class DeleteUserCommand;
+    std::unique_ptr<UndoHistory> history;
 
     // strategy objects
     std::unique_ptr<EventActions> createStrategy;
@@ -61,9 +119,6 @@ private:
     std::unique_ptr<EventActions> editStrategy;
 
 
-    Event* parseICSEvent(const QStringList& eventLines, User* user, int& nextEventID);
-    QDateTime parseICSDateTime(const QString& dateTimeStr);
-
     void setupUI();
     void createConnections();
 
@@ -74,9 +129,35 @@ private:
     void showUserDetailsDialog(User* user, Calendar* calendar);
     void deleteEvent(Event* event);
     void editEvent(Event* event);
+    bool confirmConflicts(const QList<EventConflict>& conflicts);
+    void onEventsChanged(const EventActionResult& result);
+    void queueChanges(const QList<ChangeBus::Delta>& deltas);
+    void flushChanges();
     void deleteUser(User* user);
+    void removeUser(User* user);
+    void removeUserFromViews(qint64 userID);
+    void updateUndoActions();
+    void addUserToList(User* user, Calendar* calendar);
     void updateCalendarDisplay();
-    void updateDateFormat(const QDate& date);
+    void applyHorizon();
+    bool isInHorizon(const QDate& day) const;
+    void refreshTimelines();
+    void updateHeatmap();
+    void onHeatmapFinished();
+    void exportCalendar(const Calendar* calendar, const QString& name);
+    void exportToFile(const QString& name, const std::function<void(IcsWriter&)>& write);
+    void showReportDialog(const QString& title, const std::function<QString()>& text,
+                          const std::function<QJsonDocument()>& json);
+    void showMetricsDialog();
+    void showMemoryDialog();
+    void showSearchDialog();
+    QList<Calendar*> metricsCalendars() const;
+    MemoryReport memoryReport() const;
+
+    void applyJournalRecord(const EventJournal::Record& record);
+    Calendar* journalCalendar(qint64 calendarID) const;
+    EventJournal::State journalState() const;
+    void compactJournal();
 
 
 
@@ -86,10 +167,12 @@ public:
 
 private slots:
     void onDateSelected(const QDate& date);
+    void onCalendarPageChanged(int year, int month);
     void onCreateEventClicked();
     void onCreateUserClicked();
-    void onEventItemClicked(QListWidgetItem* item);
+    void onEventItemClicked(const QModelIndex& index);
     void onUserItemClicked(QListWidgetItem* item);
+    void onUserItemChanged(QListWidgetItem* item);
 
 private:
     Ui::MainWindow *ui;
@@ -0,0 +1,370 @@
+/**
+ * @file memoryreport.cpp
+ * @brief Implementation of the MemoryReport class
+ */
+#include "memoryreport.h"
+#include "calendar.h"
+#include "calendarmanager.h"
+#include "usermanager.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QTextStream>
+
+namespace {
+
+const char* const componentNames[MemoryReport::ComponentCount] = {
+    "event_objects",
+    "event_strings",
+    "participants",
+    "event_lists",
+    "date_index",
+    "search_index",
+    "user_records"
+};
+
+const char* const componentTitles[MemoryReport::ComponentCount] = {
+    "Objects",
+    "Strings",
+    "Particip.",
+    "Lists",
+    "Index",
+    "Search",
+    "Users"
+};
+
+QJsonObject usageToJson(const MemoryReport::Usage& usage) {
+    QJsonObject object;
+    object["events"] = usage.events;
+    for (int i = 0; i < MemoryReport::ComponentCount; i++) {
+        object[componentNames[i]] = usage.bytes[i];
+    }
+    object["total"] = usage.total();
+    return object;
+}
+
+void writeTable(QTextStream& out, const QString& title, const QList<MemoryReport::Entry>& entries,
+                const QList<MemoryReport::Component>& columns) {
+    out << title << "\n";
+    out << QString("  %1 %2").arg(QString("Name"), -24).arg(QString("Events"), 9);
+    for (MemoryReport::Component column : columns) {
+        out << QString(" %1").arg(QString(componentTitles[column]), 10);
+    }
+    out << QString(" %1\n").arg(QString("Total"), 10);
+
+    for (const MemoryReport::Entry& entry : entries) {
+        out << QString("  %1 %2").arg(entry.name.left(24), -24).arg(entry.usage.events, 9);
+        for (MemoryReport::Component column : columns) {
+            out << QString(" %1").arg(MemoryReport::formatBytes(entry.usage.bytes[column]), 10);
+        }
+        qint64 total = 0;
+        for (MemoryReport::Component column : columns) {
+            total += entry.usage.bytes[column];
+        }
+        out << QString(" %1\n").arg(MemoryReport::formatBytes(total), 10);
+    }
+    out << "\n";
+}
+
+}
+
+/**
+ * @brief Sums every component.
+ * @return The bytes used.
+ */
+qint64 MemoryReport::Usage::total() const {
+    qint64 sum = 0;
+    for (qint64 component : bytes) {
+        sum += component;
+    }
+    return sum;
+}
+
+/**
+ * @brief Adds another usage to this one.
+ * @param other The usage to add.
+ */
+void MemoryReport::Usage::add(const Usage& other) {
+    for (int i = 0; i < ComponentCount; i++) {
+        bytes[i] += other.bytes[i];
+    }
+    events += other.events;
+}
+
+/**
+ * @brief Gets the row of a user, adding it if needed.
+ * @param user The user, or nullptr for events without an organizer.
+ * @return The row.
+ */
+MemoryReport::Entry& MemoryReport::userEntry(const User* user) {
+    auto row = userRows.constFind(user);
+    if (row != userRows.constEnd()) {
+        return users[*row];
+    }
+
+    userRows.insert(user, int(users.size()));
+    users.append(Entry{user ? user->getFullName() : QString("(no organizer)"), Usage()});
+    return users.last();
+}
+
+/**
+ * @brief Remembers a shared payload.
+ * @param data The payload.
+ * @return true the first time the payload is seen.
+ */
+bool MemoryReport::firstSighting(const void* data) {
+    if (seen.contains(data)) return false;
+    seen.insert(data);
+    return true;
+}
+
+/**
+ * @brief Adds every user and calendar of the managers.
+ */
+void MemoryReport::addWorkspace() {
+    std::shared_ptr<const UserManager::Snapshot> userState = UserManager::getInstance()->snapshot();
+    for (const User* user : userState->users) {
+        addUser(user);
+    }
+
+    std::shared_ptr<const CalendarManager::Snapshot> calendarState = CalendarManager::getInstance()->snapshot();
+    for (const Calendar* calendar : calendarState->userCalendars) {
+        const User* owner = calendar->getOwner();
+        addCalendar(calendar, owner ? owner->getFullName() : QString("(no owner)"));
+    }
+
+    // the registries themselves
+    addCache("UserManager", mapBytes(userState->users) + mapBytes(userState->userColors));
+    addCache("CalendarManager", mapBytes(calendarState->userCalendars));
+}
+
+/**
+ * @brief Adds the current snapshot of a calendar.
+ * @param calendar The calendar.
+ * @param name The name shown for it.
+ *
+ * Event objects, strings and participants are also charged to each event's organizer.
+ */
+void MemoryReport::addCalendar(const Calendar* calendar, const QString& name) {
+    if (!calendar) return;
+
+    std::shared_ptr<const Calendar::Snapshot> snapshot = calendar->snapshot();
+    Entry entry{name, Usage()};
+
+    for (const Event* event : snapshot->events) {
+        if (!firstSighting(event)) continue;
+
+        Usage usage;
+        usage.events = 1;
+        usage.bytes[EventObjects] = heapOverhead + qint64(sizeof(Event));
+        // decoded fields, plus the text arena of an imported feed once
+        for (int field = 0; field < Event::TextFieldCount; field++) {
+            if (!event->isTextPending(Event::TextField(field))) {
+                usage.bytes[EventStrings] += stringBytes(event->readText(Event::TextField(field)));
+            }
+        }
+        const QByteArray* arena = event->getTextArena();
+        if (arena && firstSighting(arena)) {
+            usage.bytes[EventStrings] += heapOverhead + qint64(sizeof(QByteArray)) + arena->capacity();
+        }
+        usage.bytes[Participants] = setBytes(event->getAvailableUsers());
+
+        entry.usage.add(usage);
+        userEntry(event->getOrganizer()).usage.add(usage);
+    }
+
+    entry.usage.bytes[EventLists] = listBytes(snapshot->events);
+    for (const std::shared_ptr<const EventIdIndex::Bucket>& ids : snapshot->ids.getBuckets()) {
+        if (ids) entry.usage.bytes[EventLists] += heapOverhead + qint64(sizeof(EventIdIndex::Bucket)) + hashBytes(*ids);
+    }
+    entry.usage.bytes[DateIndex] = mapBytes(snapshot->eventsByDate) + hashBytes(snapshot->occupiedDays.getWords())
+                                   + listBytes(snapshot->intervals.getShortEntries())
+                                   + listBytes(snapshot->intervals.getLongEntries());
+    for (const QList<Event*>& day : snapshot->eventsByDate) {
+        entry.usage.bytes[DateIndex] += listBytes(day);
+    }
+    // spilled events cost only their block list, the events are on disk
+    entry.usage.bytes[DateIndex] += mapBytes(snapshot->spilled);
+    for (const QList<EventSegment::Extent>& extents : snapshot->spilled) {
+        entry.usage.bytes[DateIndex] += listBytes(extents);
+    }
+    for (const std::shared_ptr<const TextIndex::Postings>& postings : snapshot->text.getBuckets()) {
+        if (!postings) continue;
+        entry.usage.bytes[SearchIndex] += heapOverhead + qint64(sizeof(TextIndex::Postings)) + mapBytes(*postings);
+        for (auto it = postings->cbegin(); it != postings->cend(); ++it) {
+            entry.usage.bytes[SearchIndex] += stringBytes(it.key()) + listBytes(it.value());
+        }
+    }
+
+    calendars.append(entry);
+}
+
+/**
+ * @brief Adds a user's own record.
+ * @param user The user.
+ */
+void MemoryReport::addUser(const User* user) {
+    if (!user || !firstSighting(user)) return;
+
+    userEntry(user).usage.bytes[UserRecords] += heapOverhead + qint64(sizeof(User))
+                                                + stringBytes(user->getFirstName())
+                                                + stringBytes(user->getLastName());
+}
+
+/**
+ * @brief Adds a cache or other structure outside the calendars.
+ * @param name The name shown for it.
+ * @param bytes Its size.
+ */
+void MemoryReport::addCache(const QString& name, qint64 bytes) {
+    caches.append({name, bytes});
+}
+
+/**
+ * @brief Estimates the payload of a string, once per shared payload.
+ * @param text The string.
+ * @return The bytes of its buffer, or 0 if static or already counted.
+ */
+qint64 MemoryReport::stringBytes(const QString& text) {
+    // literals and empty strings own no heap block
+    if (text.capacity() == 0 || !firstSighting(text.constData())) return 0;
+    return heapOverhead + arrayHeader + (text.capacity() + 1) * qint64(sizeof(QChar));
+}
+
+/**
+ * @brief Estimates a Qt 6 hash table.
+ * @param buckets The capacity.
+ * @param size The number of entries.
+ * @param nodeSize The size of one key and value.
+ * @return The bytes of its spans and nodes, or 0 if it was never allocated.
+ */
+qint64 MemoryReport::hashTableBytes(qint64 buckets, qint64 size, qint64 nodeSize) {
+    if (buckets == 0) return 0;
+
+    // spans of 128 buckets, each with its own offsets and entry block
+    qint64 spans = (buckets + 127) / 128;
+    qint64 alignedNode = (nodeSize + 7) / 8 * 8;
+    return heapOverhead + 40 + spans * (heapOverhead + 144 + heapOverhead) + size * alignedNode;
+}
+
+/**
+ * @brief Sums every calendar, plus the user records.
+ * @return The usage of all calendars and users.
+ */
+MemoryReport::Usage MemoryReport::calendarTotal() const {
+    Usage total;
+    for (const Entry& entry : calendars) {
+        total.add(entry.usage);
+    }
+    for (const Entry& entry : users) {
+        total.bytes[UserRecords] += entry.usage.bytes[UserRecords];
+    }
+    return total;
+}
+
+/**
+ * @brief Sums the caches.
+ * @return The bytes used by caches.
+ */
+qint64 MemoryReport::cacheTotal() const {
+    qint64 total = 0;
+    for (const QPair<QString, qint64>& cache : caches) {
+        total += cache.second;
+    }
+    return total;
+}
+
+/**
+ * @brief Gets the per calendar usage.
+ * @return One entry per calendar, in the order added.
+ */
+const QList<MemoryReport::Entry>& MemoryReport::getCalendars() const {
+    return calendars;
+}
+
+/**
+ * @brief Gets the per user usage.
+ * @return One entry per user, covering the events they organize and their record.
+ */
+const QList<MemoryReport::Entry>& MemoryReport::getUsers() const {
+    return users;
+}
+
+/**
+ * @brief Formats the report as tables.
+ * @return The report.
+ */
+QString MemoryReport::toText() const {
+    QString text;
+    QTextStream out(&text);
+    out << "Estimated heap usage\n\n";
+
+    writeTable(out, "Per calendar", calendars, {EventObjects, EventStrings, Participants, EventLists, DateIndex, SearchIndex});
+    writeTable(out, "Per user", users, {EventObjects, EventStrings, Participants, UserRecords});
+
+    out << "Caches\n";
+    for (const QPair<QString, qint64>& cache : caches) {
+        out << QString("  %1 %2\n").arg(cache.first, -24).arg(formatBytes(cache.second), 10);
+    }
+    out << "\n";
+
+    Usage total = calendarTotal();
+    out << "Totals\n";
+    for (int i = 0; i < ComponentCount; i++) {
+        out << QString("  %1 %2\n").arg(QString(componentNames[i]), -24).arg(formatBytes(total.bytes[i]), 10);
+    }
+    out << QString("  %1 %2\n").arg(QString("caches"), -24).arg(formatBytes(cacheTotal()), 10);
+    out << QString("  %1 %2\n").arg(QString("total"), -24).arg(formatBytes(total.total() + cacheTotal()), 10);
+    if (total.events > 0) {
+        out << QString("  %1 %2\n").arg(QString("per event"), -24).arg(formatBytes(total.total() / total.events), 10);
+    }
+    out.flush();
+    return text;
+}
+
+/**
+ * @brief Formats the report as JSON.
+ * @return The document.
+ */
+QJsonDocument MemoryReport::toJson() const {
+    QJsonArray calendarArray;
+    for (const Entry& entry : calendars) {
+        QJsonObject object = usageToJson(entry.usage);
+        object["name"] = entry.name;
+        calendarArray.append(object);
+    }
+
+    QJsonArray userArray;
+    for (const Entry& entry : users) {
+        QJsonObject object = usageToJson(entry.usage);
+        object["name"] = entry.name;
+        userArray.append(object);
+    }
+
+    QJsonObject cacheObject;
+    for (const QPair<QString, qint64>& cache : caches) {
+        cacheObject[cache.first] = cache.second;
+    }
+
+    QJsonObject totals = usageToJson(calendarTotal());
+    totals["caches"] = cacheTotal();
+    totals["total"] = calendarTotal().total() + cacheTotal();
+
+    QJsonObject root;
+    root["calendars"] = calendarArray;
+    root["users"] = userArray;
+    root["caches"] = cacheObject;
+    root["totals"] = totals;
+    return QJsonDocument(root);
+}
+
+/**
+ * @brief Formats a size for people.
+ * @param bytes The size.
+ * @return The size in B, KiB, MiB or GiB.
+ */
+QString MemoryReport::formatBytes(qint64 bytes) {
+    if (bytes < 1024) return QString("%1 B").arg(bytes);
+    if (bytes < 1024 * 1024) return QString("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+    if (bytes < 1024LL * 1024 * 1024) return QString("%1 MiB").arg(bytes / (1024.0 * 1024), 0, 'f', 1);
+    return QString("%1 GiB").arg(bytes / (1024.0 * 1024 * 1024), 0, 'f', 2);
+}
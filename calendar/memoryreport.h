@@ -0,0 +1,142 @@
+/**
+ * @file memoryreport.h
+ * @brief Defines the MemoryReport class.
+ *
+ * Estimates how much heap a loaded workspace uses, per calendar, per user
+ * and per component.
+ */
+#ifndef MEMORYREPORT_H
+#define MEMORYREPORT_H
+
+#include <QHash>
+#include <QJsonDocument>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+
+class Calendar;
+class User;
+
+/**
+ * @class MemoryReport
+ * @brief Accumulates estimated heap usage of calendars, users and caches.
+ *
+ * Sizes are estimates from each container's capacity plus the allocator's
+ * per-block overhead. Implicitly shared payloads are counted once, by whoever
+ * is added first, so strings shared between events and lists shared between
+ * a snapshot and a model do not inflate the totals. Only the current snapshot
+ * of each calendar is counted.
+ */
+class MemoryReport {
+public:
+    enum Component {
+        EventObjects,
+        EventStrings,
+        Participants,
+        EventLists,
+        DateIndex,
+        SearchIndex,
+        UserRecords,
+        ComponentCount
+    };
+
+    /**
+     * @struct Usage
+     * @brief Bytes per component.
+     */
+    struct Usage {
+        qint64 bytes[ComponentCount] = {};
+        qint64 events = 0;
+
+        qint64 total() const;
+        void add(const Usage& other);
+    };
+
+    /**
+     * @struct Entry
+     * @brief The usage of one calendar or one user.
+     */
+    struct Entry {
+        QString name;
+        Usage usage;
+    };
+
+private:
+    QSet<const void*> seen;
+    QList<Entry> calendars;
+    QList<Entry> users;
+    QHash<const User*, int> userRows;
+    QList<QPair<QString, qint64>> caches;
+
+    Entry& userEntry(const User* user);
+    bool firstSighting(const void* data);
+
+public:
+    static constexpr qint64 heapOverhead = 16; // allocator bookkeeping per block
+    static constexpr qint64 arrayHeader = 16;  // QArrayData before every QString/QList payload
+
+    void addWorkspace();
+    void addCalendar(const Calendar* calendar, const QString& name);
+    void addUser(const User* user);
+    void addCache(const QString& name, qint64 bytes);
+
+    qint64 stringBytes(const QString& text);
+
+    /**
+     * @brief Estimates the payload of a list, once per shared payload.
+     * @param list The list.
+     * @return The bytes of its buffer, or 0 if empty or already counted.
+     */
+    template <typename T>
+    qint64 listBytes(const QList<T>& list) {
+        if (list.capacity() == 0 || !firstSighting(list.constData())) return 0;
+        return heapOverhead + arrayHeader + list.capacity() * qint64(sizeof(T));
+    }
+
+    /**
+     * @brief Estimates the buckets and nodes of a hash.
+     * @param hash The hash.
+     * @return The bytes of its table, not counting what the values point to.
+     */
+    template <typename K, typename V>
+    static qint64 hashBytes(const QHash<K, V>& hash) {
+        return hashTableBytes(hash.capacity(), hash.size(), sizeof(K) + sizeof(V));
+    }
+
+    /**
+     * @brief Estimates the buckets and nodes of a set.
+     * @param set The set.
+     * @return The bytes of its table.
+     */
+    template <typename T>
+    static qint64 setBytes(const QSet<T>& set) {
+        return hashTableBytes(set.capacity(), set.size(), sizeof(T));
+    }
+
+    /**
+     * @brief Estimates the tree nodes of a map.
+     * @param map The map.
+     * @return The bytes of its nodes, not counting what the values point to.
+     */
+    template <typename K, typename V>
+    static qint64 mapBytes(const QMap<K, V>& map) {
+        if (map.isEmpty()) return 0;
+        // std::map header, then one red-black node per entry
+        return heapOverhead + 64 + map.size() * (heapOverhead + 32 + qint64(sizeof(K) + sizeof(V)));
+    }
+
+    static qint64 hashTableBytes(qint64 buckets, qint64 size, qint64 nodeSize);
+
+    Usage calendarTotal() const;
+    qint64 cacheTotal() const;
+    const QList<Entry>& getCalendars() const;
+    const QList<Entry>& getUsers() const;
+
+    QString toText() const;
+    QJsonDocument toJson() const;
+
+    static QString formatBytes(qint64 bytes);
+};
+
+#endif // MEMORYREPORT_H
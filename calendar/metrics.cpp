@@ -0,0 +1,333 @@
+/**
+ * @file metrics.cpp
+ * @brief Implementation of the Metrics class
+ */
+#include "metrics.h"
+#include "calendar.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QMutex>
+#include <QtAlgorithms>
+#include <QTextStream>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr int subBucketBits = 4;
+constexpr int subBuckets = 1 << subBucketBits;
+constexpr int bucketCount = (64 - subBucketBits + 1) * subBuckets;
+
+const char* const counterNames[Metrics::CounterCount] = {
+    "events_parsed",
+    "parse_errors_missing_summary",
+    "parse_errors_missing_start",
+    "parse_errors_bad_datetime",
+    "timezone_fallbacks",
+    "imported_files",
+    "imported_bytes",
+    "import_nanoseconds",
+    "availability_queries",
+    "events_paged_out",
+    "events_paged_in"
+};
+
+const char* const histogramNames[Metrics::HistogramCount] = {
+    "date_query_ns",
+    "slot_search_ns",
+    "text_search_ns"
+};
+
+/**
+ * Maps a value to its bucket: values below 16 get their own bucket, larger
+ * values share one per 16 steps of their highest power of two.
+ */
+int bucketOf(quint64 value) {
+    if (value < subBuckets) return int(value);
+
+    int exponent = 63 - qCountLeadingZeroBits(value);
+    int subBucket = int((value >> (exponent - subBucketBits)) & (subBuckets - 1));
+    return (exponent - subBucketBits + 1) * subBuckets + subBucket;
+}
+
+/**
+ * Gets the largest value that maps to a bucket.
+ */
+quint64 bucketUpperBound(int bucket) {
+    if (bucket < subBuckets) return quint64(bucket);
+
+    int exponent = bucket / subBuckets + subBucketBits - 1;
+    quint64 subBucket = quint64(bucket % subBuckets);
+    quint64 lower = (subBuckets + subBucket) << (exponent - subBucketBits);
+    return lower + (quint64(1) << (exponent - subBucketBits)) - 1;
+}
+
+// only the owning thread writes a shard, so a load and a store replace the locked add
+void bump(std::atomic<quint64>& value, quint64 delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+struct HistogramShard {
+    std::atomic<quint64> buckets[bucketCount];
+    std::atomic<quint64> count{0};
+    std::atomic<quint64> sum{0};
+    std::atomic<quint64> min{std::numeric_limits<quint64>::max()};
+    std::atomic<quint64> max{0};
+
+    HistogramShard() {
+        for (std::atomic<quint64>& bucket : buckets) {
+            bucket.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+struct MetricsShard {
+    std::atomic<quint64> counters[Metrics::CounterCount];
+    HistogramShard histograms[Metrics::HistogramCount];
+
+    MetricsShard() {
+        for (std::atomic<quint64>& counter : counters) {
+            counter.store(0, std::memory_order_relaxed);
+        }
+    }
+};
+
+// shards outlive their threads so the totals never go down
+QMutex shardsMutex;
+std::vector<std::unique_ptr<MetricsShard>> shards;
+thread_local MetricsShard* localShard = nullptr;
+
+const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+MetricsShard* shard() {
+    if (!localShard) {
+        QMutexLocker locker(&shardsMutex);
+        shards.push_back(std::make_unique<MetricsShard>());
+        localShard = shards.back().get();
+    }
+    return localShard;
+}
+
+QString formatNanoseconds(quint64 nanoseconds) {
+    if (nanoseconds < 10000) return QString("%1 ns").arg(nanoseconds);
+    if (nanoseconds < 10000000) return QString("%1 us").arg(nanoseconds / 1000.0, 0, 'f', 1);
+    return QString("%1 ms").arg(nanoseconds / 1000000.0, 0, 'f', 1);
+}
+
+double importMegabytesPerSecond() {
+    quint64 nanoseconds = Metrics::counter(Metrics::ImportNanoseconds);
+    return nanoseconds ? Metrics::counter(Metrics::ImportedBytes) * 1000.0 / nanoseconds : 0;
+}
+
+}
+
+/**
+ * @brief Adds to a counter.
+ * @param counter The counter.
+ * @param value The amount to add.
+ */
+void Metrics::add(Counter counter, quint64 value) {
+    bump(shard()->counters[counter], value);
+}
+
+/**
+ * @brief Records one latency sample.
+ * @param histogram The histogram.
+ * @param nanoseconds The latency.
+ */
+void Metrics::recordLatency(Histogram histogram, qint64 nanoseconds) {
+    quint64 value = quint64(qMax<qint64>(0, nanoseconds));
+    HistogramShard& target = shard()->histograms[histogram];
+
+    bump(target.buckets[bucketOf(value)], 1);
+    bump(target.count, 1);
+    bump(target.sum, value);
+    if (value < target.min.load(std::memory_order_relaxed)) {
+        target.min.store(value, std::memory_order_relaxed);
+    }
+    if (value > target.max.load(std::memory_order_relaxed)) {
+        target.max.store(value, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Gets a counter summed over all threads.
+ * @param counter The counter.
+ * @return The total.
+ */
+quint64 Metrics::counter(Counter counter) {
+    QMutexLocker locker(&shardsMutex);
+    quint64 total = 0;
+    for (const std::unique_ptr<MetricsShard>& shard : shards) {
+        total += shard->counters[counter].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+/**
+ * @brief Merges a histogram over all threads.
+ * @param histogram The histogram.
+ * @return The count, sum, extremes and percentiles, in nanoseconds.
+ */
+Metrics::HistogramSummary Metrics::histogram(Histogram histogram) {
+    std::vector<quint64> merged(bucketCount, 0);
+    HistogramSummary summary;
+    summary.min = std::numeric_limits<quint64>::max();
+
+    {
+        QMutexLocker locker(&shardsMutex);
+        for (const std::unique_ptr<MetricsShard>& shard : shards) {
+            const HistogramShard& source = shard->histograms[histogram];
+            for (int i = 0; i < bucketCount; i++) {
+                merged[i] += source.buckets[i].load(std::memory_order_relaxed);
+            }
+            summary.count += source.count.load(std::memory_order_relaxed);
+            summary.sum += source.sum.load(std::memory_order_relaxed);
+            summary.min = qMin(summary.min, source.min.load(std::memory_order_relaxed));
+            summary.max = qMax(summary.max, source.max.load(std::memory_order_relaxed));
+        }
+    }
+
+    if (summary.count == 0) {
+        summary.min = 0;
+        return summary;
+    }
+
+    // walk the buckets once, filling each percentile when its rank is reached
+    const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    quint64* targets[] = {&summary.p50, &summary.p90, &summary.p99, &summary.p999};
+    int next = 0;
+    quint64 seen = 0;
+    for (int i = 0; i < bucketCount && next < 4; i++) {
+        seen += merged[i];
+        while (next < 4 && seen >= quint64(quantiles[next] * summary.count + 0.5) && seen > 0) {
+            *targets[next++] = qMin(bucketUpperBound(i), summary.max);
+        }
+    }
+    while (next < 4) {
+        *targets[next++] = summary.max;
+    }
+    return summary;
+}
+
+/**
+ * @brief Measures the date indexes of some calendars.
+ * @param calendars The calendars.
+ * @return Their combined sizes.
+ */
+Metrics::IndexSizes Metrics::indexSizes(const QList<Calendar*>& calendars) {
+    IndexSizes sizes;
+    for (const Calendar* calendar : calendars) {
+        if (!calendar) continue;
+
+        std::shared_ptr<const Calendar::Snapshot> snapshot = calendar->snapshot();
+        sizes.calendars++;
+        sizes.events += snapshot->events.size();
+        sizes.indexedDays += snapshot->eventsByDate.size();
+        for (const QList<Event*>& day : snapshot->eventsByDate) {
+            sizes.largestDay = qMax<qint64>(sizes.largestDay, day.size());
+        }
+    }
+    return sizes;
+}
+
+/**
+ * @brief Formats every metric as a readable report.
+ * @param calendars The calendars whose index sizes are reported.
+ * @return The report.
+ */
+QString Metrics::toText(const QList<Calendar*>& calendars) {
+    QString text;
+    QTextStream out(&text);
+
+    out << "Counters\n";
+    for (int i = 0; i < CounterCount; i++) {
+        out << QString("  %1 %2\n").arg(QString(counterNames[i]), -30).arg(counter(Counter(i)));
+    }
+    out << QString("  %1 %2\n").arg(QString("import_mb_per_second"), -30).arg(importMegabytesPerSecond(), 0, 'f', 1);
+
+    IndexSizes sizes = indexSizes(calendars);
+    out << "\nDate indexes\n";
+    out << QString("  %1 %2\n").arg(QString("calendars"), -30).arg(sizes.calendars);
+    out << QString("  %1 %2\n").arg(QString("events"), -30).arg(sizes.events);
+    out << QString("  %1 %2\n").arg(QString("indexed_days"), -30).arg(sizes.indexedDays);
+    out << QString("  %1 %2\n").arg(QString("largest_day"), -30).arg(sizes.largestDay);
+
+    out << "\nLatency\n";
+    for (int i = 0; i < HistogramCount; i++) {
+        HistogramSummary summary = histogram(Histogram(i));
+        out << "  " << histogramNames[i] << "  count " << summary.count;
+        if (summary.count > 0) {
+            out << "  mean " << formatNanoseconds(summary.sum / summary.count)
+                << "  p50 " << formatNanoseconds(summary.p50)
+                << "  p90 " << formatNanoseconds(summary.p90)
+                << "  p99 " << formatNanoseconds(summary.p99)
+                << "  p99.9 " << formatNanoseconds(summary.p999)
+                << "  max " << formatNanoseconds(summary.max);
+        }
+        out << "\n";
+    }
+    out.flush();
+    return text;
+}
+
+/**
+ * @brief Formats every metric as JSON.
+ * @param calendars The calendars whose index sizes are reported.
+ * @return The document.
+ */
+QJsonDocument Metrics::toJson(const QList<Calendar*>& calendars) {
+    QJsonObject counters;
+    for (int i = 0; i < CounterCount; i++) {
+        counters[counterNames[i]] = qint64(counter(Counter(i)));
+    }
+    counters["import_mb_per_second"] = importMegabytesPerSecond();
+
+    IndexSizes sizes = indexSizes(calendars);
+    QJsonObject indexes;
+    indexes["calendars"] = sizes.calendars;
+    indexes["events"] = sizes.events;
+    indexes["indexed_days"] = sizes.indexedDays;
+    indexes["largest_day"] = sizes.largestDay;
+
+    QJsonObject histograms;
+    for (int i = 0; i < HistogramCount; i++) {
+        HistogramSummary summary = histogram(Histogram(i));
+        QJsonObject entry;
+        entry["count"] = qint64(summary.count);
+        entry["sum"] = qint64(summary.sum);
+        entry["min"] = qint64(summary.min);
+        entry["max"] = qint64(summary.max);
+        entry["p50"] = qint64(summary.p50);
+        entry["p90"] = qint64(summary.p90);
+        entry["p99"] = qint64(summary.p99);
+        entry["p999"] = qint64(summary.p999);
+        histograms[histogramNames[i]] = entry;
+    }
+
+    QJsonObject root;
+    root["counters"] = counters;
+    root["indexes"] = indexes;
+    root["histograms"] = histograms;
+    return QJsonDocument(root);
+}
+
+/**
+ * @brief Gets the metrics clock.
+ * @return Nanoseconds since the process started.
+ */
+qint64 Metrics::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+/**
+ * @brief Gets the memory held by the shards.
+ * @return The bytes of every shard created so far.
+ */
+qint64 Metrics::memoryUsage() {
+    QMutexLocker locker(&shardsMutex);
+    return qint64(shards.size()) * qint64(sizeof(MetricsShard));
+}
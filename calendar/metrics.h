@@ -0,0 +1,111 @@
+/**
+ * @file metrics.h
+ * @brief Defines the Metrics class and the LatencyScope helper.
+ *
+ * Counts what the core does and how long it takes, for the debug dialog
+ * and for text and JSON dumps.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <QJsonDocument>
+#include <QList>
+#include <QString>
+
+class Calendar;
+
+/**
+ * @class Metrics
+ * @brief Process-wide registry of counters and latency histograms.
+ *
+ * Every thread updates its own shard, so recording takes no lock and never
+ * shares a cache line with another thread. Reads merge all shards.
+ * Histograms are HDR style: buckets are exact below 16 ns and then split
+ * every power of two into 16, so any percentile is within 6.25% of the true value.
+ */
+class Metrics {
+public:
+    enum Counter {
+        EventsParsed,
+        ParseErrorMissingSummary,
+        ParseErrorMissingStart,
+        ParseErrorBadDateTime,
+        TimeZoneFallbacks,
+        ImportedFiles,
+        ImportedBytes,
+        ImportNanoseconds,
+        AvailabilityQueries,
+        EventsPagedOut,
+        EventsPagedIn,
+        CounterCount
+    };
+
+    enum Histogram {
+        DateQueryLatency,
+        SlotSearchLatency,
+        TextSearchLatency,
+        HistogramCount
+    };
+
+    /**
+     * @struct HistogramSummary
+     * @brief A histogram merged over all threads, in nanoseconds.
+     */
+    struct HistogramSummary {
+        quint64 count = 0;
+        quint64 sum = 0;
+        quint64 min = 0;
+        quint64 max = 0;
+        quint64 p50 = 0;
+        quint64 p90 = 0;
+        quint64 p99 = 0;
+        quint64 p999 = 0;
+    };
+
+    /**
+     * @struct IndexSizes
+     * @brief Sizes of the date indexes of a set of calendars.
+     */
+    struct IndexSizes {
+        int calendars = 0;
+        qint64 events = 0;
+        qint64 indexedDays = 0;
+        qint64 largestDay = 0;
+    };
+
+    static void add(Counter counter, quint64 value = 1);
+    static void recordLatency(Histogram histogram, qint64 nanoseconds);
+
+    static quint64 counter(Counter counter);
+    static HistogramSummary histogram(Histogram histogram);
+    static IndexSizes indexSizes(const QList<Calendar*>& calendars);
+
+    static QString toText(const QList<Calendar*>& calendars);
+    static QJsonDocument toJson(const QList<Calendar*>& calendars);
+
+    static qint64 now();
+    static qint64 memoryUsage();
+};
+
+/**
+ * @class LatencyScope
+ * @brief Records the time between its construction and destruction into a histogram.
+ */
+class LatencyScope {
+private:
+    Metrics::Histogram histogram;
+    qint64 startNs;
+
+public:
+    explicit LatencyScope(Metrics::Histogram histogram)
+        : histogram(histogram), startNs(Metrics::now()) {}
+
+    ~LatencyScope() {
+        Metrics::recordLatency(histogram, Metrics::now() - startNs);
+    }
+
+    LatencyScope(const LatencyScope&) = delete;
+    LatencyScope& operator=(const LatencyScope&) = delete;
+};
+
+#endif // METRICS_H
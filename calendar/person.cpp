@@ -12,7 +12,7 @@
  * @param firstName The first name of person.
  * @param lastName The last name of the person.
  */
-Person::Person(int id, const QString& firstName, const QString& lastName)
+Person::Person(qint64 id, const QString& firstName, const QString& lastName)
     : personID(id), firstName(firstName), lastName(lastName) {}
 
 /**
@@ -20,7 +20,7 @@ Person::Person(int id, const QString& firstName, const QString& lastName)
  *
  * @return The person's unique ID as integer.
  */
-int Person::getPersonID() const {
+qint64 Person::getPersonID() const {
     return personID;
 }
 
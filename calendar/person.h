@@ -18,16 +18,16 @@
  */
 class Person {
 protected:
-    int personID;
+    qint64 personID;
     QString firstName;
     QString lastName;
 
 public:
-    Person(int id, const QString& firstName, const QString& lastName);
+    Person(qint64 id, const QString& firstName, const QString& lastName);
 
     virtual ~Person() = default;
 
-    int getPersonID() const;
+    qint64 getPersonID() const;
     QString getFirstName() const;\
     QString getLastName() const;
     QString getFullName() const;
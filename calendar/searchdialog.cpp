@@ -0,0 +1,149 @@
+/**
+ * @file searchdialog.cpp
+ * @brief Implementation of the SearchDialog class
+ */
+#include "searchdialog.h"
+#include "metrics.h"
+#include "trace.h"
+#include <QHBoxLayout>
+#include <QPushButton>
+#include <QVBoxLayout>
+#include <algorithm>
+
+/**
+ * @brief Sets up the query field, the date range and the result list.
+ * @param sources The calendars to search.
+ * @param parent The parent widget of the dialog.
+ *
+ * The range starts as today and the three months after it.
+ */
+SearchDialog::SearchDialog(const QList<Source>& sources, QWidget* parent)
+    : QDialog(parent), sources(sources) {
+    setWindowTitle("Find Events");
+    resize(520, 480);
+
+    QVBoxLayout* mainLayout = new QVBoxLayout(this);
+
+    queryEdit = new QLineEdit(this);
+    queryEdit->setPlaceholderText("Words in the title, description, location or organizer");
+    queryEdit->setClearButtonEnabled(true);
+    mainLayout->addWidget(queryEdit);
+
+    // date range
+    QHBoxLayout* rangeLayout = new QHBoxLayout();
+    QDate today = QDate::currentDate();
+    fromEdit = new QDateEdit(today, this);
+    fromEdit->setCalendarPopup(true);
+    toEdit = new QDateEdit(today.addMonths(3), this);
+    toEdit->setCalendarPopup(true);
+    rangeLayout->addWidget(new QLabel("From:"));
+    rangeLayout->addWidget(fromEdit);
+    rangeLayout->addWidget(new QLabel("To:"));
+    rangeLayout->addWidget(toEdit);
+    rangeLayout->addStretch();
+    mainLayout->addLayout(rangeLayout);
+
+    countLabel = new QLabel(this);
+    mainLayout->addWidget(countLabel);
+
+    resultList = new QListWidget(this);
+    resultList->setUniformItemSizes(true);
+    mainLayout->addWidget(resultList);
+
+    QPushButton* closeButton = new QPushButton("Close", this);
+    QHBoxLayout* buttonLayout = new QHBoxLayout();
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(closeButton);
+    mainLayout->addLayout(buttonLayout);
+
+    connect(queryEdit, &QLineEdit::textChanged, this, &SearchDialog::search);
+    // stepping through dates announces only the last range, each announcement pages months in and out
+    rangeTimer = new QTimer(this);
+    rangeTimer->setSingleShot(true);
+    rangeTimer->setInterval(rangeDelay);
+    connect(fromEdit, &QDateEdit::dateChanged, rangeTimer, qOverload<>(&QTimer::start));
+    connect(toEdit, &QDateEdit::dateChanged, rangeTimer, qOverload<>(&QTimer::start));
+    // announce the range first, so its months can be made resident before searching them
+    connect(rangeTimer, &QTimer::timeout, this, [this]() {
+        emit rangeChanged(fromEdit->date(), toEdit->date());
+        search();
+    });
+    connect(resultList, &QListWidget::itemActivated, [this](QListWidgetItem* item) {
+        Event* event = static_cast<Event*>(item->data(Qt::UserRole).value<void*>());
+        bool isCreated = item->data(Qt::UserRole + 1).toBool();
+        emit eventClicked(event, isCreated);
+
+        // the event may have been edited or deleted from its details dialog; search
+        // again once the item that was activated is no longer in use
+        QMetaObject::invokeMethod(this, &SearchDialog::search, Qt::QueuedConnection);
+    });
+    connect(closeButton, &QPushButton::clicked, this, &QDialog::accept);
+
+    search();
+}
+
+/**
+ * @brief Gets the date range searched.
+ * @return The first and last day, inclusive.
+ */
+QPair<QDate, QDate> SearchDialog::getRange() const {
+    return {fromEdit->date(), toEdit->date()};
+}
+
+/**
+ * @brief Lists the events matching the current query and range, by start time.
+ */
+void SearchDialog::search() {
+    TRACE_SCOPE("SearchDialog::search");
+    LatencyScope latency(Metrics::TextSearchLatency);
+
+    resultList->clear();
+    snapshots.clear();
+
+    QString query = queryEdit->text();
+    if (query.trimmed().isEmpty()) {
+        countLabel->setText("Type to search every calendar.");
+        return;
+    }
+
+    qint64 fromUtc = fromEdit->date().startOfDay().toSecsSinceEpoch();
+    qint64 toUtc = toEdit->date().addDays(1).startOfDay().toSecsSinceEpoch();
+
+    struct Hit {
+        Event* event;
+        bool isCreated;
+    };
+    auto byStart = [](const Hit& a, const Hit& b) { return a.event->getStartUtc() < b.event->getStartUtc(); };
+    QList<Hit> hits;
+    for (const Source& source : sources) {
+        if (!source.calendar) continue;
+
+        // search the version kept alive for as long as its events are listed
+        snapshots.push_back(source.calendar->snapshot());
+        qsizetype sorted = hits.size();
+        for (Event* event : Calendar::search(*snapshots.back(), query, fromUtc, toUtc)) {
+            hits.append({event, source.isCreated});
+        }
+        // each calendar's hits come by start already, so only the runs are merged
+        std::inplace_merge(hits.begin(), hits.begin() + sorted, hits.end(), byStart);
+    }
+
+    for (qsizetype i = 0; i < hits.size() && i < maxShown; i++) {
+        const Event* event = hits[i].event;
+        QString organizer = event->getOrganizerName().trimmed();
+        QString text = QString("%1  %2").arg(event->getDate().toString("ddd MMM d, yyyy h:mm AP"), event->getTitle());
+        if (!hits[i].isCreated && !organizer.isEmpty()) {
+            text += QString("  (%1)").arg(organizer);
+        }
+
+        QListWidgetItem* item = new QListWidgetItem(text, resultList);
+        item->setData(Qt::UserRole, QVariant::fromValue(static_cast<void*>(hits[i].event)));
+        item->setData(Qt::UserRole + 1, hits[i].isCreated);
+    }
+
+    if (hits.size() > maxShown) {
+        countLabel->setText(QString("%1 events found, showing the first %2.").arg(hits.size()).arg(maxShown));
+    } else {
+        countLabel->setText(QString("%1 event%2 found.").arg(hits.size()).arg(hits.size() == 1 ? "" : "s"));
+    }
+}
@@ -0,0 +1,72 @@
+/**
+ * @file searchdialog.h
+ * @brief Defines the SearchDialog class.
+ *
+ * The SearchDialog class finds events across every calendar by their text and dates.
+ */
+#ifndef SEARCHDIALOG_H
+#define SEARCHDIALOG_H
+
+#include <QDateEdit>
+#include <QDialog>
+#include <QLabel>
+#include <QLineEdit>
+#include <QListWidget>
+#include <QPair>
+#include <QTimer>
+#include <memory>
+#include <vector>
+#include "calendar.h"
+#include "event.h"
+
+/**
+ * @class SearchDialog
+ * @brief Dialog listing the events that match a query within a date range.
+ *
+ * Every keystroke queries the text index of each calendar. The calendar snapshots
+ * the results came from are held until the next search, so the listed events
+ * stay valid while they are shown. Only resident events are found, so the
+ * range is announced before it is searched, once the dates stop changing.
+ */
+class SearchDialog : public QDialog {
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Source
+     * @brief A calendar to search.
+     */
+    struct Source {
+        const Calendar* calendar;
+        bool isCreated;
+    };
+
+private:
+    // results listed at most, the count shows how many matched
+    static constexpr int maxShown = 500;
+
+    // how long the range has to stay put before it is announced, in ms
+    static constexpr int rangeDelay = 300;
+
+    QList<Source> sources;
+    std::vector<std::shared_ptr<const Calendar::Snapshot>> snapshots;
+    QLineEdit* queryEdit;
+    QDateEdit* fromEdit;
+    QDateEdit* toEdit;
+    QLabel* countLabel;
+    QListWidget* resultList;
+    QTimer* rangeTimer;
+
+    void search();
+
+public:
+    SearchDialog(const QList<Source>& sources, QWidget* parent = nullptr);
+
+    QPair<QDate, QDate> getRange() const;
+
+signals:
+    void eventClicked(Event* event, bool isCreatedEvent);
+    void rangeChanged(const QDate& from, const QDate& to);
+};
+
+#endif // SEARCHDIALOG_H
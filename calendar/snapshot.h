@@ -0,0 +1,103 @@
+/**
+ * @file snapshot.h
+ * @brief Defines the SnapshotCell and RetireEpoch helpers.
+ *
+ * Readers grab an immutable, reference-counted snapshot without locking,
+ * writers build a new version and publish it atomically (RCU style).
+ */
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <memory>
+#include <vector>
+
+/**
+ * @class RetireEpoch
+ * @brief Keeps objects removed by a writer alive until no reader can still see them.
+ *
+ * Every published snapshot owns one epoch, and each epoch owns the epoch that
+ * replaced it. An object retired while going from version N to N+1 is parked in
+ * epoch N, so it is freed only once every snapshot up to version N has been released.
+ */
+class RetireEpoch {
+private:
+    std::vector<std::shared_ptr<void>> retired;
+    std::shared_ptr<RetireEpoch> next;
+
+public:
+    RetireEpoch() = default;
+    RetireEpoch(const RetireEpoch&) = delete;
+    RetireEpoch& operator=(const RetireEpoch&) = delete;
+
+    /**
+     * @brief Frees the epochs only this one still refers to, in a loop.
+     *
+     * A snapshot held across many publishes keeps a long chain alive;
+     * letting each epoch free the next would recurse once per publish.
+     */
+    ~RetireEpoch() {
+        std::shared_ptr<RetireEpoch> later = std::move(next);
+        while (later && later.use_count() == 1) {
+            std::shared_ptr<RetireEpoch> following = std::move(later->next);
+            later = std::move(following);
+        }
+    }
+
+    /**
+     * @brief Hands ownership of a removed object to this epoch.
+     * @param object The object to delete once the epoch is released.
+     */
+    template <typename T>
+    void retire(T* object) {
+        if (object) {
+            retired.push_back(std::shared_ptr<void>(object));
+        }
+    }
+
+    /**
+     * @brief Opens the epoch used by the next published version.
+     * @return The new epoch, kept alive by this one.
+     */
+    std::shared_ptr<RetireEpoch> advance() {
+        next = std::make_shared<RetireEpoch>();
+        return next;
+    }
+};
+
+/**
+ * @class SnapshotCell
+ * @brief Holds the current immutable version of some state.
+ *
+ * load() may be called from any thread. publish() must be serialized by the
+ * owner's write lock.
+ */
+template <typename T>
+class SnapshotCell {
+private:
+    std::shared_ptr<const T> current;
+
+public:
+    explicit SnapshotCell(std::shared_ptr<const T> initial)
+        : current(std::move(initial)) {}
+
+    SnapshotCell(const SnapshotCell&) = delete;
+    SnapshotCell& operator=(const SnapshotCell&) = delete;
+
+    /**
+     * @brief Gets the current version.
+     * @return A reference-counted pointer that stays valid after later publishes.
+     */
+    std::shared_ptr<const T> load() const {
+        return std::atomic_load(&current);
+    }
+
+    /**
+     * @brief Replaces the current version.
+     * @param next The new version.
+     */
+    void publish(std::shared_ptr<const T> next) {
+        std::atomic_store(&current, std::move(next));
+    }
+};
+
+#endif // SNAPSHOT_H
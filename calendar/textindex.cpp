@@ -0,0 +1,304 @@
+/**
+ * @file textindex.cpp
+ * @brief Implementation of the TextIndex class
+ */
+#include "textindex.h"
+#include "trace.h"
+#include "user.h"
+#include <QHash>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+namespace {
+
+// posting lists are ordered by address, any consistent order works for intersections
+constexpr std::less<const Event*> byAddress{};
+
+}
+
+/**
+ * @brief Gets the bucket a word is kept in.
+ * @param word The case-folded word.
+ * @return The bucket index.
+ */
+int TextIndex::bucketOf(const QString& word) {
+    return int(qHash(word, 0) % bucketCount);
+}
+
+/**
+ * @brief Gets a bucket this index may change.
+ * @param bucket The bucket index.
+ * @return The word map, cloned first if another copy of the index shares it.
+ */
+TextIndex::Postings& TextIndex::writable(int bucket) {
+    std::shared_ptr<const Postings>& shared = buckets[bucket];
+    if (!shared) {
+        shared = std::make_shared<Postings>();
+    } else if (shared.use_count() > 1) {
+        shared = std::make_shared<Postings>(*shared);
+    }
+    // only this index refers to the map now, so changing it is not seen by any reader
+    return const_cast<Postings&>(*shared);
+}
+
+/**
+ * @brief Splits text into case-folded words.
+ * @param text The text.
+ * @return The words, made of letters and digits, in order and with repeats.
+ */
+QStringList TextIndex::tokenize(QStringView text) {
+    QStringList words;
+    qsizetype start = -1;
+    for (qsizetype i = 0; i <= text.size(); i++) {
+        bool inWord = i < text.size() && text[i].isLetterOrNumber();
+        if (inWord && start < 0) {
+            start = i;
+        } else if (!inWord && start >= 0) {
+            words.append(text.mid(start, i - start).toString().toCaseFolded());
+            start = -1;
+        }
+    }
+    return words;
+}
+
+/**
+ * @brief Splits an escaped ICS text value into case-folded words without unescaping it.
+ * @param utf8 The value as UTF-8, with TEXT escapes as in the feed.
+ * @return The same words as tokenize() of the unescaped value.
+ *
+ * An escaped n or N is a line break, any other escaped character stands for itself. Like
+ * tokenize(), which looks at UTF-16 units, characters outside the BMP separate words.
+ */
+QStringList TextIndex::tokenizeEscaped(QByteArrayView utf8) {
+    QStringList words;
+    QByteArray word;
+    auto endWord = [&]() {
+        if (word.isEmpty()) return;
+        words.append(QString::fromUtf8(word).toCaseFolded());
+        word.clear();
+    };
+
+    qsizetype i = 0;
+    while (i < utf8.size()) {
+        uchar lead = uchar(utf8[i]);
+        if (lead == '\\' && i + 1 < utf8.size()) {
+            char escaped = utf8[i + 1];
+            if (escaped == 'n' || escaped == 'N') {
+                endWord();
+                i += 2;
+                continue;
+            }
+            // the escaped character is taken literally, even a backslash
+            i++;
+            lead = uchar(utf8[i]);
+        }
+
+        if (lead < 0x80) {
+            if (QChar::isLetterOrNumber(char32_t(lead))) {
+                word.append(char(lead));
+            } else {
+                endWord();
+            }
+            i++;
+            continue;
+        }
+
+        // a multi-byte sequence, checked as strictly as QString::fromUtf8() does
+        int length = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+        char32_t code = length == 4 ? lead & 0x07 : length == 3 ? lead & 0x0F : lead & 0x1F;
+        bool valid = length > 1 && lead < 0xF5 && i + length <= utf8.size();
+        for (int k = 1; valid && k < length; k++) {
+            uchar next = uchar(utf8[i + k]);
+            valid = (next & 0xC0) == 0x80;
+            code = (code << 6) | (next & 0x3F);
+        }
+        static constexpr char32_t smallest[] = {0, 0, 0x80, 0x800, 0x10000};
+        valid = valid && code >= smallest[length] && !(code >= 0xD800 && code <= 0xDFFF);
+        if (valid && code < 0x10000 && QChar::isLetterOrNumber(code)) {
+            word.append(utf8.data() + i, length);
+        } else {
+            endWord();
+        }
+        i += valid ? length : 1;
+    }
+    endWord();
+    return words;
+}
+
+/**
+ * @brief Gets the distinct words an event is found by.
+ * @param event The event.
+ * @return The words of its title, description, location and organizer name, sorted.
+ */
+QStringList TextIndex::wordsOf(const Event* event) {
+    // fields still in the arena are tokenized as they are, indexing must not decode every event
+    QStringList words;
+    for (int field = 0; field < Event::TextFieldCount; field++) {
+        QByteArrayView escaped;
+        if (event->readEscapedText(Event::TextField(field), escaped)) {
+            words += tokenizeEscaped(escaped);
+        } else {
+            words += tokenize(event->readText(Event::TextField(field)));
+        }
+    }
+    if (const User* organizer = event->getOrganizer()) {
+        words += tokenize(organizer->getFullName());
+    }
+    words.sort();
+    words.erase(std::unique(words.begin(), words.end()), words.end());
+    return words;
+}
+
+/**
+ * @brief Adds an event.
+ * @param event The event.
+ */
+void TextIndex::insert(Event* event) {
+    if (!event) return;
+
+    for (const QString& word : wordsOf(event)) {
+        QList<Event*>& list = writable(bucketOf(word))[word];
+        list.insert(std::lower_bound(list.begin(), list.end(), event, byAddress), event);
+    }
+}
+
+/**
+ * @brief Adds several events at once.
+ * @param events The events.
+ *
+ * New postings are appended, then sorted and merged once per touched word, so an
+ * import costs one pass over each touched list instead of one per event. Each
+ * touched bucket is cloned at most once, on first use.
+ */
+void TextIndex::insert(const QList<Event*>& events) {
+    TRACE_SCOPE("TextIndex::insert");
+    QHash<QString, qsizetype> firstNew; // per touched word, where the appended postings start
+    for (Event* event : events) {
+        if (!event) continue;
+
+        for (const QString& word : wordsOf(event)) {
+            QList<Event*>& list = writable(bucketOf(word))[word];
+            firstNew.insert(word, firstNew.value(word, list.size()));
+            list.append(event);
+        }
+    }
+
+    for (auto it = firstNew.cbegin(); it != firstNew.cend(); ++it) {
+        QList<Event*>& list = writable(bucketOf(it.key()))[it.key()];
+        auto middle = list.begin() + it.value();
+        std::sort(middle, list.end(), byAddress);
+        std::inplace_merge(list.begin(), middle, list.end(), byAddress);
+    }
+}
+
+/**
+ * @brief Removes an event.
+ * @param event The event, with the text it was inserted with.
+ * @return true if the event was found.
+ */
+bool TextIndex::remove(Event* event) {
+    if (!event) return false;
+
+    bool found = false;
+    for (const QString& word : wordsOf(event)) {
+        int bucket = bucketOf(word);
+        if (!buckets[bucket] || !buckets[bucket]->contains(word)) continue;
+
+        Postings& postings = writable(bucket);
+        auto entry = postings.find(word);
+        QList<Event*>& list = *entry;
+        auto it = std::lower_bound(list.begin(), list.end(), event, byAddress);
+        if (it != list.end() && *it == event) {
+            list.erase(it);
+            found = true;
+        }
+        if (list.isEmpty()) {
+            postings.erase(entry);
+        }
+    }
+    return found;
+}
+
+/**
+ * @brief Gets the events containing a word that starts with a prefix.
+ * @param prefix The case-folded prefix.
+ * @return The events, sorted by address, without repeats.
+ *
+ * Words sharing a prefix are spread over the buckets, so each bucket is looked up once.
+ */
+QList<Event*> TextIndex::prefixPostings(const QString& prefix) const {
+    QList<const QList<Event*>*> lists;
+    for (const std::shared_ptr<const Postings>& postings : buckets) {
+        if (!postings) continue;
+        for (auto it = postings->lowerBound(prefix); it != postings->cend() && it.key().startsWith(prefix); ++it) {
+            lists.append(&*it);
+        }
+    }
+    if (lists.isEmpty()) return {};
+
+    // a single matching word is answered with its shared list
+    if (lists.size() == 1) return *lists.first();
+
+    QList<Event*> merged;
+    for (const QList<Event*>* list : lists) {
+        merged += *list;
+    }
+    std::sort(merged.begin(), merged.end(), byAddress);
+    merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+    return merged;
+}
+
+/**
+ * @brief Finds the events containing every word of a query.
+ * @param query The query; each of its words matches any word starting with it.
+ * @return The matching events, in no particular order; none for a query without words.
+ *
+ * Intersects the shortest posting list first, so a rare word keeps the query
+ * cheap however common the other words are.
+ */
+QList<Event*> TextIndex::search(QStringView query) const {
+    TRACE_SCOPE("TextIndex::search");
+    QStringList words = tokenize(query);
+    words.removeDuplicates();
+    if (words.isEmpty()) return {};
+
+    QList<QList<Event*>> lists;
+    for (const QString& word : words) {
+        QList<Event*> list = prefixPostings(word);
+        if (list.isEmpty()) return {};
+        lists.append(list);
+    }
+    std::sort(lists.begin(), lists.end(),
+              [](const QList<Event*>& a, const QList<Event*>& b) { return a.size() < b.size(); });
+
+    QList<Event*> result = lists.first();
+    for (qsizetype i = 1; i < lists.size() && !result.isEmpty(); i++) {
+        QList<Event*> both;
+        both.reserve(result.size());
+        std::set_intersection(result.cbegin(), result.cend(), lists[i].cbegin(), lists[i].cend(),
+                              std::back_inserter(both), byAddress);
+        result.swap(both);
+    }
+    return result;
+}
+
+/**
+ * @brief Gets the number of distinct words indexed.
+ * @return The number of posting lists.
+ */
+qsizetype TextIndex::wordCount() const {
+    qsizetype count = 0;
+    for (const std::shared_ptr<const Postings>& postings : buckets) {
+        if (postings) count += postings->size();
+    }
+    return count;
+}
+
+/**
+ * @brief Gets the word maps, for memory estimates.
+ * @return The buckets; nullptr for an empty one.
+ */
+const std::array<std::shared_ptr<const TextIndex::Postings>, TextIndex::bucketCount>& TextIndex::getBuckets() const {
+    return buckets;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file textindex.h
+ * @brief Defines the TextIndex class.
+ *
+ * Finds the events whose text contains every word of a query.
+ */
+#ifndef TEXTINDEX_H
+#define TEXTINDEX_H
+
+#include <QByteArrayView>
+#include <QList>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <array>
+#include <memory>
+#include "event.h"
+
+/**
+ * @class TextIndex
+ * @brief Inverted index from the words of an event to the event.
+ *
+ * Title, description, location and organizer name are split into case-folded
+ * words. Each word maps to a posting list of the events containing it, kept
+ * sorted by address so queries intersect lists in one linear pass, rarest
+ * first. Query words match as prefixes.
+ *
+ * The words are spread over bucketCount word maps by hash, and copies of the
+ * index share the maps. A change clones only the maps of the words it touches,
+ * so publishing an edit of one event copies a few small maps instead of every
+ * word of the calendar; the posting lists themselves are implicitly shared.
+ */
+class TextIndex {
+public:
+    using Postings = QMap<QString, QList<Event*>>; // sorted by word, for prefix ranges
+    static constexpr int bucketCount = 256;
+
+private:
+    std::array<std::shared_ptr<const Postings>, bucketCount> buckets; // nullptr while empty
+
+    static int bucketOf(const QString& word);
+    Postings& writable(int bucket);
+    static QStringList wordsOf(const Event* event);
+    QList<Event*> prefixPostings(const QString& prefix) const;
+
+public:
+    TextIndex() = default;
+
+    void insert(Event* event);
+    void insert(const QList<Event*>& events);
+    bool remove(Event* event);
+
+    QList<Event*> search(QStringView query) const;
+    qsizetype wordCount() const;
+
+    const std::array<std::shared_ptr<const Postings>, bucketCount>& getBuckets() const;
+
+    static QStringList tokenize(QStringView text);
+    static QStringList tokenizeEscaped(QByteArrayView utf8);
+};
+
+#endif // TEXTINDEX_H
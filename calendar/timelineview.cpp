@@ -0,0 +1,315 @@
+/**
+ * @file timelineview.cpp
+ * @brief Implementation of the TimelineView class
+ */
+#include "timelineview.h"
+#include "trace.h"
+#include <QLocale>
+#include <QMouseEvent>
+#include <QPainter>
+#include <QScrollBar>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+template <typename T>
+bool topBefore(const T& item, int top) {
+    return item.top < top;
+}
+
+}
+
+/**
+ * @brief Constructs a timeline.
+ * @param dayCount The number of days shown: 1 for a day view, 7 for a week view.
+ * @param parent The parent widget.
+ */
+TimelineView::TimelineView(int dayCount, QWidget* parent)
+    : QAbstractScrollArea(parent), dayCount(qMax(1, dayCount)) {
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    viewport()->setAttribute(Qt::WA_OpaquePaintEvent);
+    verticalScrollBar()->setSingleStep(hourHeight / 4);
+    refresh(QDate::currentDate(), {});
+}
+
+/**
+ * @brief Shows the days around a date.
+ * @param date The date to show; a week view starts at the first day of its week.
+ * @param sources The calendars to show, painted in this order.
+ *
+ * Queries each calendar once for the whole range shown and lays out the events.
+ */
+void TimelineView::refresh(const QDate& date, const QList<Source>& sources) {
+    TRACE_SCOPE("TimelineView::refresh");
+    QDate first = date.isValid() ? date : QDate::currentDate();
+    if (dayCount == 7) {
+        first = first.addDays(-((first.dayOfWeek() - int(QLocale().firstDayOfWeek()) + 7) % 7));
+    }
+
+    days.clear();
+    QList<qint64> bounds; // bounds[i] and bounds[i + 1] enclose day i
+    for (int i = 0; i <= dayCount; i++) {
+        bounds.append(first.addDays(i).startOfDay().toSecsSinceEpoch());
+        if (i < dayCount) {
+            days.append(Day{first.addDays(i), {}, 0});
+        }
+    }
+
+    snapshots.clear();
+    for (const Source& source : sources) {
+        if (!source.calendar) continue;
+
+        std::shared_ptr<const Calendar::Snapshot> snapshot = source.calendar->snapshot();
+        for (Event* event : snapshot->intervals.overlapping(bounds.first(), bounds.last())) {
+            for (int i = 0; i < dayCount; i++) {
+                qint64 dayStart = bounds[i];
+                qint64 dayEnd = bounds[i + 1];
+                bool instant = event->getEndUtc() == event->getStartUtc();
+                if (event->getStartUtc() >= dayEnd || (event->getEndUtc() <= dayStart && !instant)
+                    || (instant && event->getStartUtc() < dayStart)) {
+                    continue;
+                }
+
+                // DST days are stretched to the same height as the others
+                qint64 length = dayEnd - dayStart;
+                int height = contentHeight();
+                int top = int((qMax(event->getStartUtc(), dayStart) - dayStart) * height / length);
+                int bottom = int((qMin(event->getEndUtc(), dayEnd) - dayStart) * height / length);
+                top = qMin(top, height - minItemHeight);
+                bottom = qMax(bottom, top + minItemHeight);
+                days[i].items.append(Item{top, bottom, 0, 1, source.color, event, source.isCreated});
+            }
+        }
+        snapshots.push_back(std::move(snapshot));
+    }
+
+    for (Day& day : days) {
+        layoutDay(day);
+    }
+    updateScrollBar();
+    viewport()->update();
+}
+
+/**
+ * @brief Gets the first day shown.
+ * @return The date of the leftmost column.
+ */
+QDate TimelineView::getFirstDay() const {
+    return days.isEmpty() ? QDate() : days.first().date;
+}
+
+/**
+ * @brief Places the events of a day in columns.
+ * @param day The day, with its items in any order.
+ *
+ * Events are taken by start; each goes to the leftmost column free at its top.
+ * A group of transitively overlapping events splits the width between its
+ * columns, while events overlapping nothing get the full width.
+ */
+void TimelineView::layoutDay(Day& day) {
+    QList<Item>& items = day.items;
+    std::sort(items.begin(), items.end(), [](const Item& a, const Item& b) {
+        return a.top != b.top ? a.top < b.top : a.bottom > b.bottom;
+    });
+
+    QList<int> columnEnds;
+    qsizetype groupStart = 0;
+    int groupEnd = INT_MIN;
+    auto closeGroup = [&](qsizetype end) {
+        for (qsizetype j = groupStart; j < end; j++) {
+            items[j].columns = int(columnEnds.size());
+        }
+        columnEnds.clear();
+        groupStart = end;
+    };
+
+    day.maxHeight = 0;
+    for (qsizetype i = 0; i < items.size(); i++) {
+        Item& item = items[i];
+        if (i > groupStart && item.top >= groupEnd) {
+            closeGroup(i);
+        }
+
+        qsizetype column = 0;
+        while (column < columnEnds.size() && columnEnds[column] > item.top) {
+            column++;
+        }
+        if (column == columnEnds.size()) {
+            columnEnds.append(item.bottom);
+        } else {
+            columnEnds[column] = item.bottom;
+        }
+        item.column = int(column);
+        groupEnd = i == groupStart ? item.bottom : qMax(groupEnd, item.bottom);
+        day.maxHeight = qMax(day.maxHeight, item.bottom - item.top);
+    }
+    closeGroup(items.size());
+}
+
+/**
+ * @brief Gets the height of a whole day.
+ * @return The height in pixels.
+ */
+int TimelineView::contentHeight() const {
+    return 24 * hourHeight;
+}
+
+/**
+ * @brief Gets the left edge of a day column.
+ * @param day The index of the day, or dayCount for the right edge of the last one.
+ * @return The x coordinate in the viewport.
+ */
+int TimelineView::columnLeft(int day) const {
+    return axisWidth + (viewport()->width() - axisWidth) * day / dayCount;
+}
+
+/**
+ * @brief Gets where an event is drawn.
+ * @param day The index of the day.
+ * @param item The laid out event.
+ * @return The rectangle in viewport coordinates.
+ */
+QRect TimelineView::itemRect(int day, const Item& item) const {
+    int left = columnLeft(day) + 1;
+    int width = columnLeft(day + 1) - left - 1;
+    int x0 = left + width * item.column / item.columns;
+    int x1 = left + width * (item.column + 1) / item.columns;
+    int y = headerHeight - verticalScrollBar()->value();
+    return QRect(x0, y + item.top, qMax(1, x1 - x0 - 1), item.bottom - item.top - 1);
+}
+
+/**
+ * @brief Fits the scroll bar to the viewport.
+ *
+ * The first time the view gets a size, it scrolls to 8 AM.
+ */
+void TimelineView::updateScrollBar() {
+    int visible = viewport()->height() - headerHeight;
+    verticalScrollBar()->setRange(0, qMax(0, contentHeight() - visible));
+    verticalScrollBar()->setPageStep(qMax(1, visible));
+    if (!positioned && visible > 0) {
+        verticalScrollBar()->setValue(8 * hourHeight);
+        positioned = true;
+    }
+}
+
+/**
+ * @brief Paints the part of the timeline that needs it.
+ * @param event The paint event; only its rectangle is drawn.
+ */
+void TimelineView::paintEvent(QPaintEvent* event) {
+    const QRect dirty = event->rect();
+    const int offset = verticalScrollBar()->value();
+    const int width = viewport()->width();
+    const QFontMetrics metrics = fontMetrics();
+
+    QPainter painter(viewport());
+    painter.fillRect(dirty, palette().base());
+
+    // hour lines and labels
+    QColor gridColor = palette().mid().color();
+    int firstHour = qMax(0, (dirty.top() + offset - headerHeight) / hourHeight - 1);
+    int lastHour = qMin(24, (dirty.bottom() + offset - headerHeight) / hourHeight + 1);
+    for (int hour = firstHour; hour <= lastHour; hour++) {
+        int y = headerHeight - offset + hour * hourHeight;
+        painter.setPen(gridColor);
+        painter.drawLine(axisWidth, y, width, y);
+        if (hour < 24 && dirty.left() < axisWidth) {
+            painter.setPen(palette().text().color());
+            painter.drawText(QRect(0, y + 2, axisWidth - 6, metrics.height()), Qt::AlignRight | Qt::AlignTop,
+                             QTime(hour, 0).toString("HH:mm"));
+        }
+    }
+    painter.setPen(gridColor);
+    for (int day = 0; day <= dayCount; day++) {
+        int x = columnLeft(day);
+        painter.drawLine(x, dirty.top(), x, dirty.bottom());
+    }
+
+    // events intersecting the dirty rectangle
+    int from = dirty.top() + offset - headerHeight;
+    int to = dirty.bottom() + offset - headerHeight;
+    for (int dayIndex = 0; dayIndex < days.size(); dayIndex++) {
+        if (columnLeft(dayIndex + 1) < dirty.left() || columnLeft(dayIndex) > dirty.right()) continue;
+
+        const Day& day = days[dayIndex];
+        auto it = std::lower_bound(day.items.cbegin(), day.items.cend(), from - day.maxHeight,
+                                   topBefore<Item>);
+        for (; it != day.items.cend() && it->top <= to; ++it) {
+            if (it->bottom < from) continue;
+
+            QRect rect = itemRect(dayIndex, *it);
+            if (!rect.intersects(dirty)) continue;
+
+            painter.fillRect(rect, it->color);
+            painter.setPen(it->color.darker(140));
+            painter.drawRect(rect.adjusted(0, 0, -1, -1));
+
+            if (rect.height() >= metrics.height() && rect.width() > 24) {
+                painter.setPen(it->color.lightness() < 128 ? Qt::white : Qt::black);
+                QRect textRect = rect.adjusted(3, 1, -3, -1);
+                painter.drawText(textRect, Qt::AlignLeft | Qt::AlignTop,
+                                 metrics.elidedText(it->event->getTitle(), Qt::ElideRight, textRect.width()));
+            }
+        }
+    }
+
+    // the day header stays on top while scrolling
+    if (dirty.top() < headerHeight) {
+        painter.fillRect(QRect(0, 0, width, headerHeight), palette().window());
+        painter.setPen(palette().windowText().color());
+        for (int dayIndex = 0; dayIndex < days.size(); dayIndex++) {
+            QRect header(columnLeft(dayIndex), 0, columnLeft(dayIndex + 1) - columnLeft(dayIndex), headerHeight);
+            QString label = QLocale().toString(days[dayIndex].date, "ddd d MMM");
+            painter.drawText(header, Qt::AlignCenter, metrics.elidedText(label, Qt::ElideRight, header.width() - 4));
+        }
+        painter.setPen(gridColor);
+        painter.drawLine(0, headerHeight - 1, width, headerHeight - 1);
+    }
+}
+
+/**
+ * @brief Refits the scroll bar after a resize.
+ * @param event The resize event.
+ */
+void TimelineView::resizeEvent(QResizeEvent* event) {
+    QAbstractScrollArea::resizeEvent(event);
+    updateScrollBar();
+}
+
+/**
+ * @brief Moves the drawn pixels instead of repainting everything.
+ * @param dx Horizontal change, always 0.
+ * @param dy Vertical change in pixels.
+ *
+ * The strip uncovered by the scroll is repainted by Qt; the header, and the rows
+ * it was moved over, are repainted here.
+ */
+void TimelineView::scrollContentsBy(int dx, int dy) {
+    viewport()->scroll(dx, dy);
+    viewport()->update(0, 0, viewport()->width(), headerHeight + qAbs(dy));
+}
+
+/**
+ * @brief Emits eventClicked for the event under the mouse.
+ * @param event The mouse event, in viewport coordinates.
+ */
+void TimelineView::mousePressEvent(QMouseEvent* event) {
+    QPoint position = event->position().toPoint();
+    if (event->button() != Qt::LeftButton || position.y() < headerHeight) return;
+
+    int y = position.y() + verticalScrollBar()->value() - headerHeight;
+    for (int dayIndex = 0; dayIndex < days.size(); dayIndex++) {
+        if (position.x() < columnLeft(dayIndex) || position.x() >= columnLeft(dayIndex + 1)) continue;
+
+        const Day& day = days[dayIndex];
+        auto it = std::lower_bound(day.items.cbegin(), day.items.cend(), y - day.maxHeight, topBefore<Item>);
+        for (; it != day.items.cend() && it->top <= y; ++it) {
+            if (itemRect(dayIndex, *it).contains(position)) {
+                emit eventClicked(it->event, it->isCreated);
+                return;
+            }
+        }
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * @file timelineview.h
+ * @brief Defines the TimelineView class.
+ *
+ * Day and week views that draw events as blocks on a time axis.
+ */
+#ifndef TIMELINEVIEW_H
+#define TIMELINEVIEW_H
+
+#include <QAbstractScrollArea>
+#include <QColor>
+#include <QDate>
+#include <QList>
+#include <memory>
+#include <vector>
+#include "calendar.h"
+#include "event.h"
+
+/**
+ * @class TimelineView
+ * @brief Scrollable timeline of one or more days, painted with QPainter.
+ *
+ * refresh() asks each calendar's interval index for the events overlapping the
+ * shown days and lays them out once: overlapping events share the day's width
+ * in columns. Painting only walks the events intersecting the dirty rectangle,
+ * and scrolling moves the pixels already drawn, so only the uncovered strip is
+ * repainted. The calendar snapshots are held until the next refresh, which keeps
+ * the laid out events alive.
+ */
+class TimelineView : public QAbstractScrollArea {
+    Q_OBJECT
+
+public:
+    /**
+     * @struct Source
+     * @brief A calendar to show and the colour of its events.
+     */
+    struct Source {
+        const Calendar* calendar;
+        QColor color;
+        bool isCreated;
+    };
+
+private:
+    struct Item {
+        int top;     // pixels from midnight
+        int bottom;
+        int column;
+        int columns; // columns of the group of overlapping events it is in
+        QColor color;
+        Event* event;
+        bool isCreated;
+    };
+
+    struct Day {
+        QDate date;
+        QList<Item> items; // sorted by top
+        int maxHeight = 0;
+    };
+
+    static constexpr int hourHeight = 48;
+    static constexpr int headerHeight = 28;
+    static constexpr int axisWidth = 52;
+    static constexpr int minItemHeight = 18;
+
+    int dayCount;
+    QList<Day> days;
+    std::vector<std::shared_ptr<const Calendar::Snapshot>> snapshots;
+    bool positioned = false;
+
+    static void layoutDay(Day& day);
+    int contentHeight() const;
+    int columnLeft(int day) const;
+    QRect itemRect(int day, const Item& item) const;
+    void updateScrollBar();
+
+protected:
+    void paintEvent(QPaintEvent* event) override;
+    void resizeEvent(QResizeEvent* event) override;
+    void scrollContentsBy(int dx, int dy) override;
+    void mousePressEvent(QMouseEvent* event) override;
+
+public:
+    explicit TimelineView(int dayCount, QWidget* parent = nullptr);
+
+    void refresh(const QDate& date, const QList<Source>& sources);
+    QDate getFirstDay() const;
+
+signals:
+    void eventClicked(Event* event, bool isCreatedEvent);
+};
+
+#endif // TIMELINEVIEW_H
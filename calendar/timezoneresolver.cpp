@@ -0,0 +1,395 @@
+/**
+ * @file timezoneresolver.cpp
+ * @brief Implementation of the TimeZoneResolver class
+ */
+#include "timezoneresolver.h"
+#include <QDateTime>
+#include <algorithm>
+#include <utility>
+
+namespace {
+
+// Julian day of 1970-01-01
+constexpr qint64 epochJulianDay = 2440588;
+
+// yearly rules are expanded up to this year
+constexpr int lastExpandedYear = 2100;
+
+/**
+ * @brief Parses a run of decimal digits.
+ * @param text The text to read from.
+ * @param from The first character.
+ * @param count The number of digits.
+ * @param value Receives the number.
+ * @return true if every character was a digit.
+ */
+bool parseDigits(QStringView text, int from, int count, int& value) {
+    if (from + count > text.size()) return false;
+
+    value = 0;
+    for (int i = from; i < from + count; i++) {
+        QChar c = text[i];
+        if (c < QLatin1Char('0') || c > QLatin1Char('9')) return false;
+        value = value * 10 + (c.unicode() - '0');
+    }
+    return true;
+}
+
+/**
+ * @brief Finds the date of the nth weekday of a month.
+ * @param year The year.
+ * @param month The month.
+ * @param nth 1 for the first, -1 for the last, and so on.
+ * @param weekday 1 (Monday) to 7 (Sunday).
+ * @return The date, or an invalid date if the month has no such day.
+ */
+QDate nthWeekdayOfMonth(int year, int month, int nth, int weekday) {
+    if (nth > 0) {
+        QDate first(year, month, 1);
+        int delta = (weekday - first.dayOfWeek() + 7) % 7;
+        QDate date = first.addDays(delta + (nth - 1) * 7);
+        return date.month() == month ? date : QDate();
+    }
+
+    QDate first(year, month, 1);
+    QDate last(year, month, first.daysInMonth());
+    int delta = (last.dayOfWeek() - weekday + 7) % 7;
+    QDate date = last.addDays(-delta - (-nth - 1) * 7);
+    return date.month() == month ? date : QDate();
+}
+
+/**
+ * @brief Parses an RRULE BYDAY entry such as "2SU" or "-1SU".
+ * @param text The entry.
+ * @param nth Receives the ordinal, 1 if omitted.
+ * @param weekday Receives 1 (Monday) to 7 (Sunday).
+ * @return true if the entry was understood.
+ */
+bool parseByDay(QStringView text, int& nth, int& weekday) {
+    static const char* const names[] = {"MO", "TU", "WE", "TH", "FR", "SA", "SU"};
+    if (text.size() < 2) return false;
+
+    weekday = 0;
+    for (int i = 0; i < 7; i++) {
+        if (text.right(2) == QLatin1String(names[i])) {
+            weekday = i + 1;
+        }
+    }
+    if (weekday == 0) return false;
+
+    QStringView ordinal = text.left(text.size() - 2);
+    if (ordinal.isEmpty()) {
+        nth = 1;
+        return true;
+    }
+    bool ok = false;
+    nth = ordinal.toInt(&ok);
+    return ok && nth != 0;
+}
+
+}
+
+/**
+ * @brief Converts a wall-clock date and time to seconds, as if it were UTC.
+ * @param date The date.
+ * @param time The time of day.
+ * @return Seconds since 1970-01-01T00:00:00 on the same wall clock.
+ */
+qint64 TimeZoneResolver::wallClockSeconds(const QDate& date, const QTime& time) {
+    return (date.toJulianDay() - epochJulianDay) * 86400 + time.msecsSinceStartOfDay() / 1000;
+}
+
+/**
+ * @brief Parses an ICS DATE or DATE-TIME value without any regular expression.
+ * @param text "yyyyMMdd", "yyyyMMddTHHmmss" or "yyyyMMddTHHmmssZ".
+ * @param wallSeconds Receives the wall-clock seconds, see wallClockSeconds().
+ * @param isUtc Receives whether the value ends with 'Z'.
+ * @param isDateOnly Receives whether the value has no time part.
+ * @return true if the value was well formed.
+ */
+bool TimeZoneResolver::parseWallClock(QStringView text, qint64& wallSeconds, bool& isUtc, bool& isDateOnly) {
+    int year, month, day;
+    if (!parseDigits(text, 0, 4, year) || !parseDigits(text, 4, 2, month) || !parseDigits(text, 6, 2, day)) {
+        return false;
+    }
+    QDate date(year, month, day);
+    if (!date.isValid()) return false;
+
+    QTime time(0, 0);
+    isUtc = false;
+    isDateOnly = true;
+    if (text.size() > 8 && text[8] == QLatin1Char('T')) {
+        int hour, minute, second;
+        if (!parseDigits(text, 9, 2, hour) || !parseDigits(text, 11, 2, minute) || !parseDigits(text, 13, 2, second)) {
+            return false;
+        }
+        // a leap second is kept on the last second of the minute
+        time = QTime(hour, minute, qMin(second, 59));
+        if (!time.isValid()) return false;
+
+        isDateOnly = false;
+        isUtc = text.size() > 15 && text[15] == QLatin1Char('Z');
+    }
+
+    wallSeconds = wallClockSeconds(date, time);
+    return true;
+}
+
+/**
+ * @brief Parses a UTC offset such as "-0500" or "+053000".
+ * @param text The offset.
+ * @param offsetSeconds Receives the offset in seconds.
+ * @return true if the offset was well formed.
+ */
+bool TimeZoneResolver::parseUtcOffset(QStringView text, int& offsetSeconds) {
+    if (text.size() < 5 || (text[0] != QLatin1Char('+') && text[0] != QLatin1Char('-'))) return false;
+
+    int hours, minutes, seconds = 0;
+    if (!parseDigits(text, 1, 2, hours) || !parseDigits(text, 3, 2, minutes)) return false;
+    if (text.size() >= 7 && !parseDigits(text, 5, 2, seconds)) return false;
+
+    offsetSeconds = hours * 3600 + minutes * 60 + seconds;
+    if (text[0] == QLatin1Char('-')) {
+        offsetSeconds = -offsetSeconds;
+    }
+    return true;
+}
+
+/**
+ * @brief Builds the transition table of a VTIMEZONE block.
+ * @param lines The lines of the block, from BEGIN:VTIMEZONE to END:VTIMEZONE.
+ *
+ * STANDARD and DAYLIGHT observances are expanded from their DTSTART, RDATEs and
+ * yearly RRULE (BYMONTH with BYDAY or BYMONTHDAY, UNTIL and COUNT).
+ */
+void TimeZoneResolver::addVTimeZone(const QStringList& lines) {
+    QString tzid;
+    QList<std::pair<qint64, int>> transitions; // utc start, offset after
+    qint64 earliestUtc = 0;
+    int earliestOffsetFrom = 0;
+
+    bool inObservance = false;
+    qint64 dtstart = 0;
+    bool hasDtstart = false;
+    int offsetFrom = 0;
+    int offsetTo = 0;
+    QString rrule;
+    QList<qint64> rdates;
+
+    for (const QString& rawLine : lines) {
+        QStringView line = QStringView(rawLine).trimmed();
+
+        if (line.startsWith(QLatin1String("TZID:"))) {
+            tzid = line.mid(5).toString();
+        }
+        else if (line == QLatin1String("BEGIN:STANDARD") || line == QLatin1String("BEGIN:DAYLIGHT")) {
+            inObservance = true;
+            hasDtstart = false;
+            offsetFrom = offsetTo = 0;
+            rrule.clear();
+            rdates.clear();
+        }
+        else if (inObservance && line.startsWith(QLatin1String("DTSTART:"))) {
+            bool isUtc, isDateOnly;
+            hasDtstart = parseWallClock(line.mid(8), dtstart, isUtc, isDateOnly);
+        }
+        else if (inObservance && line.startsWith(QLatin1String("TZOFFSETFROM:"))) {
+            parseUtcOffset(line.mid(13), offsetFrom);
+        }
+        else if (inObservance && line.startsWith(QLatin1String("TZOFFSETTO:"))) {
+            parseUtcOffset(line.mid(11), offsetTo);
+        }
+        else if (inObservance && line.startsWith(QLatin1String("RRULE:"))) {
+            rrule = line.mid(6).toString();
+        }
+        else if (inObservance && line.startsWith(QLatin1String("RDATE:"))) {
+            for (QStringView value : line.mid(6).split(QLatin1Char(','))) {
+                qint64 wall;
+                bool isUtc, isDateOnly;
+                if (parseWallClock(value, wall, isUtc, isDateOnly)) {
+                    rdates.append(wall);
+                }
+            }
+        }
+        else if (inObservance && (line == QLatin1String("END:STANDARD") || line == QLatin1String("END:DAYLIGHT"))) {
+            inObservance = false;
+            if (!hasDtstart) continue;
+
+            QList<qint64> occurrences = rdates;
+            occurrences.append(dtstart);
+
+            // expand the yearly rule
+            int byMonth = 0, byMonthDay = 0, nth = 0, weekday = 0, count = 0;
+            qint64 until = 0;
+            bool yearly = false, hasUntil = false;
+            for (QStringView part : QStringView(rrule).split(QLatin1Char(';'))) {
+                if (part == QLatin1String("FREQ=YEARLY")) yearly = true;
+                else if (part.startsWith(QLatin1String("BYMONTH="))) byMonth = part.mid(8).toInt();
+                else if (part.startsWith(QLatin1String("BYMONTHDAY="))) byMonthDay = part.mid(11).toInt();
+                else if (part.startsWith(QLatin1String("BYDAY="))) parseByDay(part.mid(6), nth, weekday);
+                else if (part.startsWith(QLatin1String("COUNT="))) count = part.mid(6).toInt();
+                else if (part.startsWith(QLatin1String("UNTIL="))) {
+                    bool isUtc, isDateOnly;
+                    hasUntil = parseWallClock(part.mid(6), until, isUtc, isDateOnly);
+                    if (hasUntil && !isUtc) until -= offsetFrom;
+                }
+            }
+
+            if (yearly) {
+                QDateTime first = QDateTime::fromSecsSinceEpoch(dtstart, QTimeZone::UTC);
+                QTime timeOfDay = first.time();
+                int month = byMonth > 0 ? byMonth : first.date().month();
+                int generated = 1;
+
+                for (int year = first.date().year() + 1; year <= lastExpandedYear; year++) {
+                    if (count > 0 && generated >= count) break;
+
+                    QDate date;
+                    if (weekday > 0) {
+                        date = nthWeekdayOfMonth(year, month, nth, weekday);
+                    } else {
+                        date = QDate(year, month, byMonthDay > 0 ? byMonthDay : first.date().day());
+                    }
+                    if (!date.isValid()) continue;
+
+                    qint64 wall = wallClockSeconds(date, timeOfDay);
+                    if (hasUntil && wall - offsetFrom > until) break;
+
+                    occurrences.append(wall);
+                    generated++;
+                }
+            }
+
+            for (qint64 wall : occurrences) {
+                qint64 utc = wall - offsetFrom;
+                if (transitions.isEmpty() || utc < earliestUtc) {
+                    earliestUtc = utc;
+                    earliestOffsetFrom = offsetFrom;
+                }
+                transitions.append({utc, offsetTo});
+            }
+        }
+    }
+
+    if (tzid.isEmpty() || transitions.isEmpty()) return;
+
+    std::sort(transitions.begin(), transitions.end());
+
+    TransitionTable table;
+    table.initialOffset = earliestOffsetFrom;
+    for (const auto& transition : transitions) {
+        table.utcStarts.append(transition.first);
+        table.offsets.append(transition.second);
+    }
+    finishTable(table);
+
+    tables.insert(tzid, table);
+    lastTzid.clear();
+    lastTable = nullptr;
+}
+
+/**
+ * @brief Builds a transition table from the system time zone database.
+ * @param zone The zone.
+ * @return The table, invalid if the zone is.
+ */
+TimeZoneResolver::TransitionTable TimeZoneResolver::fromQTimeZone(const QTimeZone& zone) {
+    TransitionTable table;
+    if (!zone.isValid()) return table;
+
+    QDateTime from(QDate(1970, 1, 1), QTime(0, 0), QTimeZone::UTC);
+    QDateTime to(QDate(lastExpandedYear, 12, 31), QTime(23, 59), QTimeZone::UTC);
+
+    table.initialOffset = zone.offsetFromUtc(from);
+    const QTimeZone::OffsetDataList transitions = zone.transitions(from, to);
+    for (const QTimeZone::OffsetData& transition : transitions) {
+        table.utcStarts.append(transition.atUtc.toSecsSinceEpoch());
+        table.offsets.append(transition.offsetFromUtc);
+    }
+    finishTable(table);
+    return table;
+}
+
+/**
+ * @brief Fills in the wall-clock start of each transition and marks the table valid.
+ * @param table The table to finish.
+ */
+void TimeZoneResolver::finishTable(TransitionTable& table) {
+    table.localStarts.reserve(table.utcStarts.size());
+    for (int i = 0; i < table.utcStarts.size(); i++) {
+        table.localStarts.append(table.utcStarts[i] + table.offsets[i]);
+    }
+    table.valid = true;
+}
+
+/**
+ * @brief Gets the transition table of a TZID, building and caching it on first use.
+ * @param tzid The TZID parameter value.
+ * @return The table, or nullptr if the TZID is unknown.
+ */
+const TimeZoneResolver::TransitionTable* TimeZoneResolver::table(QStringView tzid) {
+    // most feeds use a single TZID, so skip the copy and hash lookup on repeats
+    if (lastTable && tzid == lastTzid) return lastTable->valid ? lastTable : nullptr;
+
+    QString key = tzid.toString();
+    auto it = tables.find(key);
+    if (it == tables.end()) {
+        QTimeZone zone(key.toUtf8());
+        if (!zone.isValid()) {
+            QByteArray ianaId = QTimeZone::windowsIdToDefaultIanaId(key.toUtf8());
+            if (!ianaId.isEmpty()) {
+                zone = QTimeZone(ianaId);
+            }
+        }
+        it = tables.insert(key, fromQTimeZone(zone));
+    }
+
+    lastTzid = key;
+    lastTable = &it.value();
+    return it->valid ? lastTable : nullptr;
+}
+
+/**
+ * @brief Converts a wall-clock time in a zone to UTC.
+ * @param tzid The TZID parameter value.
+ * @param wallSeconds The wall-clock time, see wallClockSeconds().
+ * @param utcSeconds Receives the UTC epoch seconds.
+ * @return false if the TZID could not be resolved.
+ *
+ * Times in a DST gap use the offset before the gap, and ambiguous times
+ * resolve to their first occurrence, as RFC 5545 requires.
+ */
+bool TimeZoneResolver::toUtc(QStringView tzid, qint64 wallSeconds, qint64& utcSeconds) {
+    const TransitionTable* zone = table(tzid);
+    if (!zone) return false;
+
+    auto it = std::upper_bound(zone->localStarts.cbegin(), zone->localStarts.cend(), wallSeconds);
+    int index = int(it - zone->localStarts.cbegin()) - 1;
+
+    int offset = index >= 0 ? zone->offsets[index] : zone->initialOffset;
+    if (index >= 0) {
+        // in a fall-back overlap the earlier offset still applies
+        int previous = index > 0 ? zone->offsets[index - 1] : zone->initialOffset;
+        if (wallSeconds - previous < zone->utcStarts[index]) {
+            offset = previous;
+        }
+    }
+
+    utcSeconds = wallSeconds - offset;
+    return true;
+}
+
+/**
+ * @brief Gets the UTC offset of a zone at an instant.
+ * @param tzid The TZID parameter value.
+ * @param utcSeconds The instant.
+ * @return The offset in seconds, 0 if the TZID could not be resolved.
+ */
+int TimeZoneResolver::offsetAtUtc(QStringView tzid, qint64 utcSeconds) {
+    const TransitionTable* zone = table(tzid);
+    if (!zone) return 0;
+
+    auto it = std::upper_bound(zone->utcStarts.cbegin(), zone->utcStarts.cend(), utcSeconds);
+    int index = int(it - zone->utcStarts.cbegin()) - 1;
+    return index >= 0 ? zone->offsets[index] : zone->initialOffset;
+}
@@ -0,0 +1,58 @@
+/**
+ * @file timezoneresolver.h
+ * @brief Defines the TimeZoneResolver class.
+ *
+ * Converts ICS wall-clock times with a TZID into UTC epoch seconds.
+ */
+#ifndef TIMEZONERESOLVER_H
+#define TIMEZONERESOLVER_H
+
+#include <QDate>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QTime>
+#include <QTimeZone>
+
+/**
+ * @class TimeZoneResolver
+ * @brief Resolves TZIDs through cached UTC offset transition tables.
+ *
+ * A table is built once per TZID, from the feed's VTIMEZONE block when it has one
+ * and from QTimeZone otherwise. Each lookup is a binary search over the table.
+ * The resolver is not thread-safe; use one per import.
+ */
+class TimeZoneResolver {
+private:
+    struct TransitionTable {
+        QList<qint64> utcStarts;   // instant each offset starts at
+        QList<qint64> localStarts; // wall-clock time right after each transition
+        QList<int> offsets;        // offset in effect from utcStarts[i]
+        int initialOffset = 0;     // offset before the first transition
+        bool valid = false;
+    };
+
+    QHash<QString, TransitionTable> tables;
+    QString lastTzid;
+    const TransitionTable* lastTable = nullptr; // points into tables, so copies are not allowed
+
+    const TransitionTable* table(QStringView tzid);
+    static TransitionTable fromQTimeZone(const QTimeZone& zone);
+    static void finishTable(TransitionTable& table);
+
+public:
+    TimeZoneResolver() = default;
+    TimeZoneResolver(const TimeZoneResolver&) = delete;
+    TimeZoneResolver& operator=(const TimeZoneResolver&) = delete;
+
+    void addVTimeZone(const QStringList& lines);
+    bool toUtc(QStringView tzid, qint64 wallSeconds, qint64& utcSeconds);
+    int offsetAtUtc(QStringView tzid, qint64 utcSeconds);
+
+    static qint64 wallClockSeconds(const QDate& date, const QTime& time);
+    static bool parseWallClock(QStringView text, qint64& wallSeconds, bool& isUtc, bool& isDateOnly);
+    static bool parseUtcOffset(QStringView text, int& offsetSeconds);
+};
+
+#endif // TIMEZONERESOLVER_H
@@ -0,0 +1,162 @@
+/**
+ * @file trace.cpp
+ * @brief Implementation of the Tracer class
+ */
+#include "trace.h"
+#include <QCoreApplication>
+#include <QFile>
+#include <QMutex>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace {
+
+constexpr quint64 ringSize = 1 << 16;
+
+struct TraceRecord {
+    const char* name;
+    qint64 startNs;
+    qint64 durationNs;
+};
+
+/**
+ * One thread's scopes. Only the owning thread writes records; head is
+ * published with release so a reader sees every record below it.
+ */
+struct TraceRing {
+    int threadID = 0;
+    std::atomic<quint64> head{0};
+    TraceRecord records[ringSize];
+};
+
+// rings outlive their threads so scopes of finished threads still get written
+QMutex ringsMutex;
+std::vector<std::unique_ptr<TraceRing>> rings;
+thread_local TraceRing* localRing = nullptr;
+
+QString outputPath;
+const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+
+TraceRing* registerRing() {
+    QMutexLocker locker(&ringsMutex);
+    rings.push_back(std::make_unique<TraceRing>());
+    rings.back()->threadID = int(rings.size());
+    return rings.back().get();
+}
+
+void appendJsonString(QByteArray& out, const char* text) {
+    out += '"';
+    for (const char* c = text; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            out += '\\';
+        }
+        out += *c;
+    }
+    out += '"';
+}
+
+}
+
+std::atomic<bool> Tracer::enabled{false};
+
+/**
+ * @brief Turns tracing on when ALIGNIFY_TRACE asks for it.
+ *
+ * Call once at startup, before any traced work.
+ */
+void Tracer::start() {
+    QString setting = qEnvironmentVariable("ALIGNIFY_TRACE");
+    if (setting.isEmpty() || setting == "0") return;
+
+    outputPath = setting == "1" ? QString("alignify-trace.json") : setting;
+    enabled.store(true, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Stops tracing and writes the trace file started by start().
+ */
+void Tracer::finish() {
+    if (!isEnabled()) return;
+
+    enabled.store(false, std::memory_order_relaxed);
+    if (!writeChromeTrace(outputPath)) {
+        qWarning("Cannot write trace to %s", qPrintable(outputPath));
+    }
+}
+
+/**
+ * @brief Writes every recorded scope as Chrome trace JSON.
+ * @param path The output file.
+ * @return true on success.
+ *
+ * Scopes are written as complete ("X") events with microsecond timestamps.
+ * Threads still recording while this runs may have their newest scopes cut.
+ */
+bool Tracer::writeChromeTrace(const QString& path) {
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) return false;
+
+    QByteArray out("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    out += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":";
+    appendJsonString(out, qPrintable(QCoreApplication::applicationName().isEmpty() ? QString("Alignify")
+                                                                                   : QCoreApplication::applicationName()));
+    out += "}}";
+
+    QMutexLocker locker(&ringsMutex);
+    for (const std::unique_ptr<TraceRing>& ring : rings) {
+        quint64 head = ring->head.load(std::memory_order_acquire);
+        quint64 first = head > ringSize ? head - ringSize : 0;
+        for (quint64 i = first; i < head; i++) {
+            const TraceRecord& record = ring->records[i & (ringSize - 1)];
+            out += ",\n{\"name\":";
+            appendJsonString(out, record.name);
+            out += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + QByteArray::number(ring->threadID);
+            out += ",\"ts\":" + QByteArray::number(record.startNs / 1000.0, 'f', 3);
+            out += ",\"dur\":" + QByteArray::number(record.durationNs / 1000.0, 'f', 3) + "}";
+
+            // keep memory flat for large traces
+            if (out.size() > (1 << 20)) {
+                file.write(out);
+                out.clear();
+            }
+        }
+    }
+    out += "\n]}\n";
+    file.write(out);
+    return file.error() == QFileDevice::NoError;
+}
+
+/**
+ * @brief Gets the trace clock.
+ * @return Nanoseconds since the process started.
+ */
+qint64 Tracer::now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+}
+
+/**
+ * @brief Appends a finished scope to the calling thread's ring.
+ * @param name The scope name.
+ * @param startNs When the scope started.
+ * @param endNs When the scope ended.
+ */
+void Tracer::record(const char* name, qint64 startNs, qint64 endNs) {
+    TraceRing* ring = localRing;
+    if (!ring) {
+        ring = localRing = registerRing();
+    }
+
+    quint64 head = ring->head.load(std::memory_order_relaxed);
+    ring->records[head & (ringSize - 1)] = {name, startNs, endNs - startNs};
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+/**
+ * @brief Gets the memory held by the ring buffers.
+ * @return The bytes of every ring created so far.
+ */
+qint64 Tracer::memoryUsage() {
+    QMutexLocker locker(&ringsMutex);
+    return qint64(rings.size()) * qint64(sizeof(TraceRing));
+}
@@ -0,0 +1,80 @@
+/**
+ * @file trace.h
+ * @brief Defines the Tracer class and the TRACE_SCOPE macro.
+ *
+ * Records how long hot paths take and exports them as Chrome trace JSON,
+ * which chrome://tracing and ui.perfetto.dev open directly.
+ */
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <atomic>
+
+/**
+ * @class Tracer
+ * @brief Collects trace scopes into per-thread ring buffers.
+ *
+ * Tracing is off unless the ALIGNIFY_TRACE environment variable is set, either
+ * to 1 (written to alignify-trace.json) or to the output path. Each thread writes
+ * only its own ring, so recording takes no lock. A ring keeps the latest 65536
+ * scopes of its thread.
+ */
+class Tracer {
+private:
+    static std::atomic<bool> enabled;
+
+public:
+    static void start();
+    static void finish();
+    static bool writeChromeTrace(const QString& path);
+
+    /**
+     * @brief Checks whether scopes are being recorded.
+     * @return true when tracing is on.
+     */
+    static bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    static qint64 now();
+    static void record(const char* name, qint64 startNs, qint64 endNs);
+    static qint64 memoryUsage();
+};
+
+/**
+ * @class TraceScope
+ * @brief Records the time between its construction and destruction.
+ *
+ * When tracing is off this costs one relaxed load and a branch.
+ */
+class TraceScope {
+private:
+    const char* name;
+    qint64 startNs;
+
+public:
+    /**
+     * @param name The scope name; must be a string literal or otherwise outlive the process.
+     */
+    explicit TraceScope(const char* name)
+        : name(name), startNs(Tracer::isEnabled() ? Tracer::now() : -1) {}
+
+    ~TraceScope() {
+        if (startNs >= 0) {
+            Tracer::record(name, startNs, Tracer::now());
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+#ifdef ALIGNIFY_NO_TRACE
+#define TRACE_SCOPE(name) do {} while (false)
+#else
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+#endif
+
+#endif // TRACE_H
@@ -0,0 +1,133 @@
+/**
+ * @file undohistory.cpp
+ * @brief Implementation of the UndoHistory class
+ */
+#include "undohistory.h"
+#include "trace.h"
+
+/**
+ * @brief Gets the months whose events undo or redo looks up in a calendar.
+ * @return The first day of each month; none by default.
+ */
+QList<QDate> UndoCommand::months() const {
+    return {};
+}
+
+/**
+ * @brief Constructs an empty history.
+ * @param limit The most commands kept; at least one.
+ */
+UndoHistory::UndoHistory(size_t limit) : limit(limit > 0 ? limit : 1) {}
+
+/**
+ * @brief Destroys the history, oldest command first.
+ *
+ * A done command may free objects that earlier commands still point into, such
+ * as the calendar of a deleted user, so it has to go after them.
+ */
+UndoHistory::~UndoHistory() {
+    clear();
+}
+
+/**
+ * @brief Destroys the undone commands.
+ *
+ * Undone commands hold only objects that are out of every calendar, so any order works.
+ */
+void UndoHistory::dropUndone() {
+    commands.erase(commands.begin() + position, commands.end());
+}
+
+/**
+ * @brief Records a command that was just done.
+ * @param command The command.
+ */
+void UndoHistory::record(std::unique_ptr<UndoCommand> command) {
+    if (!command) return;
+
+    dropUndone();
+    if (commands.size() == limit) {
+        commands.erase(commands.begin());
+    }
+    commands.push_back(std::move(command));
+    position = commands.size();
+}
+
+/**
+ * @brief Checks whether there is a command to undo.
+ * @return true if undo() would do something.
+ */
+bool UndoHistory::canUndo() const {
+    return position > 0;
+}
+
+/**
+ * @brief Checks whether there is a command to redo.
+ * @return true if redo() would do something.
+ */
+bool UndoHistory::canRedo() const {
+    return position < commands.size();
+}
+
+/**
+ * @brief Gets the description of the command undo() would undo.
+ * @return The text, or an empty string.
+ */
+QString UndoHistory::undoText() const {
+    return canUndo() ? commands[position - 1]->text() : QString();
+}
+
+/**
+ * @brief Gets the description of the command redo() would redo.
+ * @return The text, or an empty string.
+ */
+QString UndoHistory::redoText() const {
+    return canRedo() ? commands[position]->text() : QString();
+}
+
+/**
+ * @brief Undoes the newest done command.
+ */
+void UndoHistory::undo() {
+    TRACE_SCOPE("UndoHistory::undo");
+    if (!canUndo()) return;
+
+    position--;
+    commands[position]->undo();
+}
+
+/**
+ * @brief Redoes the oldest undone command.
+ */
+void UndoHistory::redo() {
+    TRACE_SCOPE("UndoHistory::redo");
+    if (!canRedo()) return;
+
+    commands[position]->redo();
+    position++;
+}
+
+/**
+ * @brief Destroys every command, oldest first.
+ */
+void UndoHistory::clear() {
+    for (std::unique_ptr<UndoCommand>& command : commands) {
+        command.reset();
+    }
+    commands.clear();
+    position = 0;
+}
+
+/**
+ * @brief Gets the months any kept command may still look up.
+ * @return The first day of each month, done and undone commands alike.
+ */
+QSet<QDate> UndoHistory::months() const {
+    QSet<QDate> result;
+    for (const std::unique_ptr<UndoCommand>& command : commands) {
+        for (const QDate& month : command->months()) {
+            result.insert(month);
+        }
+    }
+    return result;
+}
@@ -0,0 +1,67 @@
+/**
+ * @file undohistory.h
+ * @brief Defines the UndoCommand and UndoHistory classes.
+ *
+ * Undo and redo for actions that keep what they removed instead of copying it.
+ */
+#ifndef UNDOHISTORY_H
+#define UNDOHISTORY_H
+
+#include <QDate>
+#include <QList>
+#include <QSet>
+#include <QString>
+#include <memory>
+#include <vector>
+
+/**
+ * @class UndoCommand
+ * @brief Abstract class for an action that can be undone and redone.
+ *
+ * A command is recorded after it was done. It keeps the objects its undone or
+ * done side detached, not copies of them, and frees whichever side is detached
+ * when it is destroyed.
+ */
+class UndoCommand {
+public:
+    virtual ~UndoCommand() = default;
+
+    virtual QString text() const = 0;
+    virtual void undo() = 0;
+    virtual void redo() = 0;
+    virtual QList<QDate> months() const;
+};
+
+/**
+ * @class UndoHistory
+ * @brief Bounded list of commands with a position between done and undone ones.
+ *
+ * Recording a command drops the ones undone before it, and the oldest one once
+ * the limit is reached.
+ */
+class UndoHistory {
+private:
+    std::vector<std::unique_ptr<UndoCommand>> commands;
+    size_t position = 0; // commands before it are done, from it on undone
+    size_t limit;
+
+    void dropUndone();
+
+public:
+    explicit UndoHistory(size_t limit = 100);
+    ~UndoHistory();
+    UndoHistory(const UndoHistory&) = delete;
+    UndoHistory& operator=(const UndoHistory&) = delete;
+
+    void record(std::unique_ptr<UndoCommand> command);
+    bool canUndo() const;
+    bool canRedo() const;
+    QString undoText() const;
+    QString redoText() const;
+    void undo();
+    void redo();
+    void clear();
+    QSet<QDate> months() const;
+};
+
+#endif // UNDOHISTORY_H
@@ -13,7 +13,7 @@
  * @param firstName The first name of the user.
  * @param lastName The last name of the user.
  */
-User::User(int id, const QString& firstName, const QString& lastName)
+User::User(qint64 id, const QString& firstName, const QString& lastName)
     : Person(id, firstName, lastName) {}
 
 
@@ -22,7 +22,7 @@ private:
 
 
 public:
-    User(int id, const QString& firstName, const QString& lastName);
+    User(qint64 id, const QString& firstName, const QString& lastName);
 
 };
 
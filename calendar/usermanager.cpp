@@ -4,48 +4,85 @@
  * Implements Singleton pattern for managing users and their unique IDs and colours.
  */
 #include "usermanager.h"
-
-// initialization
-UserManager* UserManager::instance = nullptr;
+#include "idallocator.h"
 
 /**
- * @brief Initializes the user ID counter to 1.
+ * @brief Constructs a UserManager object with no users.
  */
-UserManager::UserManager() : nextUserID(1) {}
+UserManager::UserManager()
+    : state(std::make_shared<Snapshot>(Snapshot{QMap<qint64, User*>(), QMap<qint64, QColor>(), std::make_shared<RetireEpoch>()})),
+      colorIndex(0) {}
 
 /**
  * @brief Gets Singleton instance of UserManager
  *
+ * Initialization is thread-safe.
+ *
  * @return A pointer to the singleton UserManager instance.
  */
 UserManager* UserManager:: getInstance() {
-    if (instance == nullptr) {
-        instance = new UserManager();
-    }
+    static UserManager* instance = new UserManager();
     return instance;
 }
 
 /**
  * @brief Creates new user with unique ID and assigns a colour.
  *
+ * IDs come from the IdAllocator, so they never clash with restored users or localUserID.
+ *
  * @param firstName The first name of the user.
  * @param lastName The last name of the user.
  * @return A pointer to newly created User object.
  */
 User* UserManager::createUser(const QString& firstName, const QString& lastName) {
-    User* newUser = new User(nextUserID, firstName, lastName);
-    users[nextUserID] = newUser;
-    assignUserColor(nextUserID);
-    nextUserID++;
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+
+    qint64 userID = IdAllocator::next(IdAllocator::Users);
+    User* newUser = new User(userID, firstName, lastName);
+    QMap<qint64, User*> users = current->users;
+    QMap<qint64, QColor> userColors = current->userColors;
+    users[userID] = newUser;
+    userColors[userID] = nextUserColor();
+
+    state.publish(std::make_shared<Snapshot>(Snapshot{std::move(users), std::move(userColors), current->epoch->advance()}));
     return newUser;
 }
+/**
+ * @brief Recreates a saved user with its original ID and colour.
+ *
+ * Later users get IDs above every restored one.
+ *
+ * @param id The unique ID the user had.
+ * @param firstName The first name of the user.
+ * @param lastName The last name of the user.
+ * @param color The colour the user had.
+ * @return A pointer to the restored User object.
+ */
+User* UserManager::restoreUser(qint64 id, const QString& firstName, const QString& lastName, const QColor& color) {
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+
+    User* restoredUser = new User(id, firstName, lastName);
+    QMap<qint64, User*> users = current->users;
+    QMap<qint64, QColor> userColors = current->userColors;
+    current->epoch->retire(users.value(id, nullptr));
+    users[id] = restoredUser;
+    userColors[id] = color;
+    IdAllocator::reserve(IdAllocator::Users, id);
+    colorIndex++;
+
+    state.publish(std::make_shared<Snapshot>(Snapshot{std::move(users), std::move(userColors), current->epoch->advance()}));
+    return restoredUser;
+}
+
 /**
  * @brief Gets user by unique ID
  * @param id The unique ID of user.
  * @return A pointer to the User object if found, or nullptr if not.
  */
-User* UserManager::getUser(int id) {
-    return users.value(id, nullptr);
+User* UserManager::getUser(qint64 id) {
+    return state.load()->users.value(id, nullptr);
 }
 /**
  * @brief Gets the colour associated with a user.
@@ -53,25 +90,35 @@ User* UserManager::getUser(int id) {
  * @param id The unique ID of the user.
  * @return The colour assigned to the user.
  */
-QColor UserManager::getUserColor(int id) {
-    return userColors.value(id);
+QColor UserManager::getUserColor(qint64 id) {
+    return state.load()->userColors.value(id);
 }
 
 /**
  * @brief Gets all the users managed by UserManager
  *
  * @return A Map containing all users, indexed by their unique IDs.
+ * @note Worker threads should hold snapshot() instead, which keeps the users alive.
  */
-QMap<int, User*> UserManager::getAllUsers() const {
-    return users;
+QMap<qint64, User*> UserManager::getAllUsers() const {
+    return state.load()->users;
 }
 
 /**
- * @brief Assigns unique colour to user.
+ * @brief Gets the current immutable version of the users and colours.
+ * @return A snapshot whose users stay alive for as long as it is held.
+ */
+std::shared_ptr<const UserManager::Snapshot> UserManager::snapshot() const {
+    return state.load();
+}
+
+/**
+ * @brief Picks the colour for the next user.
  *
- * @param userID The unique ID of the user
+ * @return The next colour of the palette.
+ * @note Must be called with writeMutex held.
  */
-void UserManager::assignUserColor(int userID) {
+QColor UserManager::nextUserColor() {
     static const QVector<QColor> colors = {
         QColor(251, 248, 204), // Yellow
         QColor(253, 228, 207), // beige pink
@@ -84,20 +131,66 @@ void UserManager::assignUserColor(int userID) {
         QColor(152, 245, 225), // sea green
         QColor(185, 251, 192)  // green
     };
-    static int colorIndex = 0;
-    userColors[userID] = colors[colorIndex % colors.size()];
+    QColor color = colors[colorIndex % colors.size()];
     colorIndex++;
+    return color;
 }
 
 /**
  * @brief Deletes a user by their unique ID.
  *
+ * The user is freed once no snapshot refers to it anymore.
+ *
  * @param userID The unique ID of the user to be deleted.
  */
-void UserManager::deleteUser(int userID){
-    if (users.contains(userID)) {
-        User* user = users[userID];
-        users.remove(userID);
-        delete user;
+void UserManager::deleteUser(qint64 userID){
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    if (current->users.contains(userID)) {
+        QMap<qint64, User*> users = current->users;
+        current->epoch->retire(users.take(userID));
+        state.publish(std::make_shared<Snapshot>(Snapshot{std::move(users), current->userColors, current->epoch->advance()}));
     }
 }
+
+/**
+ * @brief Takes a user out of the manager without deleting it.
+ * @param userID The ID of the user.
+ * @return The user, now owned by the caller, or nullptr if there is none.
+ *
+ * The colour is kept, so attachUser() brings the user back unchanged.
+ */
+User* UserManager::detachUser(qint64 userID) {
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    if (!current->users.contains(userID)) return nullptr;
+
+    QMap<qint64, User*> users = current->users;
+    User* user = users.take(userID);
+    state.publish(std::make_shared<Snapshot>(Snapshot{std::move(users), current->userColors, current->epoch->advance()}));
+    return user;
+}
+
+/**
+ * @brief Puts a detached user back under their ID.
+ * @param user The user; the manager owns it again.
+ */
+void UserManager::attachUser(User* user) {
+    if (!user) return;
+
+    QMutexLocker locker(&writeMutex);
+    std::shared_ptr<const Snapshot> current = state.load();
+    QMap<qint64, User*> users = current->users;
+    current->epoch->retire(users.value(user->getPersonID(), nullptr));
+    users[user->getPersonID()] = user;
+    state.publish(std::make_shared<Snapshot>(Snapshot{std::move(users), current->userColors, current->epoch->advance()}));
+}
+
+/**
+ * @brief Deletes a detached user once no snapshot can refer to them anymore.
+ * @param user The detached user.
+ */
+void UserManager::discardUser(User* user) {
+    QMutexLocker locker(&writeMutex);
+    state.load()->epoch->retire(user);
+}
@@ -10,36 +10,57 @@
 #include <QMap>
 #include <QColor>
 #include <QVector>
+#include <QMutex>
 #include "user.h"
+#include "snapshot.h"
 
 /**
  * @class UserManager
  * @brief Manages users and their unique IDs and colours.
  * 
  * The UserManager class is responsible for creating, storing, and managing User objects.
+ * Users and colours are published as immutable snapshots, so any thread may read them without locking.
  */
 class UserManager {
+public:
+    /**
+     * @struct Snapshot
+     * @brief Immutable view of all users and their colours at one point in time.
+     */
+    struct Snapshot {
+        QMap<qint64, User*> users;
+        QMap<qint64, QColor> userColors;
+        std::shared_ptr<RetireEpoch> epoch;
+    };
+
 private:
-    static UserManager* instance;
-    QMap<int, User*> users;
-    QMap<int, QColor> userColors;
-    int nextUserID;
+    SnapshotCell<Snapshot> state;
+    QMutex writeMutex;
+    int colorIndex;
 
     UserManager();
 
 public:
+    // ID of the person using the app, who owns the created events; never allocated
+    static constexpr qint64 localUserID = 0;
+
     static UserManager* getInstance();
     UserManager(const UserManager&) = delete;
     UserManager& operator=(const UserManager&) = delete;
 
     User* createUser(const QString& firstName, const QString& lastName);
-    User* getUser(int id);
-    QColor getUserColor(int id);
-    QMap<int, User*> getAllUsers() const;
-    void deleteUser(int userID);
+    User* restoreUser(qint64 id, const QString& firstName, const QString& lastName, const QColor& color);
+    User* getUser(qint64 id);
+    QColor getUserColor(qint64 id);
+    QMap<qint64, User*> getAllUsers() const;
+    std::shared_ptr<const Snapshot> snapshot() const;
+    void deleteUser(qint64 userID);
+    User* detachUser(qint64 userID);
+    void attachUser(User* user);
+    void discardUser(User* user);
 
 private:
-    void assignUserColor(int userID);
+    QColor nextUserColor();
 };
 
 #endif // USERMANAGER_H
@@ -0,0 +1,152 @@
+/**
+ * @file icsfuzz.cpp
+ * @brief Fuzz target for the ICS lexer, parser and writer.
+ *
+ * Feeds arbitrary bytes through IcsLexer and IcsParser, then exports the
+ * parsed events with IcsWriter and parses them again. Crashes, sanitizer
+ * reports and broken round trips all count as findings.
+ */
+#include "event.h"
+#include "icslexer.h"
+#include "icsparser.h"
+#include "icswriter.h"
+#include "timezoneresolver.h"
+#include <QBuffer>
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <cstdint>
+#include <cstdio>
+
+namespace {
+
+// the range IcsWriter can write and IcsParser can read back, years 1 to 9999
+constexpr qint64 firstWritableUtc = -62135596800LL;
+constexpr qint64 lastWritableUtc = 253402300799LL;
+
+#define FUZZ_CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            std::fprintf(stderr, "icsfuzz: check failed: %s (%s:%d)\n", #condition, __FILE__, __LINE__); \
+            std::abort(); \
+        } \
+    } while (false)
+
+void lexEverything(QStringView content) {
+    IcsLexer lexer(content);
+    IcsContentLine line;
+    qsizetype lastPosition = 0;
+    while (lexer.next(line)) {
+        FUZZ_CHECK(lexer.getPosition() > lastPosition);
+        FUZZ_CHECK(lexer.getPosition() <= content.size());
+        lastPosition = lexer.getPosition();
+
+        FUZZ_CHECK(!line.name.isEmpty());
+        line.text();
+        line.parameter(QLatin1String("TZID"));
+        line.isBegin(QLatin1String("VEVENT"));
+
+        qint64 seconds;
+        bool isUtc, isDateOnly;
+        TimeZoneResolver::parseWallClock(line.value, seconds, isUtc, isDateOnly);
+        int offset;
+        TimeZoneResolver::parseUtcOffset(line.value, offset);
+    }
+}
+
+void roundTrip(const QList<Event*>& events) {
+    QByteArray exported;
+    QBuffer buffer(&exported);
+    buffer.open(QIODevice::WriteOnly);
+
+    QList<const Event*> written;
+    IcsWriter writer(&buffer);
+    writer.beginCalendar("fuzz");
+    for (const Event* event : events) {
+        if (event->getStartUtc() >= firstWritableUtc && event->getEndUtc() <= lastWritableUtc) {
+            writer.writeEvent(event);
+            written.append(event);
+        }
+    }
+    writer.endCalendar();
+    FUZZ_CHECK(writer.finish());
+
+    // every exported line must fit in 75 octets
+    for (const QByteArray& line : exported.split('\n')) {
+        FUZZ_CHECK(line.size() <= 76);
+    }
+
+    IcsParser parser;
+    QList<Event*> reparsed = parser.parse(QString::fromUtf8(exported), nullptr);
+    FUZZ_CHECK(reparsed.size() == written.size());
+    for (qsizetype i = 0; i < reparsed.size(); i++) {
+        FUZZ_CHECK(reparsed[i]->getStartUtc() == written[i]->getStartUtc());
+        FUZZ_CHECK(reparsed[i]->getEndUtc() == written[i]->getEndUtc());
+        // the writer drops bare CRs, everything else survives escaping and folding
+        if (!written[i]->getTitle().contains(u'\r')) {
+            FUZZ_CHECK(reparsed[i]->getTitle() == written[i]->getTitle());
+        }
+    }
+    qDeleteAll(reparsed);
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    QString content = QString::fromUtf8(reinterpret_cast<const char*>(data), qsizetype(size));
+
+    lexEverything(content);
+
+    IcsParser parser;
+    QList<Event*> events = parser.parse(content, nullptr);
+    roundTrip(events);
+    qDeleteAll(events);
+    return 0;
+}
+
+#ifndef ICSFUZZ_LIBFUZZER
+
+/**
+ * @brief Runs the fuzz target on files, directories of files, or stdin.
+ */
+int main(int argc, char* argv[]) {
+    int inputs = 0;
+    auto runFile = [&](const QString& path) {
+        QFile file(path);
+        if (!file.open(QIODevice::ReadOnly)) {
+            std::fprintf(stderr, "icsfuzz: cannot read %s\n", qPrintable(path));
+            return;
+        }
+        QByteArray bytes = file.readAll();
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(bytes.constData()), size_t(bytes.size()));
+        inputs++;
+    };
+
+    if (argc < 2) {
+        QFile in;
+        in.open(stdin, QIODevice::ReadOnly);
+        QByteArray bytes = in.readAll();
+        LLVMFuzzerTestOneInput(reinterpret_cast<const uint8_t*>(bytes.constData()), size_t(bytes.size()));
+        inputs++;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        QString path = QString::fromLocal8Bit(argv[i]);
+        if (QFileInfo(path).isDir()) {
+            QDirIterator it(path, QDir::Files, QDirIterator::Subdirectories);
+            while (it.hasNext()) {
+                runFile(it.next());
+            }
+        }
+        else {
+            runFile(path);
+        }
+    }
+
+    std::fprintf(stderr, "icsfuzz: %d inputs ran cleanly\n", inputs);
+    return 0;
+}
+
+#endif
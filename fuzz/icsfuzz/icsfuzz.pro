@@ -0,0 +1,20 @@
+QT       += core gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = icsfuzz
+
+include(../../calendar/core.pri)
+
+SOURCES += \
+    icsfuzz.cpp
+
+# qmake CONFIG+=libfuzzer builds a libFuzzer binary with clang. Without it the
+# target gets a standalone driver that runs files, directories or stdin, which
+# is also how AFL runs it (build with afl-clang-fast++ and pass @@).
+libfuzzer {
+    DEFINES += ICSFUZZ_LIBFUZZER
+    QMAKE_CXXFLAGS += -fsanitize=fuzzer,address,undefined
+    QMAKE_LFLAGS += -fsanitize=fuzzer,address,undefined
+}
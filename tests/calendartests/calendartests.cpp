@@ -0,0 +1,682 @@
+/**
+ * @file calendartests.cpp
+ * @brief Unit tests for the ICS reader, the calendar and its indexes, ID allocation and the journal.
+ *
+ * Run with `qmake && make check` in this directory, or run the built binary.
+ */
+#include "calendar.h"
+#include "event.h"
+#include "eventactions.h"
+#include "eventjournal.h"
+#include "icslexer.h"
+#include "icsparser.h"
+#include "idallocator.h"
+#include "intervalindex.h"
+#include "snapshot.h"
+#include "textindex.h"
+#include "undohistory.h"
+#include "user.h"
+#include <QFile>
+#include <QRandomGenerator>
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+#include <memory>
+
+namespace {
+
+// 2024-01-15T00:00:00Z
+constexpr qint64 januaryFifteenth = 1705276800;
+
+/**
+ * @brief Wraps VEVENT lines into a feed.
+ * @param eventLines The lines between BEGIN:VEVENT and END:VEVENT, CRLF separated.
+ * @return The feed.
+ */
+QString feedOf(const QString& eventLines) {
+    return QString("BEGIN:VCALENDAR\r\nVERSION:2.0\r\nBEGIN:VEVENT\r\n%1END:VEVENT\r\nEND:VCALENDAR\r\n")
+        .arg(eventLines);
+}
+
+/**
+ * @brief Parses a feed holding at most one event.
+ * @param feed The feed.
+ * @return The event, or nullptr if it was rejected.
+ */
+std::unique_ptr<Event> parseOne(const QString& feed) {
+    IcsParser parser;
+    QList<Event*> events = parser.parse(feed, nullptr);
+    if (events.size() != 1) {
+        qDeleteAll(events);
+        return nullptr;
+    }
+    return std::unique_ptr<Event>(events.first());
+}
+
+/**
+ * @brief Replays a journal directory.
+ * @param directory The directory.
+ * @param records Receives the replayed changes.
+ * @return What EventJournal::open() returned.
+ */
+bool replay(const QString& directory, QList<EventJournal::Record>& records) {
+    EventJournal journal(directory);
+    return journal.open([&records](const EventJournal::Record& record) { records.append(record); });
+}
+
+}
+
+/**
+ * @class CalendarTests
+ * @brief Checks the core classes shared by the app, the benchmarks and the fuzzer.
+ */
+class CalendarTests : public QObject {
+    Q_OBJECT
+
+private slots:
+    void lexerSplitsParameters();
+    void lexerUnfoldsLines();
+    void parserReadsSummaryWithLanguage();
+    void parserResolvesTzid();
+    void parserReadsDateValue();
+    void parserReadsFoldedDescription();
+    void parserRejectsEventWithoutSummary();
+    void parseDuration_data();
+    void parseDuration();
+    void tokenizeEscapedMatchesTokenize_data();
+    void tokenizeEscapedMatchesTokenize();
+    void intervalIndexFindsOverlaps();
+    void calendarFindsEventsById();
+    void calendarAppliesBatches();
+    void calendarSpillsMonthsOutsideHorizon();
+    void eventCommandUndoesAcrossDeletes();
+    void retireEpochFreesLongChains();
+    void idAllocatorSkipsReservedIds();
+    void journalRoundTrip();
+    void journalKeepsUnreadableFileAside();
+    void journalStopsAtMissingRecord();
+};
+
+void CalendarTests::lexerSplitsParameters() {
+    QString feed("SUMMARY;LANGUAGE=en:Team sync\r\nDTSTART;TZID=\"Europe/Berlin\":20240115T100000\r\n");
+    IcsLexer lexer(feed);
+    IcsContentLine line;
+
+    QVERIFY(lexer.next(line));
+    QVERIFY(line.is(QLatin1String("SUMMARY")));
+    QCOMPARE(line.parameter(QLatin1String("LANGUAGE")).toString(), QString("en"));
+    QCOMPARE(line.value.toString(), QString("Team sync"));
+
+    QVERIFY(lexer.next(line));
+    QVERIFY(line.is(QLatin1String("DTSTART")));
+    QCOMPARE(line.parameter(QLatin1String("TZID")).toString(), QString("Europe/Berlin"));
+    QCOMPARE(line.value.toString(), QString("20240115T100000"));
+
+    QVERIFY(!lexer.next(line));
+}
+
+void CalendarTests::lexerUnfoldsLines() {
+    QString feed("DESCRIPTION:first part\r\n  and the rest\r\n\tof it\nLOCATION:Room 1\n");
+    IcsLexer lexer(feed);
+    IcsContentLine line;
+
+    QVERIFY(lexer.next(line));
+    QVERIFY(line.is(QLatin1String("DESCRIPTION")));
+    QCOMPARE(line.value.toString(), QString("first part and the restof it"));
+    QVERIFY(!lexer.isInFeed(line.value));
+
+    QVERIFY(lexer.next(line));
+    QVERIFY(line.is(QLatin1String("LOCATION")));
+    QCOMPARE(line.value.toString(), QString("Room 1"));
+    QVERIFY(lexer.isInFeed(line.value));
+}
+
+void CalendarTests::parserReadsSummaryWithLanguage() {
+    std::unique_ptr<Event> event = parseOne(feedOf("SUMMARY;LANGUAGE=en:Team sync\r\n"
+                                                   "DTSTART:20240115T090000Z\r\n"
+                                                   "DTEND:20240115T100000Z\r\n"));
+    QVERIFY(event);
+    QCOMPARE(event->getTitle(), QString("Team sync"));
+    QCOMPARE(event->getStartUtc(), januaryFifteenth + 9 * 3600);
+    QCOMPARE(event->getEndUtc(), januaryFifteenth + 10 * 3600);
+}
+
+void CalendarTests::parserResolvesTzid() {
+    // Berlin is UTC+1 in January
+    std::unique_ptr<Event> event = parseOne(feedOf("SUMMARY:Standup\r\n"
+                                                   "DTSTART;TZID=Europe/Berlin:20240115T100000\r\n"
+                                                   "DURATION:PT15M\r\n"));
+    QVERIFY(event);
+    QCOMPARE(event->getStartUtc(), januaryFifteenth + 9 * 3600);
+    QCOMPARE(event->getEndUtc(), januaryFifteenth + 9 * 3600 + 900);
+}
+
+void CalendarTests::parserReadsDateValue() {
+    std::unique_ptr<Event> event = parseOne(feedOf("SUMMARY:Holiday\r\n"
+                                                   "DTSTART;VALUE=DATE:20240115\r\n"));
+    QVERIFY(event);
+    // dates start at local midnight and last one day
+    QDateTime start = QDateTime::fromSecsSinceEpoch(event->getStartUtc());
+    QCOMPARE(start.date(), QDate(2024, 1, 15));
+    QCOMPARE(start.time(), QTime(0, 0));
+    QCOMPARE(event->getEndUtc() - event->getStartUtc(), qint64(86400));
+}
+
+void CalendarTests::parserReadsFoldedDescription() {
+    std::unique_ptr<Event> event = parseOne(feedOf("SUMMARY:Review\r\n"
+                                                   "DESCRIPTION:Line one\\nLine\\, \r\n two\r\n"
+                                                   "LOCATION:  Room 4  \r\n"
+                                                   "DTSTART:20240115T090000Z\r\n"));
+    QVERIFY(event);
+    QCOMPARE(event->getDescription(), QString("Line one\nLine, two"));
+    QCOMPARE(event->getLocation(), QString("Room 4"));
+}
+
+void CalendarTests::parserRejectsEventWithoutSummary() {
+    QVERIFY(!parseOne(feedOf("SUMMARY:  \r\nDTSTART:20240115T090000Z\r\n")));
+    QVERIFY(!parseOne(feedOf("SUMMARY:Lunch\r\nDTSTART:not a date\r\n")));
+}
+
+void CalendarTests::parseDuration_data() {
+    QTest::addColumn<QString>("value");
+    QTest::addColumn<bool>("valid");
+    QTest::addColumn<qint64>("seconds");
+
+    QTest::newRow("hours and minutes") << "PT1H30M" << true << qint64(5400);
+    QTest::newRow("day") << "P1D" << true << qint64(86400);
+    QTest::newRow("weeks") << "P2W" << true << qint64(2 * 7 * 86400);
+    QTest::newRow("day and time") << "P1DT2H" << true << qint64(86400 + 7200);
+    QTest::newRow("seconds") << "+PT45S" << true << qint64(45);
+    QTest::newRow("negative") << "-PT15M" << true << qint64(-900);
+    QTest::newRow("empty") << "" << false << qint64(0);
+    QTest::newRow("no parts") << "P" << false << qint64(0);
+    QTest::newRow("empty time") << "PT" << false << qint64(0);
+    QTest::newRow("no P") << "1H" << false << qint64(0);
+    QTest::newRow("hours without T") << "P1H" << false << qint64(0);
+    QTest::newRow("days in time") << "PT1D" << false << qint64(0);
+    QTest::newRow("unknown unit") << "PT1X" << false << qint64(0);
+    QTest::newRow("two T") << "PT1HT2M" << false << qint64(0);
+    QTest::newRow("number without unit") << "PT15" << false << qint64(0);
+}
+
+void CalendarTests::parseDuration() {
+    QFETCH(QString, value);
+    QFETCH(bool, valid);
+    QFETCH(qint64, seconds);
+
+    qint64 parsed = 0;
+    QCOMPARE(IcsParser::parseDuration(value, parsed), valid);
+    if (valid) {
+        QCOMPARE(parsed, seconds);
+    }
+}
+
+void CalendarTests::tokenizeEscapedMatchesTokenize_data() {
+    QTest::addColumn<QString>("escaped");
+
+    QTest::newRow("plain") << "Quarterly Planning 2024";
+    QTest::newRow("escapes") << "Room\\, 4\\;east\\nFloor\\\\2 \\Qa";
+    QTest::newRow("trailing backslash") << "end\\";
+    QTest::newRow("non-ASCII") << QString::fromUtf8("Café Größe naïve Ünïcode");
+    QTest::newRow("outside the BMP") << QString::fromUtf8("a\xF0\x9D\x90\x80" "b \xF0\x9F\x98\x80 ok");
+    QTest::newRow("escaped non-ASCII") << QString::fromUtf8("x\\é y");
+}
+
+void CalendarTests::tokenizeEscapedMatchesTokenize() {
+    QFETCH(QString, escaped);
+    QCOMPARE(TextIndex::tokenizeEscaped(escaped.toUtf8()), TextIndex::tokenize(IcsContentLine::unescape(escaped)));
+}
+
+void CalendarTests::intervalIndexFindsOverlaps() {
+    Event meeting(1, "Meeting", QString(), januaryFifteenth + 3600, QString(), nullptr);
+    meeting.setEndUtc(januaryFifteenth + 7200);
+    Event reminder(2, "Reminder", QString(), januaryFifteenth + 5400, QString(), nullptr);
+    Event trip(3, "Trip", QString(), januaryFifteenth - 86400, QString(), nullptr);
+    trip.setEndUtc(januaryFifteenth + 3 * 86400);
+
+    IntervalIndex index;
+    index.insert(QList<Event*>{&meeting, &reminder});
+    index.insert(&trip);
+    QCOMPARE(index.size(), qsizetype(3));
+    QCOMPARE(index.getLongEntries().size(), qsizetype(1));
+
+    QList<Event*> found = index.overlapping(januaryFifteenth + 5000, januaryFifteenth + 6000);
+    QCOMPARE(found.size(), qsizetype(3));
+    QVERIFY(found.contains(&meeting) && found.contains(&reminder) && found.contains(&trip));
+
+    // ranges are half open, the meeting ends where this one starts
+    found = index.overlapping(januaryFifteenth + 7200, januaryFifteenth + 8000);
+    QCOMPARE(found, QList<Event*>{&trip});
+
+    // an instant counts only when it starts inside the range
+    found = index.overlapping(januaryFifteenth + 5400, januaryFifteenth + 5401);
+    QVERIFY(found.contains(&reminder));
+    found = index.overlapping(januaryFifteenth + 5401, januaryFifteenth + 5500);
+    QVERIFY(!found.contains(&reminder));
+
+    QVERIFY(index.overlapping(januaryFifteenth, januaryFifteenth).isEmpty());
+
+    QVERIFY(index.remove(&meeting));
+    QVERIFY(!index.remove(&meeting));
+    QVERIFY(!index.overlapping(januaryFifteenth + 3600, januaryFifteenth + 7200).contains(&meeting));
+    QVERIFY(index.remove(&trip));
+    QCOMPARE(index.size(), qsizetype(1));
+}
+
+void CalendarTests::calendarFindsEventsById() {
+    User user(1, "Ada", "Lovelace");
+    Calendar calendar(1, &user);
+    Event* first = new Event(101, "First", QString(), januaryFifteenth, QString(), &user);
+    Event* second = new Event(102, "Second", QString(), januaryFifteenth + 3600, QString(), &user);
+    calendar.addEvents({first, second});
+    QCOMPARE(calendar.snapshot()->ids.size(), qsizetype(2));
+    QCOMPARE(calendar.snapshot()->ids.find(102), second);
+    QCOMPARE(calendar.snapshot()->ids.find(103), nullptr);
+
+    // a new version replaces the one with its ID in every index
+    Event* moved = new Event(102, "Second", QString(), januaryFifteenth + 86400, QString(), &user);
+    {
+        std::shared_ptr<const Calendar::Snapshot> before = calendar.snapshot();
+        calendar.updateEvent(moved);
+        QCOMPARE(calendar.snapshot()->ids.find(102), moved);
+        QCOMPARE(calendar.getEventsBetween(januaryFifteenth + 86400, januaryFifteenth + 86401), QList<Event*>{moved});
+        QVERIFY(calendar.getEventsBetween(januaryFifteenth + 3600, januaryFifteenth + 3601).isEmpty());
+
+        // readers of the old version still see it
+        QCOMPARE(before->ids.find(102), second);
+        QCOMPARE(second->getTitle(), QString("Second"));
+    }
+
+    // events the calendar does not hold are left to the caller, even under a held ID
+    Event stranger(103, "Stranger", QString(), januaryFifteenth, QString(), &user);
+    Event impostor(101, "Impostor", QString(), januaryFifteenth, QString(), &user);
+    QVERIFY(!calendar.removeEvent(&stranger));
+    QVERIFY(!calendar.removeEvent(&impostor));
+    QCOMPARE(calendar.snapshot()->ids.find(101), first);
+
+    QVERIFY(calendar.removeEvent(first));
+    QCOMPARE(calendar.eventCount(), qint64(1));
+    QCOMPARE(calendar.snapshot()->ids.find(101), nullptr);
+}
+
+void CalendarTests::calendarAppliesBatches() {
+    User user(1, "Ada", "Lovelace");
+    Calendar calendar(1, &user);
+    Event* first = new Event(101, "First", QString(), januaryFifteenth, QString(), &user);
+    Event* second = new Event(102, "Second", QString(), januaryFifteenth + 3600, QString(), &user);
+    Event* third = new Event(103, "Third", QString(), januaryFifteenth + 7200, QString(), &user);
+    calendar.addEvents({first, second, third});
+
+    // changes that find no event are left out and stay with the caller
+    Event* edited = new Event(101, "First, later", QString(), januaryFifteenth + 86400, QString(), &user);
+    Event* added = new Event(104, "Fourth", QString(), januaryFifteenth + 10800, QString(), &user);
+    Event stranger(199, "Stranger", QString(), januaryFifteenth, QString(), &user);
+    Event impostor(103, "Impostor", QString(), januaryFifteenth, QString(), &user);
+    std::shared_ptr<const Calendar::Snapshot> before = calendar.snapshot();
+    QList<Calendar::Change> applied = calendar.apply({{Calendar::Change::Update, edited},
+                                                      {Calendar::Change::Remove, second},
+                                                      {Calendar::Change::Update, &stranger},
+                                                      {Calendar::Change::Remove, &impostor},
+                                                      {Calendar::Change::Add, added}});
+    QCOMPARE(applied.size(), qsizetype(3));
+    QCOMPARE(applied[0].kind, Calendar::Change::Update);
+    QCOMPARE(applied[0].event, edited);
+    QCOMPARE(applied[0].previous, first);
+    QCOMPARE(applied[1].kind, Calendar::Change::Remove);
+    QCOMPARE(applied[1].event, second);
+    QCOMPARE(applied[2].kind, Calendar::Change::Add);
+    QCOMPARE(applied[2].event, added);
+
+    std::shared_ptr<const Calendar::Snapshot> after = calendar.snapshot();
+    QCOMPARE(after->events.size(), qsizetype(3));
+    QCOMPARE(after->ids.find(101), edited);
+    QCOMPARE(after->ids.find(102), nullptr);
+    QCOMPARE(after->ids.find(103), third);
+    QCOMPARE(after->ids.find(104), added);
+    QCOMPARE(after->ids.find(199), nullptr);
+
+    // the retired versions stay readable for as long as the version before is held
+    QCOMPARE(before->ids.find(101), first);
+    QCOMPARE(first->getTitle(), QString("First"));
+    QCOMPARE(second->getTitle(), QString("Second"));
+    before.reset();
+    after.reset();
+
+    // detached events outlive every snapshot until the caller retires them
+    Event* moved = new Event(104, "Fourth, later", QString(), januaryFifteenth + 2 * 86400, QString(), &user);
+    applied = calendar.apply({{Calendar::Change::Remove, third}, {Calendar::Change::Update, moved}}, true);
+    QCOMPARE(applied.size(), qsizetype(2));
+    QCOMPARE(applied[1].previous, added);
+    calendar.addEvent(new Event(105, "Fifth", QString(), januaryFifteenth, QString(), &user));
+    calendar.addEvent(new Event(106, "Sixth", QString(), januaryFifteenth, QString(), &user));
+    QCOMPARE(third->getTitle(), QString("Third"));
+    QCOMPARE(added->getTitle(), QString("Fourth"));
+    QCOMPARE(calendar.snapshot()->ids.find(103), nullptr);
+    QCOMPARE(calendar.snapshot()->ids.find(104), moved);
+    calendar.retire(third);
+    calendar.retire(added);
+
+    QVERIFY(calendar.apply({}).isEmpty());
+    QCOMPARE(calendar.eventCount(), qint64(4));
+}
+
+void CalendarTests::calendarSpillsMonthsOutsideHorizon() {
+    constexpr qint64 day = 86400;
+    constexpr int februaryCount = 2048;
+    User user(1, "Ada", "Lovelace");
+    Calendar calendar(1, &user);
+
+    // February is random text, so its block is too big to keep as garbage
+    QRandomGenerator random(49);
+    QList<Event*> events{new Event(301, "January", QString(), januaryFifteenth, QString(), &user),
+                         new Event(302, "March", "Spilled", januaryFifteenth + 60 * day, "Lab", &user)};
+    for (int i = 0; i < februaryCount; i++) {
+        QByteArray noise(768, Qt::Uninitialized);
+        random.fillRange(reinterpret_cast<quint32*>(noise.data()), noise.size() / sizeof(quint32));
+        events.append(new Event(400 + i, "February", QString::fromLatin1(noise.toBase64()),
+                                januaryFifteenth + 31 * day + i, QString(), &user));
+    }
+    calendar.addEvents(events);
+    qint64 total = calendar.eventCount();
+
+    QList<QPair<QDate, QDate>> january{{QDate(2024, 1, 1), QDate(2024, 1, 31)}};
+    calendar.setHorizon(january);
+    std::shared_ptr<const Calendar::Snapshot> spilled = calendar.snapshot();
+    QCOMPARE(calendar.eventCount(), total);
+    QCOMPARE(spilled->events.size(), qsizetype(1));
+    QCOMPARE(spilled->spilled.keys(), (QList<QDate>{QDate(2024, 2, 1), QDate(2024, 3, 1)}));
+    QVERIFY(spilled->segment);
+    QCOMPARE(spilled->ids.find(302), nullptr);
+    QVERIFY(calendar.getEventsBetween(januaryFifteenth + 60 * day, januaryFifteenth + 60 * day + 1).isEmpty());
+
+    // a spilled block reads back as new events, without paging the month in
+    QList<Event*> march = calendar.readSpilled(spilled, spilled->spilled.value(QDate(2024, 3, 1)).first());
+    QCOMPARE(march.size(), qsizetype(1));
+    QCOMPARE(march.first()->getEventID(), qint64(302));
+    QCOMPARE(march.first()->getDescription(), QString("Spilled"));
+    QCOMPARE(march.first()->getLocation(), QString("Lab"));
+    qDeleteAll(march);
+
+    // paging February in leaves its block as garbage, which compaction drops
+    calendar.setHorizon({{QDate(2024, 1, 1), QDate(2024, 2, 29)}});
+    std::shared_ptr<const Calendar::Snapshot> pagedIn = calendar.snapshot();
+    QCOMPARE(calendar.eventCount(), total);
+    QCOMPARE(pagedIn->events.size(), qsizetype(1 + februaryCount));
+    QCOMPARE(pagedIn->ids.find(400)->getTitle(), QString("February"));
+    QCOMPARE(pagedIn->spilled.keys(), QList<QDate>{QDate(2024, 3, 1)});
+    QVERIFY(pagedIn->segment != spilled->segment);
+    QCOMPARE(pagedIn->segment->size(), pagedIn->spilled.value(QDate(2024, 3, 1)).first().size);
+    march = calendar.readSpilled(pagedIn, pagedIn->spilled.value(QDate(2024, 3, 1)).first());
+    QCOMPARE(march.size(), qsizetype(1));
+    qDeleteAll(march);
+
+    // the older version still reads its blocks from the old segment
+    QList<Event*> february = calendar.readSpilled(spilled, spilled->spilled.value(QDate(2024, 2, 1)).first());
+    QCOMPARE(february.size(), qsizetype(februaryCount));
+    qDeleteAll(february);
+    spilled.reset();
+
+    // spilling again appends to the compacted segment
+    calendar.setHorizon(january);
+    QVERIFY(calendar.snapshot()->segment == pagedIn->segment);
+    QCOMPARE(calendar.eventCount(), total);
+    pagedIn.reset();
+
+    // with no horizon every month is resident and the segment is dropped
+    calendar.setHorizon({});
+    QCOMPARE(calendar.snapshot()->events.size(), qsizetype(total));
+    QVERIFY(calendar.snapshot()->spilled.isEmpty());
+    QVERIFY(!calendar.snapshot()->segment);
+    QCOMPARE(calendar.snapshot()->ids.find(302)->getTitle(), QString("March"));
+    QCOMPARE(calendar.getEventsBetween(januaryFifteenth + 60 * day, januaryFifteenth + 60 * day + 1).size(),
+             qsizetype(1));
+}
+
+void CalendarTests::eventCommandUndoesAcrossDeletes() {
+    User user(1, "Ada", "Lovelace");
+    Calendar calendar(1, &user);
+    int notified = 0;
+    {
+        UndoHistory history;
+        BatchEventActions::Listener listener = [&notified](const EventActionResult&) { notified++; };
+        EditEventStrategy edit;
+        edit.setListener(listener);
+        edit.setHistory(&history);
+
+        Event* standup = new Event(201, "Standup", QString(), januaryFifteenth + 9 * 3600, QString(), &user);
+        Event* review = new Event(202, "Review", QString(), januaryFifteenth + 14 * 3600, QString(), &user);
+        BatchEventActions creation(&calendar, listener, &history);
+        creation.create(standup);
+        creation.create(review);
+        QVERIFY(creation.commit().applied);
+
+        Event* moved = new Event(201, "Standup", QString(), januaryFifteenth + 10 * 3600, QString(), &user);
+        QVERIFY(edit.execute(&calendar, moved).applied);
+        QCOMPARE(history.undoText(), QString("Edit 'Standup'"));
+
+        BatchEventActions deletion(&calendar, listener, &history);
+        deletion.remove(moved);
+        deletion.remove(review);
+        QVERIFY(deletion.commit().applied);
+        QCOMPARE(calendar.eventCount(), qint64(0));
+        QCOMPARE(notified, 3);
+
+        // undo puts back the very objects the deletion detached, then the versions before
+        history.undo();
+        QCOMPARE(calendar.snapshot()->ids.find(201), moved);
+        QCOMPARE(calendar.snapshot()->ids.find(202), review);
+        history.undo();
+        QCOMPARE(calendar.snapshot()->ids.find(201), standup);
+        QCOMPARE(calendar.getEventsBetween(januaryFifteenth + 9 * 3600, januaryFifteenth + 9 * 3600 + 1),
+                 QList<Event*>{standup});
+        history.undo();
+        QCOMPARE(calendar.eventCount(), qint64(0));
+        QVERIFY(!history.canUndo());
+        QCOMPARE(notified, 6);
+
+        // redo walks forward again, through the deletion
+        history.redo();
+        QCOMPARE(calendar.snapshot()->ids.find(201), standup);
+        history.redo();
+        QCOMPARE(calendar.snapshot()->ids.find(201), moved);
+        QCOMPARE(moved->getStartUtc(), januaryFifteenth + 10 * 3600);
+        history.redo();
+        QCOMPARE(calendar.eventCount(), qint64(0));
+        QVERIFY(!history.canRedo());
+
+        // a new edit after undoing drops the undone commands, which retire the version they held
+        history.undo();
+        history.undo();
+        Event* renamed = new Event(201, "Daily standup", QString(), januaryFifteenth + 9 * 3600, QString(), &user);
+        QVERIFY(edit.execute(&calendar, renamed).applied);
+        QVERIFY(!history.canRedo());
+        QCOMPARE(calendar.snapshot()->ids.find(201), renamed);
+        history.undo();
+        QCOMPARE(calendar.snapshot()->ids.find(201), standup);
+        QCOMPARE(history.redoText(), QString("Edit 'Daily standup'"));
+    }
+
+    // the commands went away with the history, the calendar keeps what undo left
+    QCOMPARE(calendar.eventCount(), qint64(2));
+    QCOMPARE(calendar.snapshot()->ids.find(201)->getTitle(), QString("Standup"));
+}
+
+void CalendarTests::retireEpochFreesLongChains() {
+    struct Counted {
+        int* count;
+        ~Counted() { ++*count; }
+    };
+
+    // a snapshot pinned across a million publishes
+    int freed = 0;
+    std::shared_ptr<RetireEpoch> pinned = std::make_shared<RetireEpoch>();
+    std::shared_ptr<RetireEpoch> current = pinned;
+    for (int i = 0; i < 1000000; i++) {
+        current->retire(new Counted{&freed});
+        current = current->advance();
+    }
+    current.reset();
+    QCOMPARE(freed, 0);
+
+    pinned.reset();
+    QCOMPARE(freed, 1000000);
+}
+
+void CalendarTests::idAllocatorSkipsReservedIds() {
+    qint64 first = IdAllocator::next(IdAllocator::Events);
+    qint64 second = IdAllocator::next(IdAllocator::Events);
+    QVERIFY(second > first);
+
+    // an ID restored from disk is never handed out, nor anything below it
+    qint64 restored = second + 100000;
+    IdAllocator::reserve(IdAllocator::Events, restored);
+    qint64 after = IdAllocator::next(IdAllocator::Events);
+    QVERIFY(after > restored);
+
+    // reserving a lower ID does not move the allocator back
+    IdAllocator::reserve(IdAllocator::Events, first);
+    QVERIFY(IdAllocator::next(IdAllocator::Events) > after);
+
+    // 64-bit IDs survive
+    qint64 wide = (qint64(1) << 40) + 7;
+    IdAllocator::reserve(IdAllocator::Events, wide);
+    QVERIFY(IdAllocator::next(IdAllocator::Events) > wide);
+
+    qint64 user = IdAllocator::next(IdAllocator::Users);
+    QCOMPARE(IdAllocator::next(IdAllocator::Users), user + 1);
+}
+
+void CalendarTests::journalRoundTrip() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    // user, calendar and event IDs past 32 bits
+    qint64 userID = (qint64(1) << 33) + 7;
+    User user(userID, "Ada", "Lovelace");
+    Calendar calendar(userID, &user);
+    qint64 wideID = (qint64(3) << 32) + 5;
+    {
+        EventJournal journal(directory.path());
+        QVERIFY(journal.open([](const EventJournal::Record&) {}));
+
+        // one created event with text that needs escaping, one imported event still in its arena
+        Event* created = new Event(wideID, "Plan\\review", "Line one\nLine, two", januaryFifteenth,
+                                   "  Room 4  ", &user);
+        created->setEndUtc(januaryFifteenth + 1800);
+        IcsParser parser;
+        QList<Event*> imported = parser.parse(feedOf("SUMMARY:Imported\\, event\r\n"
+                                                     "DTSTART:20240115T120000Z\r\n"
+                                                     "DTEND:20240115T130000Z\r\n"), &user);
+        QCOMPARE(imported.size(), qsizetype(1));
+        QList<Event*> events{created, imported.first()};
+        calendar.addEvents(events);
+
+        journal.userCreated(&user, QColor(10, 20, 30));
+        journal.eventsAdded(userID, &calendar, events);
+        journal.eventRemoved(userID, wideID);
+        QVERIFY(journal.flush());
+    }
+
+    QList<EventJournal::Record> records;
+    QVERIFY(replay(directory.path(), records));
+
+    QCOMPARE(records.size(), qsizetype(3));
+    QCOMPARE(records[0].type, EventJournal::UserCreated);
+    QCOMPARE(records[0].userID, userID);
+    QCOMPARE(records[0].firstName, QString("Ada"));
+    QCOMPARE(records[0].lastName, QString("Lovelace"));
+    QCOMPARE(records[0].color, QColor(10, 20, 30));
+
+    QCOMPARE(records[1].type, EventJournal::EventsAdded);
+    QCOMPARE(records[1].calendarID, userID);
+    QCOMPARE(records[1].events.size(), qsizetype(2));
+    const EventJournal::EventData& created = records[1].events[0];
+    QCOMPARE(created.eventID, wideID);
+    QCOMPARE(created.title, QString("Plan\\review"));
+    QCOMPARE(created.description, QString("Line one\nLine, two"));
+    QCOMPARE(created.location, QString("  Room 4  "));
+    QCOMPARE(created.startUtc, januaryFifteenth);
+    QCOMPARE(created.endUtc, januaryFifteenth + 1800);
+    const EventJournal::EventData& imported = records[1].events[1];
+    QCOMPARE(imported.title, QString("Imported, event"));
+    QCOMPARE(imported.startUtc, januaryFifteenth + 12 * 3600);
+    QCOMPARE(imported.endUtc, januaryFifteenth + 13 * 3600);
+
+    QCOMPARE(records[2].type, EventJournal::EventRemoved);
+    QCOMPARE(records[2].calendarID, userID);
+    QCOMPARE(records[2].eventID, wideID);
+    QVERIFY(records[2].sequence > records[1].sequence && records[1].sequence > records[0].sequence);
+}
+
+void CalendarTests::journalKeepsUnreadableFileAside() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    // a journal of another format
+    QString path = directory.filePath("journal.bin");
+    QByteArray foreign("ALJ0 saved by some other version");
+    {
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(foreign);
+    }
+
+    User user(3, "Grace", "Hopper");
+    {
+        EventJournal journal(directory.path());
+        QVERIFY(journal.open([](const EventJournal::Record&) { QFAIL("nothing should be replayed"); }));
+        QCOMPARE(journal.getSetAsideFiles(), QStringList{path + ".bad"});
+        journal.userCreated(&user, QColor(Qt::red));
+        QVERIFY(journal.flush());
+    }
+
+    QFile kept(path + ".bad");
+    QVERIFY(kept.open(QIODevice::ReadOnly));
+    QCOMPARE(kept.readAll(), foreign);
+
+    // the new journal replays without setting anything aside
+    QList<EventJournal::Record> records;
+    EventJournal journal(directory.path());
+    QVERIFY(journal.open([&records](const EventJournal::Record& record) { records.append(record); }));
+    QVERIFY(journal.getSetAsideFiles().isEmpty());
+    QCOMPARE(records.size(), qsizetype(1));
+}
+
+void CalendarTests::journalStopsAtMissingRecord() {
+    QTemporaryDir directory;
+    QVERIFY(directory.isValid());
+
+    User first(1, "Ada", "Lovelace");
+    User second(2, "Grace", "Hopper");
+    User third(3, "Alan", "Turing");
+    {
+        EventJournal journal(directory.path());
+        QVERIFY(journal.open([](const EventJournal::Record&) {}));
+        journal.userCreated(&first, QColor(Qt::red));
+        journal.userCreated(&second, QColor(Qt::green));
+        journal.userCreated(&third, QColor(Qt::blue));
+        QVERIFY(journal.flush());
+    }
+
+    // cut the second record out; frames are a little-endian length, a checksum and the payload
+    QString path = directory.filePath("journal.bin");
+    QFile file(path);
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray bytes = file.readAll();
+    qsizetype secondFrame = 4 + 8 + qFromLittleEndian<quint32>(bytes.constData() + 4);
+    qsizetype thirdFrame = secondFrame + 8 + qFromLittleEndian<quint32>(bytes.constData() + secondFrame);
+    QByteArray damaged = bytes.left(secondFrame) + bytes.mid(thirdFrame);
+    file.resize(0);
+    file.write(damaged);
+    file.close();
+
+    QList<EventJournal::Record> records;
+    EventJournal journal(directory.path());
+    QVERIFY(journal.open([&records](const EventJournal::Record& record) { records.append(record); }));
+    QCOMPARE(records.size(), qsizetype(1));
+    QCOMPARE(records[0].firstName, QString("Ada"));
+    QCOMPARE(journal.getSetAsideFiles(), QStringList{path + ".bad"});
+}
+
+QTEST_GUILESS_MAIN(CalendarTests)
+#include "calendartests.moc"
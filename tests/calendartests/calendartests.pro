@@ -0,0 +1,11 @@
+QT       += core gui testlib
+
+CONFIG += c++17 console testcase
+CONFIG -= app_bundle
+
+TARGET = calendartests
+
+include(../../calendar/core.pri)
+
+SOURCES += \
+    calendartests.cpp
@@ -0,0 +1,14 @@
+QT       += core
+QT       -= gui
+
+CONFIG += c++17 console
+CONFIG -= app_bundle
+
+TARGET = icsgen
+
+SOURCES += \
+    icsgenerator.cpp \
+    main.cpp
+
+HEADERS += \
+    icsgenerator.h
@@ -0,0 +1,351 @@
+/**
+ * @file icsgenerator.cpp
+ * @brief Implementation of the IcsGenerator class
+ */
+#include "icsgenerator.h"
+#include <iterator>
+
+namespace {
+
+// flush the output buffer once it grows past this size
+constexpr int flushThreshold = 1 << 20;
+
+// RFC 5545 content lines are folded at 75 octets
+constexpr int foldWidth = 75;
+
+const char* const titles[] = {
+    "Team sync", "1:1", "Design review", "Sprint planning", "Lunch", "Dentist appointment",
+    "Offsite", "Customer call", "Interview", "Retrospective", "Gym", "Standup",
+    "Budget review", "All hands", "Réunion d'équipe", "Coffee chat"
+};
+
+const char* const locations[] = {
+    "", "Room 101", "Main office, 3rd floor", "https://meet.example.com/abc-defg-hij",
+    "Café Central", "Boardroom; east wing", "Toronto, ON", "Remote"
+};
+
+const char* const words[] = {
+    "agenda", "review", "the", "quarterly", "roadmap", "with", "design", "team", "notes",
+    "follow-up", "budget", "and", "customer", "feedback", "for", "launch", "metrics",
+    "naïve", "café", "日本", "🚀", "action", "items", "owner", "deadline", "draft", "plan"
+};
+
+/**
+ * @brief Writes a VTIMEZONE block the generator knows about.
+ * @param tzid The zone.
+ * @return The block, CRLF terminated, or an empty array if unknown.
+ */
+QByteArray timeZoneBlock(const QString& tzid) {
+    struct Rule { const char* tzid; const char* standard; const char* daylight; };
+    static const Rule rules[] = {
+        {"America/Toronto",
+         "TZOFFSETFROM:-0400\r\nTZOFFSETTO:-0500\r\nTZNAME:EST\r\nDTSTART:19701101T020000\r\nRRULE:FREQ=YEARLY;BYMONTH=11;BYDAY=1SU\r\n",
+         "TZOFFSETFROM:-0500\r\nTZOFFSETTO:-0400\r\nTZNAME:EDT\r\nDTSTART:19700308T020000\r\nRRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=2SU\r\n"},
+        {"America/Los_Angeles",
+         "TZOFFSETFROM:-0700\r\nTZOFFSETTO:-0800\r\nTZNAME:PST\r\nDTSTART:19701101T020000\r\nRRULE:FREQ=YEARLY;BYMONTH=11;BYDAY=1SU\r\n",
+         "TZOFFSETFROM:-0800\r\nTZOFFSETTO:-0700\r\nTZNAME:PDT\r\nDTSTART:19700308T020000\r\nRRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=2SU\r\n"},
+        {"Europe/Berlin",
+         "TZOFFSETFROM:+0200\r\nTZOFFSETTO:+0100\r\nTZNAME:CET\r\nDTSTART:19701025T030000\r\nRRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\r\n",
+         "TZOFFSETFROM:+0100\r\nTZOFFSETTO:+0200\r\nTZNAME:CEST\r\nDTSTART:19700329T020000\r\nRRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU\r\n"},
+        {"Europe/London",
+         "TZOFFSETFROM:+0100\r\nTZOFFSETTO:+0000\r\nTZNAME:GMT\r\nDTSTART:19701025T020000\r\nRRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=-1SU\r\n",
+         "TZOFFSETFROM:+0000\r\nTZOFFSETTO:+0100\r\nTZNAME:BST\r\nDTSTART:19700329T010000\r\nRRULE:FREQ=YEARLY;BYMONTH=3;BYDAY=-1SU\r\n"},
+        {"Australia/Sydney",
+         "TZOFFSETFROM:+1100\r\nTZOFFSETTO:+1000\r\nTZNAME:AEST\r\nDTSTART:19700405T030000\r\nRRULE:FREQ=YEARLY;BYMONTH=4;BYDAY=1SU\r\n",
+         "TZOFFSETFROM:+1000\r\nTZOFFSETTO:+1100\r\nTZNAME:AEDT\r\nDTSTART:19701004T020000\r\nRRULE:FREQ=YEARLY;BYMONTH=10;BYDAY=1SU\r\n"},
+        {"Asia/Tokyo",
+         "TZOFFSETFROM:+0900\r\nTZOFFSETTO:+0900\r\nTZNAME:JST\r\nDTSTART:19700101T000000\r\n",
+         nullptr},
+        {"Asia/Kolkata",
+         "TZOFFSETFROM:+0530\r\nTZOFFSETTO:+0530\r\nTZNAME:IST\r\nDTSTART:19700101T000000\r\n",
+         nullptr},
+    };
+
+    for (const Rule& rule : rules) {
+        if (tzid != QLatin1String(rule.tzid)) continue;
+
+        QByteArray block = "BEGIN:VTIMEZONE\r\nTZID:" + QByteArray(rule.tzid) + "\r\n";
+        block += "BEGIN:STANDARD\r\n" + QByteArray(rule.standard) + "END:STANDARD\r\n";
+        if (rule.daylight) {
+            block += "BEGIN:DAYLIGHT\r\n" + QByteArray(rule.daylight) + "END:DAYLIGHT\r\n";
+        }
+        block += "END:VTIMEZONE\r\n";
+        return block;
+    }
+    return QByteArray();
+}
+
+/**
+ * @brief Appends a zero-padded number.
+ * @param out The array to append to.
+ * @param value The number.
+ * @param width The number of digits.
+ */
+void appendDigits(QByteArray& out, int value, int width) {
+    char digits[8];
+    for (int i = width - 1; i >= 0; i--) {
+        digits[i] = char('0' + value % 10);
+        value /= 10;
+    }
+    out.append(digits, width);
+}
+
+/**
+ * @brief Appends an ICS DATE-TIME value.
+ * @param out The array to append to.
+ * @param date The date.
+ * @param minuteOfDay The time of day, in minutes.
+ */
+void appendDateTime(QByteArray& out, const QDate& date, int minuteOfDay) {
+    appendDigits(out, date.year(), 4);
+    appendDigits(out, date.month(), 2);
+    appendDigits(out, date.day(), 2);
+    out.append('T');
+    appendDigits(out, minuteOfDay / 60, 2);
+    appendDigits(out, minuteOfDay % 60, 2);
+    out.append("00", 2);
+}
+
+}
+
+/**
+ * @brief Constructs a generator.
+ * @param options What the feeds look like.
+ */
+IcsGenerator::IcsGenerator(const Options& options)
+    : options(options), random(options.seed), device(nullptr), bytesWritten(0), eventsWritten(0), failed(false) {
+    buffer.reserve(flushThreshold + 4096);
+}
+
+/**
+ * @brief Gets the zones the generator can emit a VTIMEZONE for.
+ * @return The TZIDs, plus "UTC" and "floating".
+ */
+QStringList IcsGenerator::knownTimeZones() {
+    return {"UTC", "floating", "America/Toronto", "America/Los_Angeles", "Europe/Berlin",
+            "Europe/London", "Australia/Sydney", "Asia/Tokyo", "Asia/Kolkata"};
+}
+
+/**
+ * @brief Writes one feed holding the events of a range of users.
+ * @param out The device to write to.
+ * @param firstUser The index of the first user.
+ * @param userCount The number of users.
+ * @return false if writing to the device failed.
+ *
+ * Each user's events only depend on the seed and the user index, so a user gets
+ * the same events in a per-user feed and in a combined feed.
+ */
+bool IcsGenerator::writeFeed(QIODevice* out, int firstUser, int userCount) {
+    device = out;
+    failed = false;
+
+    QByteArray name = userCount == 1 ? "user" + QByteArray::number(firstUser + 1) + "@alignify.test"
+                                     : QByteArray("alignify-load-test");
+    writeHeader(name);
+    writeTimeZones();
+
+    for (int user = firstUser; user < firstUser + userCount; user++) {
+        random.seed(options.seed ^ (quint32(user + 1) * 2654435761u));
+        for (qint64 i = 0; i < options.eventsPerUser; i++) {
+            writeEvent(user, i);
+        }
+    }
+
+    writeLine("END:VCALENDAR");
+    flush();
+    device = nullptr;
+    return !failed;
+}
+
+/**
+ * @brief Gets the number of bytes written so far.
+ * @return The byte count.
+ */
+qint64 IcsGenerator::getBytesWritten() const {
+    return bytesWritten;
+}
+
+/**
+ * @brief Gets the number of events written so far.
+ * @return The event count.
+ */
+qint64 IcsGenerator::getEventsWritten() const {
+    return eventsWritten;
+}
+
+/**
+ * @brief Writes the VCALENDAR header.
+ * @param calendarName The X-WR-CALNAME value.
+ */
+void IcsGenerator::writeHeader(const QByteArray& calendarName) {
+    writeLine("BEGIN:VCALENDAR");
+    writeLine("PRODID:-//Alignify//icsgen//EN");
+    writeLine("VERSION:2.0");
+    writeLine("CALSCALE:GREGORIAN");
+    writeLine("METHOD:PUBLISH");
+    writeLine("X-WR-CALNAME:" + calendarName);
+}
+
+/**
+ * @brief Writes a VTIMEZONE block for every TZID in the mix.
+ */
+void IcsGenerator::writeTimeZones() {
+    for (const QString& tzid : options.timeZones) {
+        QByteArray block = timeZoneBlock(tzid);
+        buffer.append(block);
+    }
+}
+
+/**
+ * @brief Writes one VEVENT.
+ * @param userIndex The index of the user the event belongs to.
+ * @param eventIndex The index of the event within the user's events.
+ */
+void IcsGenerator::writeEvent(int userIndex, qint64 eventIndex) {
+    QDate day = options.firstDay.addDays(random.bounded(qMax(1, options.spanDays)));
+    int startMinute = 7 * 60 + int(random.bounded(12 * 4)) * 15;   // 07:00 to 18:45
+    int duration = (2 + int(random.bounded(7))) * 15;              // 30 min to 2 h
+    int endMinute = qMin(startMinute + duration, 23 * 60 + 59);
+
+    QString zone = options.timeZones.isEmpty() ? QString("UTC")
+                                               : options.timeZones[random.bounded(int(options.timeZones.size()))];
+
+    QByteArray start = "DTSTART";
+    QByteArray end = "DTEND";
+    QByteArray suffix;
+    if (zone == QLatin1String("UTC")) {
+        suffix = "Z";
+    } else if (zone != QLatin1String("floating")) {
+        start += ";TZID=" + zone.toUtf8();
+        end += ";TZID=" + zone.toUtf8();
+    }
+    start += ':';
+    end += ':';
+    appendDateTime(start, day, startMinute);
+    appendDateTime(end, day, endMinute);
+
+    writeLine("BEGIN:VEVENT");
+    writeLine(start + suffix);
+    writeLine(end + suffix);
+    writeLine("DTSTAMP:20240101T000000Z");
+    writeLine("UID:" + QByteArray::number(options.seed) + "-" + QByteArray::number(userIndex + 1) + "-"
+              + QByteArray::number(eventIndex) + "@alignify.test");
+
+    if (random.generateDouble() < options.recurrenceRatio) {
+        static const char* const frequencies[] = {"DAILY", "WEEKLY", "MONTHLY"};
+        writeLine("RRULE:FREQ=" + QByteArray(frequencies[random.bounded(3)])
+                  + ";COUNT=" + QByteArray::number(2 + random.bounded(30)));
+    }
+
+    QByteArray title = titles[random.bounded(int(std::size(titles)))];
+    title += " #" + QByteArray::number(eventIndex + 1);
+    writeText(random.bounded(10) == 0 ? "SUMMARY;LANGUAGE=en" : "SUMMARY", title);
+
+    int descriptionSize = options.minDescription;
+    if (options.maxDescription > options.minDescription) {
+        descriptionSize += int(random.bounded(options.maxDescription - options.minDescription + 1));
+    }
+    if (descriptionSize > 0) {
+        writeText("DESCRIPTION", randomText(descriptionSize));
+    }
+
+    QByteArray location = locations[random.bounded(int(std::size(locations)))];
+    if (!location.isEmpty()) {
+        writeText("LOCATION", location);
+    }
+
+    writeLine("ORGANIZER;CN=User " + QByteArray::number(userIndex + 1) + ":mailto:user"
+              + QByteArray::number(userIndex + 1) + "@alignify.test");
+    writeLine("STATUS:CONFIRMED");
+    writeLine("END:VEVENT");
+    eventsWritten++;
+}
+
+/**
+ * @brief Writes a TEXT property, escaping its value.
+ * @param nameAndParams The property name and parameters.
+ * @param utf8Text The unescaped value.
+ */
+void IcsGenerator::writeText(const QByteArray& nameAndParams, const QByteArray& utf8Text) {
+    QByteArray line = nameAndParams;
+    line.reserve(nameAndParams.size() + 1 + utf8Text.size() + utf8Text.size() / 8);
+    line.append(':');
+    for (char c : utf8Text) {
+        switch (c) {
+        case '\\': line.append("\\\\", 2); break;
+        case ';': line.append("\\;", 2); break;
+        case ',': line.append("\\,", 2); break;
+        case '\n': line.append("\\n", 2); break;
+        default: line.append(c); break;
+        }
+    }
+    writeLine(line);
+}
+
+/**
+ * @brief Writes one content line, folded if enabled.
+ * @param line The unfolded line, without line ending.
+ *
+ * Folds never split a UTF-8 sequence.
+ */
+void IcsGenerator::writeLine(const QByteArray& line) {
+    if (!options.foldLines || line.size() <= foldWidth) {
+        buffer.append(line);
+        buffer.append("\r\n", 2);
+    } else {
+        int from = 0;
+        int width = foldWidth;
+        while (from < line.size()) {
+            int to = qMin(from + width, int(line.size()));
+            // back up to the start of a UTF-8 sequence
+            while (to < line.size() && to > from + 1 && (uchar(line[to]) & 0xC0) == 0x80) {
+                to--;
+            }
+            if (from > 0) {
+                buffer.append(' ');
+            }
+            buffer.append(line.constData() + from, to - from);
+            buffer.append("\r\n", 2);
+            from = to;
+            width = foldWidth - 1; // continuation lines start with a space
+        }
+    }
+
+    if (buffer.size() >= flushThreshold) {
+        flush();
+    }
+}
+
+/**
+ * @brief Writes the buffered bytes to the device.
+ */
+void IcsGenerator::flush() {
+    if (buffer.isEmpty() || !device) return;
+
+    if (device->write(buffer) != buffer.size()) {
+        failed = true;
+    }
+    bytesWritten += buffer.size();
+    buffer.clear();
+}
+
+/**
+ * @brief Builds a description of roughly the requested size.
+ * @param bytes The size in bytes.
+ * @return UTF-8 text with punctuation and line breaks that need escaping.
+ */
+QByteArray IcsGenerator::randomText(int bytes) {
+    QByteArray text;
+    text.reserve(bytes + 16);
+    while (text.size() < bytes) {
+        text.append(words[random.bounded(int(std::size(words)))]);
+        switch (random.bounded(12)) {
+        case 0: text.append(", "); break;
+        case 1: text.append(".\n"); break;
+        case 2: text.append("; "); break;
+        default: text.append(' '); break;
+        }
+    }
+    return text;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file icsgenerator.h
+ * @brief Defines the IcsGenerator class.
+ *
+ * Writes deterministic, realistic ICS feeds for load testing.
+ */
+#ifndef ICSGENERATOR_H
+#define ICSGENERATOR_H
+
+#include <QByteArray>
+#include <QDate>
+#include <QIODevice>
+#include <QRandomGenerator>
+#include <QStringList>
+#include <QTime>
+
+/**
+ * @class IcsGenerator
+ * @brief Generates synthetic ICS feeds from a seed.
+ *
+ * The same options and seed always produce the same bytes. Output is streamed
+ * through a fixed-size buffer, so feeds of any size use constant memory.
+ */
+class IcsGenerator {
+public:
+    /**
+     * @struct Options
+     * @brief What the generated feeds look like.
+     */
+    struct Options {
+        quint32 seed = 1;
+        int users = 1;
+        qint64 eventsPerUser = 1000;
+        double recurrenceRatio = 0.05;  // fraction of events with an RRULE
+        QStringList timeZones = {"UTC"}; // "UTC", "floating" or a TZID known to the generator
+        bool foldLines = true;          // fold content lines at 75 octets
+        int minDescription = 0;         // description size in bytes
+        int maxDescription = 200;
+        QDate firstDay = QDate(2024, 1, 1);
+        int spanDays = 365;
+    };
+
+private:
+    Options options;
+    QRandomGenerator random;
+    QByteArray buffer;
+    QIODevice* device;
+    qint64 bytesWritten;
+    qint64 eventsWritten;
+    bool failed;
+
+    void writeHeader(const QByteArray& calendarName);
+    void writeTimeZones();
+    void writeEvent(int userIndex, qint64 eventIndex);
+    void writeLine(const QByteArray& line);
+    void writeText(const QByteArray& nameAndParams, const QByteArray& utf8Text);
+    void flush();
+    QByteArray randomText(int bytes);
+
+public:
+    explicit IcsGenerator(const Options& options);
+
+    bool writeFeed(QIODevice* out, int firstUser, int userCount);
+
+    qint64 getBytesWritten() const;
+    qint64 getEventsWritten() const;
+
+    static QStringList knownTimeZones();
+};
+
+#endif // ICSGENERATOR_H
@@ -0,0 +1,99 @@
+/**
+ * @file main.cpp
+ * @brief Command-line front end of the synthetic ICS feed generator.
+ *
+ * Writes one feed per user into a directory, or every user into a single
+ * feed when the output path ends in ".ics".
+ */
+#include "icsgenerator.h"
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QTextStream>
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("icsgen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Writes deterministic synthetic ICS feeds for load testing.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("output", "Output directory (one feed per user) or .ics file (single feed).");
+
+    QCommandLineOption seedOption("seed", "Random seed.", "n", "1");
+    QCommandLineOption usersOption("users", "Number of users.", "n", "1");
+    QCommandLineOption eventsOption("events", "Events per user.", "n", "1000");
+    QCommandLineOption recurrenceOption("recurrence", "Fraction of events with an RRULE.", "ratio", "0.05");
+    QCommandLineOption zonesOption("timezones", "Comma separated zone mix: "
+                                   + IcsGenerator::knownTimeZones().join(", ") + ".", "list", "UTC");
+    QCommandLineOption noFoldOption("no-fold", "Do not fold lines longer than 75 octets.");
+    QCommandLineOption minDescriptionOption("min-description", "Minimum description size in bytes.", "bytes", "0");
+    QCommandLineOption maxDescriptionOption("max-description", "Maximum description size in bytes.", "bytes", "200");
+    QCommandLineOption firstDayOption("first-day", "First day events can fall on (yyyy-MM-dd).", "date", "2024-01-01");
+    QCommandLineOption spanOption("span", "Number of days events are spread over.", "days", "365");
+    parser.addOptions({seedOption, usersOption, eventsOption, recurrenceOption, zonesOption, noFoldOption,
+                       minDescriptionOption, maxDescriptionOption, firstDayOption, spanOption});
+    parser.process(app);
+
+    QTextStream err(stderr);
+    if (parser.positionalArguments().size() != 1) {
+        parser.showHelp(1);
+    }
+
+    IcsGenerator::Options options;
+    options.seed = parser.value(seedOption).toUInt();
+    options.users = qMax(1, parser.value(usersOption).toInt());
+    options.eventsPerUser = qMax(0LL, parser.value(eventsOption).toLongLong());
+    options.recurrenceRatio = parser.value(recurrenceOption).toDouble();
+    options.timeZones = parser.value(zonesOption).split(',', Qt::SkipEmptyParts);
+    options.foldLines = !parser.isSet(noFoldOption);
+    options.minDescription = qMax(0, parser.value(minDescriptionOption).toInt());
+    options.maxDescription = qMax(options.minDescription, parser.value(maxDescriptionOption).toInt());
+    options.firstDay = QDate::fromString(parser.value(firstDayOption), "yyyy-MM-dd");
+    options.spanDays = qMax(1, parser.value(spanOption).toInt());
+
+    for (const QString& zone : options.timeZones) {
+        if (!IcsGenerator::knownTimeZones().contains(zone)) {
+            err << "Unknown time zone: " << zone << "\n";
+            return 1;
+        }
+    }
+    if (!options.firstDay.isValid()) {
+        err << "Invalid first day: " << parser.value(firstDayOption) << "\n";
+        return 1;
+    }
+
+    QString output = parser.positionalArguments().first();
+    IcsGenerator generator(options);
+    QElapsedTimer timer;
+    timer.start();
+
+    if (output.endsWith(".ics")) {
+        QFile file(output);
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !generator.writeFeed(&file, 0, options.users)) {
+            err << "Cannot write " << output << "\n";
+            return 1;
+        }
+    } else {
+        QDir dir;
+        if (!dir.mkpath(output)) {
+            err << "Cannot create " << output << "\n";
+            return 1;
+        }
+        for (int user = 0; user < options.users; user++) {
+            QFile file(QDir(output).filePath(QString("user_%1.ics").arg(user + 1, 4, 10, QChar('0'))));
+            if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) || !generator.writeFeed(&file, user, 1)) {
+                err << "Cannot write " << file.fileName() << "\n";
+                return 1;
+            }
+        }
+    }
+
+    double seconds = qMax(1, int(timer.elapsed())) / 1000.0;
+    err << generator.getEventsWritten() << " events, " << generator.getBytesWritten() << " bytes in "
+        << seconds << " s (" << qRound64(generator.getBytesWritten() / seconds / (1024 * 1024)) << " MB/s)\n";
+    return 0;
+}